@@ -151,7 +151,11 @@ void simulate() {
 }
 
 void simulate(const Configuration& config) {
-    DefineCase(config.caseName, config.spaceDim,config.transient);
+    DefineCase(config.caseName, config.spaceDim, config.transient,
+               config.compressedResidualCopy);
+    SetSolidTileSize(config.solidTileSize);
+    SetSelectiveHalo(config.selectiveHalo);
+    SetBlockThreadNum(config.blockThreadNum);
     DefineBlocks(config.blockIds, config.blockNames, config.blockSize,
                  config.meshSize, config.startPos);
     DefineComponents(config.compoNames, config.compoIds, config.lattNames,
@@ -162,6 +166,17 @@ void simulate(const Configuration& config) {
     DefineCollision(config.CollisionTypes, config.CollisionCompoIds);
     DefineBodyForce(config.bodyForceTypes, config.bodyForceCompoIds);
     DefineScheme(config.schemeType);
+    DefineCheckpoint(config.asyncCheckpoint, config.checkpointBufferNum,
+                     config.singleFileCheckpoint);
+    DefineCheckpointCompression(config.macroVarCompression,
+                                config.distributionCompression,
+                                config.nodePropertyCompression);
+    DefineOutputPeriods(config.macroVarOutputPeriod,
+                        config.distributionOutputPeriod,
+                        config.nodePropertyOutputPeriod);
+    DefineCompactRestart(config.compactRestart);
+    DefineSnapshots(config.snapshotPeriod, config.snapshotKeepNum);
+    DefineOutputRegions(config.outputRegions);
     DefineInitialCondition(config.initialTypes, config.initialConditionCompoId);
     for (auto& bcConfig : config.blockBoundaryConfig) {
         DefineBlockBoundary(bcConfig.blockIndex, bcConfig.componentID,
@@ -186,8 +201,10 @@ void simulate(const Configuration& config) {
 
 int main(int argc, const char** argv) {
     // OPS initialisation where a few arguments can be passed to set
-    // the simulation
-    ops_init(argc, argv, 4);
+    // the simulation. The diagnostics level is kept at one so that the
+    // blocks can be executed by threads, see SetBlockThreadNum, and
+    // -OPS_DIAGS=4 turns on the detailed timing of the kernels.
+    ops_init(argc, argv, 1);
     bool configFileFound{false};
     std::string configFileName;
     GetConfigFileFromCmd(configFileFound, configFileName, argc, argv);
@@ -0,0 +1,181 @@
+"""
+# Copyright 2019 United Kingdom Research and Innovation
+ #
+ # Authors: See AUTHORS
+ #
+ # Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the #following conditions are met:
+ #
+ # 1. Redistributions of source code must retain the above copyright notice,
+ #    this list of conditions and the following disclaimer.
+ # 2. Redistributions in binary form must reproduce the above copyright notice
+ #    this list of conditions and the following disclaimer in the documentation
+ #    and or other materials provided with the distribution.
+ # 3. Neither the name of the copyright holder nor the names of its contributors
+ #    may be used to endorse or promote products derived from this software
+ #    without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ # ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ # ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ # LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ # CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ # SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ # INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ # CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ # ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ # POSSIBILITY OF SUCH DAMAGE.
+
+ @brief   Run the benchmark sweeps
+ @author  Jianping Meng
+ @details Run Benchmark2D/Benchmark3D over a list of lattices, box sizes,
+ block decompositions and MPI ranks on the localhost, and print the MLUPS,
+ effective bandwidth and the strong and weak scaling tables.
+ Strong scaling: the box size is fixed while the ranks increase.
+ Weak scaling: the box is extended along the x axis with the ranks so that
+ each rank has the same number of nodes.
+ usage: python3 RunBenchmarks.py --bin-dir build/Apps/Benchmarks
+        --lattices d2q9,d3q19 --sizes 64,128 --blocks 1,2 --ranks 1,2,4
+ The results are also saved into a JSON file (--output).
+ Layout comparison: the memory layout is chosen when building, i.e.,
+ -DDATA_LAYOUT=AoS or SoA, so each layout has its own build directory.
+ usage: python3 RunBenchmarks.py --lattices d2q9,d3q19 --sizes 64,128
+        --layouts AoS=build-aos/Apps/Benchmarks,SoA=build-soa/Apps/Benchmarks
+"""
+import argparse
+import json
+import os
+import subprocess
+import sys
+
+SPACEDIM = {"d2q9": 2, "d3q15": 3, "d3q19": 3}
+
+
+def RunCase(args, lattice, size, blocks, ranks, binDir=None):
+    dim = SPACEDIM[lattice]
+    binary = os.path.join(binDir if binDir else args.bin_dir,
+                          "Benchmark%iDMpi%s" % (dim, args.suffix))
+    command = [args.mpirun, "-np", str(ranks), binary]
+    command += [
+        "Lattice=" + lattice,
+        "Size=" + ",".join(str(n) for n in size),
+        "Blocks=" + ",".join(str(n) for n in blocks),
+        "Steps=%i" % args.steps,
+        "Warmup=%i" % args.warmup,
+        "Scheme=" + args.scheme,
+    ]
+    output = subprocess.run(command,
+                            stdout=subprocess.PIPE,
+                            universal_newlines=True,
+                            check=True).stdout
+    for line in output.splitlines():
+        if line.startswith("BenchmarkResult "):
+            return json.loads(line[len("BenchmarkResult "):])
+    sys.exit("Error! No result from " + " ".join(command))
+
+
+def PrintTable(title, results):
+    print("\n" + title)
+    print("%-8s %-16s %-10s %6s %12s %10s %8s %10s" %
+          ("Lattice", "Size", "Blocks", "Ranks", "MLUPS", "GB/s", "Speedup",
+           "Efficiency"))
+    for result in results:
+        print("%-8s %-16s %-10s %6i %12.4g %10.4g %8.3g %9.1f%%" %
+              (result["Lattice"], "x".join(str(n) for n in result["Size"]),
+               "x".join(str(n) for n in result["Blocks"]), result["Ranks"],
+               result["MLUPS"], result["BandwidthGBs"], result["Speedup"],
+               100 * result["Efficiency"]))
+
+
+def Sweep(args, weak):
+    allResults = []
+    for lattice in args.lattices.split(","):
+        dim = SPACEDIM[lattice]
+        for edge in [int(n) for n in args.sizes.split(",")]:
+            for blockNum in [int(n) for n in args.blocks.split(",")]:
+                results = []
+                for ranks in [int(n) for n in args.ranks.split(",")]:
+                    size = [edge] * dim
+                    if weak:
+                        size[0] = edge * ranks
+                    # the blocks are split along the x axis
+                    blocks = [blockNum] + [1] * (dim - 1)
+                    result = RunCase(args, lattice, size, blocks, ranks)
+                    base = results[0] if results else result
+                    scale = result["Ranks"] / base["Ranks"]
+                    # the throughput should scale with the ranks in both
+                    # strong and weak scaling
+                    result["Speedup"] = result["MLUPS"] / base["MLUPS"]
+                    result["Efficiency"] = result["Speedup"] / scale
+                    results.append(result)
+                PrintTable(("Weak" if weak else "Strong") + " scaling",
+                           results)
+                allResults += results
+    return allResults
+
+
+def CompareLayouts(args):
+    builds = [item.split("=") for item in args.layouts.split(",")]
+    ranks = int(args.ranks.split(",")[0])
+    allResults = []
+    print("\nLayout comparison with %i ranks" % ranks)
+    print("%-8s %-16s %-8s %12s %10s %10s" %
+          ("Lattice", "Size", "Layout", "MLUPS", "GB/s", "Relative"))
+    for lattice in args.lattices.split(","):
+        dim = SPACEDIM[lattice]
+        for edge in [int(n) for n in args.sizes.split(",")]:
+            size = [edge] * dim
+            blocks = [1] * dim
+            base = None
+            for layout, binDir in builds:
+                result = RunCase(args, lattice, size, blocks, ranks, binDir)
+                if result.get("Layout", layout) != layout:
+                    sys.exit("Error! %s is built with the %s layout" %
+                             (binDir, result["Layout"]))
+                result["Layout"] = layout
+                base = base if base else result
+                # relative to the first layout in the list
+                result["Relative"] = result["MLUPS"] / base["MLUPS"]
+                print("%-8s %-16s %-8s %12.4g %10.4g %10.3g" %
+                      (lattice, "x".join(str(n) for n in size), layout,
+                       result["MLUPS"], result["BandwidthGBs"],
+                       result["Relative"]))
+                allResults.append(result)
+    return allResults
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Run the MPLB benchmarks")
+    parser.add_argument("--bin-dir", default=".",
+                        help="directory of the benchmark executables")
+    parser.add_argument("--suffix", default="Dev",
+                        help="Dev for the development build, "
+                        "empty for the optimised build")
+    parser.add_argument("--mpirun", default="mpirun")
+    parser.add_argument("--lattices", default="d2q9,d3q15,d3q19")
+    parser.add_argument("--sizes", default="64",
+                        help="box edge length, per rank for weak scaling")
+    parser.add_argument("--blocks", default="1",
+                        help="numbers of blocks along the x axis")
+    parser.add_argument("--ranks", default="1,2,4")
+    parser.add_argument("--steps", type=int, default=100)
+    parser.add_argument("--warmup", type=int, default=10)
+    parser.add_argument("--scheme", default="Scheme_StreamCollision")
+    parser.add_argument("--scaling", default="strong,weak")
+    parser.add_argument("--layouts", default="",
+                        help="compare the layouts instead of scaling, "
+                        "e.g., AoS=build-aos/Apps/Benchmarks,"
+                        "SoA=build-soa/Apps/Benchmarks")
+    parser.add_argument("--output", default="BenchmarkResults.json")
+    args = parser.parse_args()
+    results = {}
+    if args.layouts:
+        results["layouts"] = CompareLayouts(args)
+    else:
+        for scaling in args.scaling.split(","):
+            results[scaling] = Sweep(args, scaling == "weak")
+    with open(args.output, "w") as output:
+        json.dump(results, output, indent=4)
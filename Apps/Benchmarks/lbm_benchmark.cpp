@@ -0,0 +1,369 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @brief A benchmark of the time loop in a periodic box
+ *  @author Jianping Meng
+ *  @details The benchmark runs a fixed number of steps of a uniform flow in
+ *  a fully periodic box after a few warm-up steps, and reports the million
+ *  lattice updates per second (MLUPS) and the effective bandwidth, i.e.,
+ *  reading and writing the distribution functions once per update. Each run
+ *  is a single configuration given by the command line, e.g.,
+ *  Benchmark3DMpiDev Lattice=d3q19 Size=64,64,64 Blocks=2,1,1 Steps=200
+ *  Warmup=20 Scheme=Scheme_StreamCollision
+ *  The result is printed as a line starting with "BenchmarkResult", and
+ *  RunBenchmarks.py sweeps the configurations and the MPI ranks.
+ **/
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "json.hpp"
+#include "mplb.h"
+#include "ops_seq_v2.h"
+#include "benchmark_kernel.inc"
+
+// Provide macroscopic initial conditions
+void SetInitialMacrosVars() {
+    for (auto idBlock : g_Block()) {
+        Block& block{idBlock.second};
+        std::vector<int> iterRng;
+        iterRng.assign(block.WholeRange().begin(), block.WholeRange().end());
+        const int blockIdx{block.ID()};
+        for (auto& idCompo : g_Components()) {
+            const Component& compo{idCompo.second};
+            const int rhoId{compo.macroVars.at(Variable_Rho).id};
+#ifdef OPS_2D
+            ops_par_loop(KerSetInitialMacroVars, "KerSetInitialMacroVars",
+                         block.Get(), SpaceDim(), iterRng.data(),
+                         ops_arg_dat(g_MacroVars().at(rhoId).at(blockIdx), 1,
+                                     LOCALSTENCIL, "Real", OPS_RW),
+                         ops_arg_dat(g_MacroVars().at(compo.uId).at(blockIdx),
+                                     1, LOCALSTENCIL, "Real", OPS_RW),
+                         ops_arg_dat(g_MacroVars().at(compo.vId).at(blockIdx),
+                                     1, LOCALSTENCIL, "Real", OPS_RW),
+                         ops_arg_dat(g_CoordinateXYZ()[blockIdx], SpaceDim(),
+                                     LOCALSTENCIL, "Real", OPS_READ),
+                         ops_arg_idx());
+#endif
+#ifdef OPS_3D
+            ops_par_loop(KerSetInitialMacroVars, "KerSetInitialMacroVars",
+                         block.Get(), SpaceDim(), iterRng.data(),
+                         ops_arg_dat(g_MacroVars().at(rhoId).at(blockIdx), 1,
+                                     LOCALSTENCIL, "Real", OPS_RW),
+                         ops_arg_dat(g_MacroVars().at(compo.uId).at(blockIdx),
+                                     1, LOCALSTENCIL, "Real", OPS_RW),
+                         ops_arg_dat(g_MacroVars().at(compo.vId).at(blockIdx),
+                                     1, LOCALSTENCIL, "Real", OPS_RW),
+                         ops_arg_dat(g_MacroVars().at(compo.wId).at(blockIdx),
+                                     1, LOCALSTENCIL, "Real", OPS_RW),
+                         ops_arg_dat(g_CoordinateXYZ()[blockIdx], SpaceDim(),
+                                     LOCALSTENCIL, "Real", OPS_READ),
+                         ops_arg_idx());
+#endif
+        }
+    }
+}
+// Provide macroscopic body-force term
+void UpdateMacroscopicBodyForce(const Real time) {}
+
+/*!
+ * The settings of a benchmark run
+ */
+struct BenchmarkSetting {
+    std::string lattice;
+    std::vector<int> size;
+    std::vector<int> blocks;
+    SizeType steps{100};
+    SizeType warmup{10};
+    std::string schemeName{"Scheme_StreamCollision"};
+    SchemeType scheme{Scheme_StreamCollision};
+    Real tau{0.01};
+};
+
+/*!
+ * Get the value of Key=value from the command line
+ */
+std::string GetArgFromCmd(const std::string& key,
+                          const std::string& defaultValue, const int argc,
+                          const char** argv) {
+    const std::string prefix{key + "="};
+    for (int i = 1; i < argc; i++) {
+        const std::string arg{argv[i]};
+        if (arg.find(prefix) == 0) {
+            return arg.substr(prefix.size());
+        }
+    }
+    return defaultValue;
+}
+
+std::vector<int> ParseIntList(const std::string& list) {
+    std::vector<int> values;
+    std::stringstream stream{list};
+    std::string value;
+    while (std::getline(stream, value, ',')) {
+        values.push_back(std::stoi(value));
+    }
+    if (static_cast<int>(values.size()) != SpaceDim()) {
+        ops_printf("Error! %i values are expected in %s!\n", SpaceDim(),
+                   list.c_str());
+        assert(static_cast<int>(values.size()) == SpaceDim());
+    }
+    return values;
+}
+
+BenchmarkSetting ReadBenchmarkSetting(const int argc, const char** argv) {
+    const std::map<std::string, SchemeType> schemes{
+        {"Scheme_StreamCollision", Scheme_StreamCollision},
+        {"Scheme_StreamCollisionFusedMoments",
+         Scheme_StreamCollisionFusedMoments},
+        {"Scheme_StreamCollisionInPlace", Scheme_StreamCollisionInPlace},
+        {"Scheme_StreamCollisionPull", Scheme_StreamCollisionPull}};
+    BenchmarkSetting setting;
+#ifdef OPS_2D
+    setting.lattice = GetArgFromCmd("Lattice", "d2q9", argc, argv);
+    setting.size = ParseIntList(GetArgFromCmd("Size", "256,256", argc, argv));
+    setting.blocks = ParseIntList(GetArgFromCmd("Blocks", "1,1", argc, argv));
+#endif
+#ifdef OPS_3D
+    setting.lattice = GetArgFromCmd("Lattice", "d3q19", argc, argv);
+    setting.size =
+        ParseIntList(GetArgFromCmd("Size", "64,64,64", argc, argv));
+    setting.blocks =
+        ParseIntList(GetArgFromCmd("Blocks", "1,1,1", argc, argv));
+#endif
+    setting.steps = std::stoul(GetArgFromCmd("Steps", "100", argc, argv));
+    setting.warmup = std::stoul(GetArgFromCmd("Warmup", "10", argc, argv));
+    setting.tau = std::stod(GetArgFromCmd("Tau", "0.01", argc, argv));
+    setting.schemeName =
+        GetArgFromCmd("Scheme", setting.schemeName, argc, argv);
+    if (schemes.find(setting.schemeName) == schemes.end()) {
+        ops_printf("Error! The scheme %s is not supported!\n",
+                   setting.schemeName.c_str());
+        assert(schemes.find(setting.schemeName) != schemes.end());
+    }
+    setting.scheme = schemes.at(setting.schemeName);
+    return setting;
+}
+
+std::string JoinIntList(const std::vector<int>& values,
+                        const std::string& separator) {
+    std::string list;
+    for (SizeType idx = 0; idx < values.size(); idx++) {
+        list += (idx == 0 ? "" : separator) + std::to_string(values.at(idx));
+    }
+    return list;
+}
+
+/*!
+ * Split the box into blocks which are connected to each other by the
+ * MD-style periodic halos, where the blocks at the end of an axis are
+ * connected to the ones at the beginning.
+ */
+void DefineBenchmarkBlocks(const BenchmarkSetting& setting) {
+    const int spaceDim{SpaceDim()};
+    const std::vector<int>& blocks{setting.blocks};
+    int blockNum{1};
+    for (const int num : blocks) {
+        blockNum *= num;
+    }
+    const Real meshSize{1.0 / setting.size.at(0)};
+    std::vector<int> blockIds;
+    std::vector<std::string> blockNames;
+    std::vector<int> blockSize;
+    std::map<int, std::vector<Real>> startPos;
+    // The position of a block in the box
+    std::vector<std::vector<int>> blockIndices;
+    for (int blockId = 0; blockId < blockNum; blockId++) {
+        std::vector<int> index(spaceDim);
+        std::vector<Real> start(spaceDim);
+        int rest{blockId};
+        for (int axis = 0; axis < spaceDim; axis++) {
+            index.at(axis) = rest % blocks.at(axis);
+            rest /= blocks.at(axis);
+            const int size{setting.size.at(axis)};
+            const int num{blocks.at(axis)};
+            const int offset{index.at(axis) * (size / num) +
+                             std::min(index.at(axis), size % num)};
+            blockSize.push_back(size / num +
+                                (index.at(axis) < size % num ? 1 : 0));
+            start.at(axis) = offset * meshSize;
+        }
+        blockIds.push_back(blockId);
+        blockNames.push_back("Block" + JoinIntList(index, "_"));
+        startPos.emplace(blockId, start);
+        blockIndices.push_back(index);
+    }
+    DefineBlocks(blockIds, blockNames, blockSize, meshSize, startPos);
+
+    std::vector<BoundarySurface> lowerSurface{BoundarySurface::Left,
+                                              BoundarySurface::Bottom};
+    std::vector<BoundarySurface> upperSurface{BoundarySurface::Right,
+                                              BoundarySurface::Top};
+#ifdef OPS_3D
+    lowerSurface.push_back(BoundarySurface::Back);
+    upperSurface.push_back(BoundarySurface::Front);
+#endif
+    std::vector<int> fromBlockIds;
+    std::vector<int> toBlockIds;
+    std::vector<BoundarySurface> fromBoundarySurface;
+    std::vector<BoundarySurface> toBoundarySurface;
+    for (int blockId = 0; blockId < blockNum; blockId++) {
+        for (int axis = 0; axis < spaceDim; axis++) {
+            std::vector<int> index{blockIndices.at(blockId)};
+            index.at(axis) = (index.at(axis) + 1) % blocks.at(axis);
+            int neighborId{0};
+            for (int dim = spaceDim - 1; dim >= 0; dim--) {
+                neighborId = neighborId * blocks.at(dim) + index.at(dim);
+            }
+            fromBlockIds.push_back(blockId);
+            fromBoundarySurface.push_back(upperSurface.at(axis));
+            toBlockIds.push_back(neighborId);
+            toBoundarySurface.push_back(lowerSurface.at(axis));
+            fromBlockIds.push_back(neighborId);
+            fromBoundarySurface.push_back(lowerSurface.at(axis));
+            toBlockIds.push_back(blockId);
+            toBoundarySurface.push_back(upperSurface.at(axis));
+        }
+    }
+    std::vector<VertexType> blockConnectionType(fromBlockIds.size(),
+                                                VertexType::MDPeriodic);
+    DefineBlockConnection(fromBlockIds, fromBoundarySurface, toBlockIds,
+                          toBoundarySurface, blockConnectionType);
+}
+
+void simulate(const BenchmarkSetting& setting) {
+    const std::string caseName{"Benchmark_" + setting.lattice + "_" +
+                               JoinIntList(setting.size, "x") + "_" +
+                               JoinIntList(setting.blocks, "x")};
+    DefineCase(caseName, SpaceDim(), true);
+    DefineBenchmarkBlocks(setting);
+    std::vector<std::string> compoNames{"Fluid"};
+    std::vector<int> compoId{0};
+    std::vector<std::string> lattNames{setting.lattice};
+    std::vector<Real> tauRef{setting.tau};
+    DefineComponents(compoNames, compoId, lattNames, tauRef);
+#ifdef OPS_2D
+    std::vector<VariableTypes> marcoVarTypes{Variable_Rho, Variable_U,
+                                             Variable_V};
+    std::vector<std::string> macroVarNames{"rho", "u", "v"};
+    std::vector<int> macroVarId{0, 1, 2};
+    std::vector<int> macroCompoId{0, 0, 0};
+#endif
+#ifdef OPS_3D
+    std::vector<VariableTypes> marcoVarTypes{Variable_Rho, Variable_U,
+                                             Variable_V, Variable_W};
+    std::vector<std::string> macroVarNames{"rho", "u", "v", "w"};
+    std::vector<int> macroVarId{0, 1, 2, 3};
+    std::vector<int> macroCompoId{0, 0, 0, 0};
+#endif
+    DefineMacroVars(marcoVarTypes, macroVarNames, macroVarId, macroCompoId);
+    std::vector<CollisionType> collisionTypes{Collision_BGKIsothermal2nd};
+    std::vector<int> collisionCompoId{0};
+    DefineCollision(collisionTypes, collisionCompoId);
+    std::vector<BodyForceType> bodyForceTypes{BodyForce_None};
+    std::vector<SizeType> bodyForceCompoId{0};
+    DefineBodyForce(bodyForceTypes, bodyForceCompoId);
+    DefineScheme(setting.scheme);
+    std::vector<BoundarySurface> surfaces{
+        BoundarySurface::Left, BoundarySurface::Right, BoundarySurface::Top,
+        BoundarySurface::Bottom};
+#ifdef OPS_3D
+    surfaces.push_back(BoundarySurface::Front);
+    surfaces.push_back(BoundarySurface::Back);
+#endif
+    for (const auto& idBlock : g_Block()) {
+        for (const auto surface : surfaces) {
+            DefineBlockBoundary(idBlock.first, 0, surface,
+                                BoundaryScheme::MDPeriodic, {}, {},
+                                VertexType::MDPeriodic);
+        }
+    }
+    std::vector<InitialType> initType{Initial_BGKFeq2nd};
+    std::vector<int> initalCompoId{0};
+    DefineInitialCondition(initType, initalCompoId);
+    Partition();
+    SetInitialMacrosVars();
+#ifdef OPS_2D
+    PreDefinedInitialCondition();
+#endif
+#ifdef OPS_3D
+    PreDefinedInitialCondition3D();
+#endif
+    SetTimeStep((1.0 / setting.size.at(0)) / SoundSpeed());
+
+    void (*cycle)(const Real){SchemeCycle()};
+    ops_printf("Warming up for %zu steps...\n", setting.warmup);
+    for (SizeType iter = 0; iter < setting.warmup; iter++) {
+        cycle(iter * TimeStep());
+    }
+    ops_printf("Running the benchmark for %zu steps...\n", setting.steps);
+    StartPerformanceMonitor(setting.warmup);
+    double ct0, ct1, et0, et1;
+    ops_timers(&ct0, &et0);
+    for (SizeType iter = setting.warmup;
+         iter < setting.warmup + setting.steps; iter++) {
+        cycle(iter * TimeStep());
+    }
+    ops_timers(&ct1, &et1);
+    const double mlups{ReportPerformance(setting.warmup + setting.steps)};
+    // One read and one write of the distribution functions per update
+    const double bandwidth{mlups * 1e6 * 2 * NUMXI * sizeof(DistReal) / 1e9};
+    int rankNum{1};
+#ifdef OPS_MPI
+    MPI_Comm_size(OPS_MPI_GLOBAL, &rankNum);
+#endif
+    nlohmann::json result;
+    result["Lattice"] = setting.lattice;
+    result["Size"] = setting.size;
+    result["Blocks"] = setting.blocks;
+    result["Ranks"] = rankNum;
+    result["Scheme"] = setting.schemeName;
+    result["Layout"] = DataLayoutName(g_f().Layout());
+    result["Steps"] = setting.steps;
+    result["Warmup"] = setting.warmup;
+    result["WallTime"] = et1 - et0;
+    result["MLUPS"] = mlups;
+    result["BandwidthGBs"] = bandwidth;
+    ops_printf("Effective bandwidth %.6g GB/s\n", bandwidth);
+    ops_printf("BenchmarkResult %s\n", result.dump().c_str());
+    DestroyModel();
+}
+
+int main(int argc, const char** argv) {
+    // OPS initialisation where a few arguments can be passed to set
+    // the simulation
+    ops_init(argc, argv, 1);
+    simulate(ReadBenchmarkSetting(argc, argv));
+    ops_exit();
+}
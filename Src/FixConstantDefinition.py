@@ -88,8 +88,11 @@ def ReplaceVariable(variableName, value, text):
         indStart = text.find(variableName, callStart, callEnd)
         if (indStart != -1):
             numMatched += 1
+        # a call may use the variable more than once, e.g., type strings
+        while (indStart != -1):
             startPos.append(indStart)
             endPos.append(indStart + len(variableName))
+            indStart = text.find(variableName, endPos[-1], callEnd)
     if (numMatched >= 1):
         print("Found ", numMatched, " ops_par_loop calls")
         res = text[:startPos[0]] + value
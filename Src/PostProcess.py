@@ -91,6 +91,17 @@ def ChangeShape3D(data, nx, ny, nz, dataLength, haloNum):
                          nx + 2 * haloNum, dataLength))
     return data.transpose((2, 1, 0, 3))
 
+def ChangeShapeSoA(data, nx, ny, dataLength, haloNum):
+    """Converting the storage order of multidim array in 2D space (SoA)."""
+    data = data.reshape((dataLength, ny + 2 * haloNum, nx + 2 * haloNum))
+    return data.transpose((2, 1, 0))
+
+def ChangeShape3DSoA(data, nx, ny, nz, dataLength, haloNum):
+    """Converting the storage order of multidim array in 3D space (SoA)."""
+    data = data.reshape((dataLength, nz + 2 * haloNum, ny + 2 * haloNum,
+                         nx + 2 * haloNum))
+    return data.transpose((3, 2, 1, 0))
+
 
 def ReadVariableFromHDF5(fileName,varName,varLen=1,haloNum=1,withHalo=False):
     if ((not h5Loaded) or (not numpyLoaded)):
@@ -101,6 +112,12 @@ def ReadVariableFromHDF5(fileName,varName,varLen=1,haloNum=1,withHalo=False):
     blockName = list(dataFile.keys())[0]
     dataKey = varName+'_'+blockName
     rawData = np.array(dataFile[blockName][dataKey])
+    # Written at the root of the file of a block, or of a dataset by older versions, see field.h
+    layout = dataFile[blockName][dataKey].attrs.get('Layout', dataFile.attrs.get('Layout', b'AoS'))
+    # The values may be stored shifted, e.g., f-w_i in single precision, see WriteOffsetsToDataset in field.h
+    offsets = dataFile[blockName][dataKey].attrs.get('Offset', None)
+    if isinstance(layout, bytes):
+        layout = layout.decode()
     spaceDim=len(rawData.shape)
     if spaceDim==3:
         nx = int(rawData.shape[2]/varLen)-2*haloNum
@@ -113,7 +130,10 @@ def ReadVariableFromHDF5(fileName,varName,varLen=1,haloNum=1,withHalo=False):
                 data = rawData
             res = data.transpose(2, 1, 0)
         if (varLen > 1):
-            data = ChangeShape3D(rawData, nx, ny, nz, varLen, haloNum)
+            if layout == 'SoA':
+                data = ChangeShape3DSoA(rawData, nx, ny, nz, varLen, haloNum)
+            else:
+                data = ChangeShape3D(rawData, nx, ny, nz, varLen, haloNum)
             if not withHalo:
                 res = data[haloNum:-haloNum, haloNum:-haloNum, haloNum:-haloNum,:]
             else:
@@ -128,11 +148,16 @@ def ReadVariableFromHDF5(fileName,varName,varLen=1,haloNum=1,withHalo=False):
                 data = rawData
             res = data.transpose()
         if (varLen > 1):
-            data = ChangeShape(rawData, nx, ny, varLen, haloNum)
+            if layout == 'SoA':
+                data = ChangeShapeSoA(rawData, nx, ny, varLen, haloNum)
+            else:
+                data = ChangeShape(rawData, nx, ny, varLen, haloNum)
             if not withHalo:
                 res = data[haloNum:-haloNum, haloNum:-haloNum,:]
             else:
                 res = data
+    if offsets is not None:
+        res = res + np.asarray(offsets)
     dataFile.close()
     return res
 
@@ -190,6 +215,71 @@ def WriteVariablesToPlainHDF5(res, fileName):
     dataFile.flush()
     dataFile.close()
 
+# The header and the entry of a snapshot, see snapshot.h
+snapshotHeaderFormat = '=8sIIQQQQ'
+snapshotEntryFormat = '=64s32s8s14iQQ'
+snapshotTypes = {'double': 'f8', 'float': 'f4', 'int': 'i4', 'short': 'i2'}
+
+def ReadSnapshot(fileName):
+    """Read the entries of a snapshot written by DefineSnapshots, where the payload of an entry is mapped as the array [nz][ny][nx][dim] (or [ny][nx][dim]) of the local partition"""
+    if (not numpyLoaded):
+        print("The numpy is not installed!")
+        return None
+    import struct
+    with open(fileName, 'rb') as dataFile:
+        header = struct.unpack(snapshotHeaderFormat, dataFile.read(struct.calcsize(snapshotHeaderFormat)))
+        magic, version, reserved, timeStep, entryNum, tableOffset, alignment = header
+        if magic != b'MPLBSNAP' or version != 1:
+            print(fileName, "is not a valid snapshot!")
+            return None
+        dataFile.seek(tableOffset)
+        entrySize = struct.calcsize(snapshotEntryFormat)
+        entries = []
+        for entryIdx in range(entryNum):
+            values = struct.unpack(snapshotEntryFormat, dataFile.read(entrySize))
+            field, block, typeName = [value.split(b'\0')[0].decode() for value in values[:3]]
+            blockId, spaceDim, dim, typeSize, layout = values[3:8]
+            blockSize, disp, size = values[8:11], values[11:14], values[14:17]
+            offset, bytes = values[17:19]
+            shape = tuple(reversed(size[:spaceDim])) + (dim,)
+            data = None
+            if bytes > 0 and layout == 1:
+                # The components of a partition in the SoA layout are moved to the last axis
+                data = np.moveaxis(np.memmap(fileName, dtype=snapshotTypes[typeName], mode='r', offset=offset, shape=(dim,) + shape[:-1]), 0, -1)
+            elif bytes > 0:
+                data = np.memmap(fileName, dtype=snapshotTypes[typeName], mode='r', offset=offset, shape=shape)
+            entries.append({'field': field, 'block': block, 'type': typeName, 'dim': dim,
+                            'layout': 'SoA' if layout == 1 else 'AoS', 'spaceDim': spaceDim,
+                            'blockSize': blockSize[:spaceDim], 'disp': disp[:spaceDim], 'size': size[:spaceDim], 'data': data})
+    return {'timeStep': timeStep, 'entries': entries}
+
+def ConvertSnapshotsToHDF5(snapshotNames, fileName, offsets=None):
+    """Merge the snapshots of all the processes at a step, e.g., caseName_T1000_R*.snap, into the single checkpoint file, e.g., caseName_T1000.h5, where the dataset of a field is /blockName/fieldName_blockName without the halos, see SingleCheckpointFileName in field.h. The file is in the AoS layout and can be read by the post-processing and restarting of either layout. A snapshot keeps the values of a field as they are stored, e.g., f-w_i for the distributions in single precision, so that offsets may give the shift of a field by its name, e.g., {'f': weights}, which is recorded in the file."""
+    if ((not h5Loaded) or (not numpyLoaded)):
+        print("The h5py or numpy is not installed!")
+        return
+    dataFile = h5.File(fileName, "w")
+    for snapshotName in snapshotNames:
+        snapshot = ReadSnapshot(snapshotName)
+        if snapshot is None:
+            continue
+        for entry in snapshot['entries']:
+            group = dataFile.require_group(entry['block'])
+            dataKey = entry['field'] + '_' + entry['block']
+            shape = tuple(reversed(entry['blockSize'])) + (entry['dim'],)
+            dataset = group.require_dataset(dataKey, shape=shape, dtype=snapshotTypes[entry['type']])
+            if entry['dim'] > 1:
+                dataset.attrs['Layout'] = np.bytes_('AoS')
+            if offsets is not None and entry['field'] in offsets:
+                dataset.attrs['Offset'] = np.asarray(offsets[entry['field']], dtype='f8')
+            if entry['data'] is None:
+                continue
+            start = tuple(reversed(entry['disp']))
+            end = tuple(reversed([disp + size for disp, size in zip(entry['disp'], entry['size'])]))
+            dataset[tuple(slice(first, last) for first, last in zip(start, end))] = entry['data']
+    dataFile.flush()
+    dataFile.close()
+
 def WriteMacroVarsTecplotHDF5(res, fileName):
     """
     Save the data into a Tecplot HDF5 file.
@@ -1,4 +1,5 @@
 #include "block.h"
+#include <algorithm>
 #include <string>
 #include <vector>
 #include <map>
@@ -125,6 +126,32 @@ Block::Block(const int blockId, const std::string& blockName,
     bulkRange.at(4) = 1;
     bulkRange.at(5) = size.at(2) - 1;
 #endif
+    // For the axis, the slabs at both ends, where the previous axes are
+    // limited to the bulk so that the slabs do not overlap
+    for (int axis = 0; axis < spaceDim; axis++) {
+        const int start{wholeRange.at(2 * axis)};
+        const int end{wholeRange.at(2 * axis + 1)};
+        std::vector<int> lower{wholeRange};
+        std::vector<int> upper{wholeRange};
+        for (int prevAxis = 0; prevAxis < axis; prevAxis++) {
+            for (int idx = 2 * prevAxis; idx <= 2 * prevAxis + 1; idx++) {
+                lower.at(idx) = bulkRange.at(idx);
+                upper.at(idx) = bulkRange.at(idx);
+            }
+        }
+        lower.at(2 * axis + 1) = std::min(start + 1, end);
+        upper.at(2 * axis) = std::max(end - 1, start + 1);
+        for (const auto& range : {lower, upper}) {
+            bool empty{false};
+            for (int dim = 0; dim < spaceDim; dim++) {
+                empty = empty || (range.at(2 * dim) >= range.at(2 * dim + 1));
+            }
+            if (!empty) {
+                shellRanges.push_back(range);
+            }
+        }
+    }
+    bulkBoundaryRanges.push_back(bulkRange);
     for (const auto surface : AllBoundarySurface) {
         boundarySurfaceRange[surface] = {RangeStart(xaxis, surface),
                                          RangeEnd(xaxis, surface),
@@ -139,6 +166,111 @@ Block::Block(const int blockId, const std::string& blockName,
     }
 }
 
+void Block::DecomposeBulkRange(
+    const std::vector<std::vector<int>>& nonFluidPlanes) {
+    fluidRanges.clear();
+    bulkBoundaryRanges.clear();
+    SplitBulkRange(bulkRange, 0, nonFluidPlanes);
+}
+
+/*!
+ * Split the range along the axis into the runs of planes with and without
+ * non-Fluid nodes. A box spanning the latter is Fluid whatever the other
+ * axes are, while the former is split further along the next axis.
+ */
+void Block::SplitBulkRange(
+    const std::vector<int>& range, const int axis,
+    const std::vector<std::vector<int>>& nonFluidPlanes) {
+    const std::vector<int>& planes{nonFluidPlanes.at(axis)};
+    int start{range.at(2 * axis)};
+    while (start < range.at(2 * axis + 1)) {
+        const bool nonFluid{planes.at(start) != 0};
+        int end{start + 1};
+        while (end < range.at(2 * axis + 1) &&
+               (planes.at(end) != 0) == nonFluid) {
+            end++;
+        }
+        std::vector<int> box{range};
+        box.at(2 * axis) = start;
+        box.at(2 * axis + 1) = end;
+        if (!nonFluid) {
+            fluidRanges.push_back(box);
+        } else if (axis + 1 < spaceDim) {
+            SplitBulkRange(box, axis + 1, nonFluidPlanes);
+        } else {
+            bulkBoundaryRanges.push_back(box);
+        }
+        start = end;
+    }
+}
+
+void Block::SetActiveTiles(const int tileSize,
+                           const std::vector<int>& activeTiles) {
+    solidTileSize = tileSize;
+    activeTileRanges.clear();
+    if (tileSize <= 0) {
+        return;
+    }
+    std::vector<int> tileNum(spaceDim, 1);
+    for (int axis = 0; axis < spaceDim; axis++) {
+        tileNum.at(axis) = (size.at(axis) + tileSize - 1) / tileSize;
+    }
+    const int rowNum{(int)activeTiles.size() / tileNum.at(0)};
+    // The active tiles are merged into runs along x to keep the number of
+    // loops down
+    for (int row = 0; row < rowNum; row++) {
+        int start{0};
+        while (start < tileNum.at(0)) {
+            if (activeTiles.at(row * tileNum.at(0) + start) == 0) {
+                start++;
+                continue;
+            }
+            int end{start + 1};
+            while (end < tileNum.at(0) &&
+                   activeTiles.at(row * tileNum.at(0) + end) != 0) {
+                end++;
+            }
+            std::vector<int> box{wholeRange};
+            box.at(0) = start * tileSize;
+            box.at(1) = std::min(end * tileSize, wholeRange.at(1));
+            int tileIdx{row};
+            for (int axis = 1; axis < spaceDim; axis++) {
+                const int tile{tileIdx % tileNum.at(axis)};
+                tileIdx /= tileNum.at(axis);
+                box.at(2 * axis) = tile * tileSize;
+                const int tileEnd{(tile + 1) * tileSize};
+                box.at(2 * axis + 1) =
+                    std::min(tileEnd, wholeRange.at(2 * axis + 1));
+            }
+            activeTileRanges.push_back(box);
+            start = end;
+        }
+    }
+}
+
+std::vector<std::vector<int>> Block::ActiveRanges(
+    const std::vector<int>& range) const {
+    if (solidTileSize <= 0) {
+        return {range};
+    }
+    std::vector<std::vector<int>> ranges;
+    for (const auto& tileRange : activeTileRanges) {
+        std::vector<int> box{range};
+        bool empty{false};
+        for (int axis = 0; axis < spaceDim; axis++) {
+            box.at(2 * axis) =
+                std::max(range.at(2 * axis), tileRange.at(2 * axis));
+            box.at(2 * axis + 1) =
+                std::min(range.at(2 * axis + 1), tileRange.at(2 * axis + 1));
+            empty = empty || (box.at(2 * axis) >= box.at(2 * axis + 1));
+        }
+        if (!empty) {
+            ranges.push_back(box);
+        }
+    }
+    return ranges;
+}
+
 void Block::AddNeighbor(BoundarySurface surface, const Neighbor& neighbor) {
     if (neighbors.find(surface) != neighbors.end()) {
         ops_printf("Error! There is already a neighbor defined for Block $s!\n",
@@ -76,6 +76,13 @@ class Block {
     int RangeEnd(const int axis);
     std::vector<int> wholeRange;
     std::vector<int> bulkRange;
+    std::vector<std::vector<int>> shellRanges;
+    std::vector<std::vector<int>> fluidRanges;
+    std::vector<std::vector<int>> bulkBoundaryRanges;
+    void SplitBulkRange(const std::vector<int>& range, const int axis,
+                        const std::vector<std::vector<int>>& nonFluidPlanes);
+    int solidTileSize{0};
+    std::vector<std::vector<int>> activeTileRanges;
     std::map<BoundarySurface, Neighbor> neighbors;
 #ifdef OPS_3D
     std::vector<int> kminRange;
@@ -92,6 +99,50 @@ class Block {
     const int* pSize() const { return size.data(); };
     const std::vector<int>& WholeRange() const { return wholeRange; };
     const std::vector<int>& BulkRange() const { return bulkRange; };
+    /*!
+     * Non-overlapping ranges which cover the nodes of the whole range outside
+     * the bulk range, i.e., the nodes which may need the block halos for a
+     * one-point stencil
+     */
+    const std::vector<std::vector<int>>& ShellRanges() const {
+        return shellRanges;
+    };
+    /*!
+     * The bulk range is split into boxes where every component has only
+     * Fluid nodes, i.e., FluidRanges, and boxes which contain the other
+     * nodes, i.e., BulkBoundaryRanges, so that the former can be updated
+     * without reading the node types. The whole bulk range is a boundary
+     * range until DecomposeBulkRange is called.
+     */
+    const std::vector<std::vector<int>>& FluidRanges() const {
+        return fluidRanges;
+    };
+    const std::vector<std::vector<int>>& BulkBoundaryRanges() const {
+        return bulkBoundaryRanges;
+    };
+    /*!
+     * nonFluidPlanes[axis][i] is nonzero if the plane at i normal to the axis
+     * has a node which is not Fluid within the bulk range.
+     */
+    void DecomposeBulkRange(
+        const std::vector<std::vector<int>>& nonFluidPlanes);
+    /*!
+     * Skipping of the solid tiles: the whole range is divided into tiles of
+     * tileSize nodes along each axis, and the tiles where every node is
+     * ImmersedSolid for all the components are never iterated, while the
+     * storage is unchanged.
+     * activeTiles[t] is nonzero for the other tiles, where t counts the
+     * tiles along x first. A zero tileSize switches the mode off.
+     */
+    void SetActiveTiles(const int tileSize,
+                        const std::vector<int>& activeTiles);
+    int TileSize() const { return solidTileSize; };
+    /*!
+     * The boxes covering the part of a range within the active tiles, or
+     * the range itself if the solid tiles are not skipped
+     */
+    std::vector<std::vector<int>> ActiveRanges(
+        const std::vector<int>& range) const;
     const std::map<BoundarySurface, std::vector<int>>& BoundarySurfaceRange()
         const {
         return boundarySurfaceRange;
@@ -35,11 +35,13 @@
  * @details Declaring functions related to boundary conditions.
  */
 //#include "boundary.h"
+#include "step_plan.h"
 #include "flowfield.h"
 #include "type.h"
 #include "boundary.h"
 #include <cassert>
 #include "model.h"
+#include "scheme.h"
 /*!
  * boundaryHaloPt: the halo point needed by the boundary condition
  * In general, the periodic boundary conditions will need one halo point
@@ -113,6 +115,15 @@ void DefineBlockBoundary(int blockIndex, int componentID,
         }
     }
 
+    if (Scheme() == Scheme_StreamCollisionInPlace &&
+        !InPlaceStreamingSupported(boundaryScheme)) {
+        ops_printf(
+            "Error! The boundary scheme %i is not supported by the in-place "
+            "stream-collision scheme!\n",
+            boundaryScheme);
+        assert(InPlaceStreamingSupported(boundaryScheme));
+    }
+
     BlockBoundary blockBoundary;
     blockBoundary.blockIndex = blockIndex;
     blockBoundary.componentID = componentID;
@@ -129,6 +140,18 @@ void DefineBlockBoundary(int blockIndex, int componentID,
         blockBoundary.blockIndex);
 }
 
+bool InPlaceStreamingSupported(const BoundaryScheme boundaryScheme) {
+    switch (boundaryScheme) {
+        case BoundaryScheme::EQMDiffuseRefl:
+        case BoundaryScheme::MDPeriodic:
+        case BoundaryScheme::FDPeriodic:
+        case BoundaryScheme::None:
+            return true;
+        default:
+            return false;
+    }
+}
+
 int BoundaryHaloNum() { return boundaryHaloPt; }
 
 void SetBoundaryHaloNum(const int boundaryHaloNum) {
@@ -377,22 +400,16 @@ void BoundaryNormal3D(const VertexGeometryType vg, int* unitNormal) {
 }
 #ifdef OPS_3D
 void ImplementBoundary3D() {
-    for (const auto& boundary : BlockBoundaries()) {
-        const Block& block{g_Block().at(boundary.blockIndex)};
-        TreatBlockBoundary3D(block, boundary.componentID,
-                             boundary.givenVars.data(), boundary.boundaryScheme,
-                             boundary.boundarySurface);
+    for (BoundaryPlan& boundary : BoundaryStepPlan()) {
+        TreatBoundary3D(boundary);
     }
 }
 #endif
 
 #ifdef OPS_2D
 void ImplementBoundary() {
-    for (const auto& boundary : BlockBoundaries()) {
-        const Block& block{g_Block().at(boundary.blockIndex)};
-        TreatBlockBoundary(block, boundary.componentID,
-                             boundary.givenVars.data(), boundary.boundaryScheme,
-                             boundary.boundarySurface);
+    for (BoundaryPlan& boundary : BoundaryStepPlan()) {
+        TreatBoundary(boundary);
     }
 }
 #endif
@@ -108,11 +108,26 @@ void DefineBlockBoundary(
     int blockIndex, int componentID, BoundarySurface boundarySurface,
     const VertexType boundaryType = VertexType::VirtualBoundary);
 const std::vector<BlockBoundary>& BlockBoundaries();
+/*!
+ * Whether a boundary scheme can work with the in-place stream-collision
+ * scheme, which leaves the post-collision value of the node in some of the
+ * links that are not streamed, see KerStreamToSwap. Only the schemes that
+ * overwrite all such links, or stream the boundary nodes as the fluid, are
+ * supported.
+ */
+bool InPlaceStreamingSupported(const BoundaryScheme boundaryScheme);
+// See step_plan.h
+struct BoundaryPlan;
 #ifdef OPS_3D
 void TreatBlockBoundary3D(const Block& block, const int componentID,
                           const Real* givenVars,
                           const BoundaryScheme boundaryScheme,
                           const BoundarySurface boundarySurface);
+/*!
+ * Treat a boundary condition whose dats and range are resolved by the step
+ * plan, which is also used by TreatBlockBoundary3D
+ */
+void TreatBoundary3D(BoundaryPlan& boundary);
 void ImplementBoundary3D();
 #endif
 
@@ -121,6 +136,11 @@ void TreatBlockBoundary(const Block& block, const int componentID,
                           const Real* givenVars,
                           const BoundaryScheme boundaryScheme,
                           const BoundarySurface boundarySurface);
+/*!
+ * Treat a boundary condition whose dats and range are resolved by the step
+ * plan, which is also used by TreatBlockBoundary
+ */
+void TreatBoundary(BoundaryPlan& boundary);
 void ImplementBoundary();
 #endif
 #endif  // BOUNDARY_H
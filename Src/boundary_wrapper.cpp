@@ -1,6 +1,7 @@
 #include <vector>
 #include "type.h"
 #include "flowfield.h"
+#include "step_plan.h"
 #include "flowfield_host_device.h"
 #include "boundary.h"
 #include "model.h"
@@ -9,123 +10,110 @@
 #include "ops_seq_v2.h"
 #include "boundary_kernel.inc"
 #ifdef OPS_3D
-void TreatBlockBoundary3D(const Block& block, const int componentID,
-                          const Real* givenVars,
-                          const BoundaryScheme boundaryScheme,
-                          const BoundarySurface boundarySurface) {
-    const int surface{(int)boundarySurface};
-    const int blockIndex{block.ID()};
-    std::vector<int> range(2 * SpaceDim());
-    range.assign(block.BoundarySurfaceRange().at(boundarySurface).begin(),
-                     block.BoundarySurfaceRange().at(boundarySurface).end());
-    switch (boundaryScheme) {
+void TreatBoundary3D(BoundaryPlan& boundary) {
+    switch (boundary.boundaryScheme) {
         case BoundaryScheme::ExtrapolPressure1ST: {
-            ops_par_loop(
-                KerCutCellExtrapolPressure1ST3D,
-                "KerCutCellExtrapolPressure1ST3D", block.Get(), SpaceDim(),
-                range.data(),
-                ops_arg_dat(g_f()[blockIndex], NUMXI, ONEPTREGULARSTENCIL,
-                            "double", OPS_RW),
-                ops_arg_dat(g_NodeType().at(componentID).at(blockIndex), 1,
-                            ONEPTREGULARSTENCIL, "int", OPS_READ),
-                ops_arg_dat(g_GeometryProperty()[blockIndex], 1, LOCALSTENCIL,
-                            "int", OPS_READ),
-                ops_arg_gbl(givenVars, 1, "double", OPS_READ),
-                ops_arg_gbl(&surface, 1, "int", OPS_READ),
-                ops_arg_gbl(g_Components().at(componentID).index, 2, "int",
-                            OPS_READ));
+            ops_par_loop(KerCutCellExtrapolPressure1ST3D,
+                         "KerCutCellExtrapolPressure1ST3D",
+                         boundary.block->Get(), SpaceDim(),
+                         boundary.range.data(),
+                         ops_arg_dat(boundary.f, NUMXI, ONEPTREGULARSTENCIL,
+                                     g_f().Type(), OPS_RW),
+                         ops_arg_dat(boundary.descriptor, 1, LOCALSTENCIL,
+                                     "short", OPS_READ),
+                         ops_arg_gbl(boundary.givenVars, 1, "double", OPS_READ),
+                         ops_arg_gbl(&boundary.surface, 1, "int", OPS_READ),
+                         ops_arg_gbl(boundary.compo->index, 2, "int",
+                                     OPS_READ));
         } break;
         case BoundaryScheme::EQMDiffuseRefl: {
-            ops_par_loop(
-                KerCutCellEQMDiffuseRefl3D, "KerCutCellEQMDiffuseRefl3D",
-                block.Get(), SpaceDim(), range.data(),
-                ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL, "double",
-                            OPS_RW),
-                ops_arg_dat(g_NodeType().at(componentID).at(blockIndex), 1,
-                            LOCALSTENCIL, "int", OPS_READ),
-                ops_arg_dat(g_GeometryProperty()[blockIndex], 1, LOCALSTENCIL,
-                            "int", OPS_READ),
-                ops_arg_gbl(givenVars, 3, "double", OPS_READ),
-                ops_arg_gbl(g_Components().at(componentID).index, 2, "int",
-                            OPS_READ));
+            ops_par_loop(KerCutCellEQMDiffuseRefl3D,
+                         "KerCutCellEQMDiffuseRefl3D", boundary.block->Get(),
+                         SpaceDim(), boundary.range.data(),
+                         ops_arg_dat(boundary.f, NUMXI, LOCALSTENCIL,
+                                     g_f().Type(), OPS_RW),
+                         ops_arg_dat(boundary.descriptor, 1, LOCALSTENCIL,
+                                     "short", OPS_READ),
+                         ops_arg_gbl(boundary.givenVars, 3, "double", OPS_READ),
+                         ops_arg_gbl(boundary.compo->index, 2, "int",
+                                     OPS_READ));
         } break;
         case BoundaryScheme::FDPeriodic: {
-            ops_par_loop(
-                KerCutCellPeriodic3D, "KerCutCellPeriodic3D", block.Get(),
-                SpaceDim(), range.data(),
-                ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL, "double",
-                            OPS_RW),
-                ops_arg_dat(g_NodeType().at(componentID).at(blockIndex), 1,
-                            LOCALSTENCIL, "int", OPS_READ),
-                ops_arg_dat(g_GeometryProperty()[blockIndex], 1, LOCALSTENCIL,
-                            "int", OPS_READ),
-                ops_arg_gbl(g_Components().at(componentID).index, 2, "int",
-                            OPS_READ),
-                ops_arg_gbl(&surface, 1, "int", OPS_READ));
+            ops_par_loop(KerCutCellPeriodic3D, "KerCutCellPeriodic3D",
+                         boundary.block->Get(), SpaceDim(),
+                         boundary.range.data(),
+                         ops_arg_dat(boundary.f, NUMXI, LOCALSTENCIL,
+                                     g_f().Type(), OPS_RW),
+                         ops_arg_dat(boundary.descriptor, 1, LOCALSTENCIL,
+                                     "short", OPS_READ),
+                         ops_arg_gbl(boundary.compo->index, 2, "int", OPS_READ),
+                         ops_arg_gbl(&boundary.surface, 1, "int", OPS_READ));
         } break;
         default:
             break;
     }
 }
-#endif //OPS_3D
 
-#ifdef OPS_2D
-void TreatBlockBoundary(const Block& block, const int componentID,
+void TreatBlockBoundary3D(const Block& block, const int componentID,
                           const Real* givenVars,
                           const BoundaryScheme boundaryScheme,
                           const BoundarySurface boundarySurface) {
-    const int surface{(int)boundarySurface};
-    const int blockIndex{block.ID()};
-    std::vector<int> range(2 * SpaceDim());
-    range.assign(block.BoundarySurfaceRange().at(boundarySurface).begin(),
-                     block.BoundarySurfaceRange().at(boundarySurface).end());
-    switch (boundaryScheme) {
+    BoundaryPlan boundary{ResolveBoundary(block, componentID, givenVars,
+                                          boundaryScheme, boundarySurface)};
+    TreatBoundary3D(boundary);
+}
+#endif //OPS_3D
+
+#ifdef OPS_2D
+void TreatBoundary(BoundaryPlan& boundary) {
+    switch (boundary.boundaryScheme) {
         case BoundaryScheme::ExtrapolPressure1ST: {
-            ops_par_loop(
-                KerCutCellExtrapolPressure1ST,
-                "KerCutCellExtrapolPressure1ST", block.Get(), SpaceDim(),
-                range.data(),
-                ops_arg_dat(g_f()[blockIndex], NUMXI, ONEPTREGULARSTENCIL,
-                            "double", OPS_RW),
-                ops_arg_dat(g_NodeType().at(componentID).at(blockIndex), 1,
-                            ONEPTREGULARSTENCIL, "int", OPS_READ),
-                ops_arg_dat(g_GeometryProperty()[blockIndex], 1, LOCALSTENCIL,
-                            "int", OPS_READ),
-                ops_arg_gbl(givenVars, 1, "double", OPS_READ),
-                ops_arg_gbl(&surface, 1, "int", OPS_READ),
-                ops_arg_gbl(g_Components().at(componentID).index, 2, "int",
-                            OPS_READ));
+            ops_par_loop(KerCutCellExtrapolPressure1ST,
+                         "KerCutCellExtrapolPressure1ST", boundary.block->Get(),
+                         SpaceDim(), boundary.range.data(),
+                         ops_arg_dat(boundary.f, NUMXI, ONEPTREGULARSTENCIL,
+                                     g_f().Type(), OPS_RW),
+                         ops_arg_dat(boundary.descriptor, 1, LOCALSTENCIL,
+                                     "short", OPS_READ),
+                         ops_arg_gbl(boundary.givenVars, 1, "double", OPS_READ),
+                         ops_arg_gbl(&boundary.surface, 1, "int", OPS_READ),
+                         ops_arg_gbl(boundary.compo->index, 2, "int",
+                                     OPS_READ));
         } break;
         case BoundaryScheme::EQMDiffuseRefl: {
-            ops_par_loop(
-                KerCutCellEQMDiffuseRefl, "KerCutCellEQMDiffuseRefl",
-                block.Get(), SpaceDim(), range.data(),
-                ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL, "double",
-                            OPS_RW),
-                ops_arg_dat(g_NodeType().at(componentID).at(blockIndex), 1,
-                            LOCALSTENCIL, "int", OPS_READ),
-                ops_arg_dat(g_GeometryProperty()[blockIndex], 1, LOCALSTENCIL,
-                            "int", OPS_READ),
-                ops_arg_gbl(givenVars, 2, "double", OPS_READ),
-                ops_arg_gbl(g_Components().at(componentID).index, 2, "int",
-                            OPS_READ));
+            ops_par_loop(KerCutCellEQMDiffuseRefl, "KerCutCellEQMDiffuseRefl",
+                         boundary.block->Get(), SpaceDim(),
+                         boundary.range.data(),
+                         ops_arg_dat(boundary.f, NUMXI, LOCALSTENCIL,
+                                     g_f().Type(), OPS_RW),
+                         ops_arg_dat(boundary.descriptor, 1, LOCALSTENCIL,
+                                     "short", OPS_READ),
+                         ops_arg_gbl(boundary.givenVars, 2, "double", OPS_READ),
+                         ops_arg_gbl(boundary.compo->index, 2, "int",
+                                     OPS_READ));
         } break;
         case BoundaryScheme::FDPeriodic: {
-            ops_par_loop(
-                KerCutCellPeriodic, "KerCutCellPeriodic", block.Get(),
-                SpaceDim(), range.data(),
-                ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL, "double",
-                            OPS_RW),
-                ops_arg_dat(g_NodeType().at(componentID).at(blockIndex), 1,
-                            LOCALSTENCIL, "int", OPS_READ),
-                ops_arg_dat(g_GeometryProperty()[blockIndex], 1, LOCALSTENCIL,
-                            "int", OPS_READ),
-                ops_arg_gbl(g_Components().at(componentID).index, 2, "int",
-                            OPS_READ),
-                ops_arg_gbl(&surface, 1, "int", OPS_READ));
+            ops_par_loop(KerCutCellPeriodic, "KerCutCellPeriodic",
+                         boundary.block->Get(), SpaceDim(),
+                         boundary.range.data(),
+                         ops_arg_dat(boundary.f, NUMXI, LOCALSTENCIL,
+                                     g_f().Type(), OPS_RW),
+                         ops_arg_dat(boundary.descriptor, 1, LOCALSTENCIL,
+                                     "short", OPS_READ),
+                         ops_arg_gbl(boundary.compo->index, 2, "int", OPS_READ),
+                         ops_arg_gbl(&boundary.surface, 1, "int", OPS_READ));
         } break;
         default:
             break;
     }
 }
+
+void TreatBlockBoundary(const Block& block, const int componentID,
+                        const Real* givenVars,
+                        const BoundaryScheme boundaryScheme,
+                        const BoundarySurface boundarySurface) {
+    BoundaryPlan boundary{ResolveBoundary(block, componentID, givenVars,
+                                          boundaryScheme, boundarySurface)};
+    TreatBoundary(boundary);
+}
 #endif //OPS_2D
@@ -0,0 +1,933 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*! @brief   Implementing functions for writing checkpoints
+ * @author  Jianping Meng
+ * @details In the asynchronous mode, a checkpoint is taken by fetching the
+ * datasets being written into a free staging buffer in the host memory,
+ * which is then queued for the writer thread. All the OPS calls stay on the
+ * main thread, and the writer thread only makes plain HDF5 calls on the
+ * staged datasets, which are the same as those written by
+ * Field::WriteToHDF5 into the single file. The HDF5 calls which may overlap
+ * the writer thread are serialised by Hdf5Mutex. The static node
+ * properties are written once at the starting step, and the later
+ * checkpoint files refer to them by HDF5 external links.
+ * A checkpoint is written either into a file per block, or into a single
+ * file with a group per block, which is opened once per checkpoint. The
+ * datasets of the single file may be compressed by the HDF5 filters, which
+ * run on the writer thread in the asynchronous mode.
+ */
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "hdf5.h"
+#include "ops_lib_core.h"
+#ifdef OPS_MPI
+#include "ops_mpi_core.h"
+#endif
+#include "checkpoint.h"
+#include "field.h"
+#include "flowfield.h"
+#include "model.h"
+#include "snapshot.h"
+
+/*!
+ * The parts of a checkpoint which are written at a step
+ */
+struct CheckpointParts {
+    bool macroVars{false};
+    bool distributions{false};
+    bool nodeProperties{false};
+    // Link to the static node properties written at the starting step
+    bool nodePropertyLinks{false};
+};
+
+/*!
+ * The fields written into a checkpoint
+ */
+struct CheckpointFields {
+    const RealFieldGroup* macroVars;
+    const RealField* coordinateXYZ;
+    const RealFieldGroup* macroBodyforce;
+    const DistributionField* f;
+    // The moments written instead of f in the compact restart
+    const RealFieldGroup* restartMoments;
+    const IntField* geometryProperty;
+    const IntFieldGroup* nodeType;
+};
+
+/*!
+ * The datasets of the parts being written in a checkpoint staged in the host
+ * memory, where the first datasetNum ones are valid and the others are kept
+ * for reusing their memory
+ */
+struct CheckpointBuffer {
+    SizeType timeStep{0};
+    bool busy{false};
+    CheckpointParts parts;
+    std::vector<HostDataset> datasets;
+    SizeType datasetNum{0};
+};
+
+bool ASYNCCHECKPOINT{false};
+bool SINGLEFILECHECKPOINT{false};
+bool COMPACTRESTART{false};
+CheckpointCompression MACROVARCOMPRESSION;
+CheckpointCompression DISTRIBUTIONCOMPRESSION;
+CheckpointCompression NODEPROPERTYCOMPRESSION;
+int CHECKPOINTBUFFERNUM{2};
+std::vector<CheckpointBuffer> checkpointBuffers;
+// The indices of the buffers waiting for writing
+std::deque<int> checkpointQueue;
+std::mutex checkpointMutex;
+std::condition_variable checkpointCondition;
+std::thread checkpointWriter;
+bool stopCheckpointWriter{false};
+// 0 means the check period for the macroscopic variables and distributions,
+// and static node properties
+SizeType MACROVAROUTPUTPERIOD{0};
+SizeType DISTRIBUTIONOUTPUTPERIOD{0};
+SizeType NODEPROPERTYOUTPUTPERIOD{0};
+SizeType CHECKPERIOD{1000};
+// 0 means no snapshot
+SizeType SNAPSHOTPERIOD{0};
+int SNAPSHOTKEEPNUM{2};
+// The snapshots written by this process, the oldest first
+std::deque<std::string> snapshotNames;
+
+/*!
+ * An output region resolved on its block, where buffer is declared over
+ * range and holds the macroscopic variables of macroVarIds as components
+ */
+struct RegionOutput {
+    OutputRegion region;
+    std::vector<int> range;
+    std::vector<int> stride;
+    std::vector<int> macroVarIds;
+    ops_dat buffer;
+};
+std::vector<RegionOutput> outputRegions;
+// The step where the static node properties are found
+SizeType STATICNODEPROPERTYSTEP{0};
+// The single checkpoint files created by this run, guarded by Hdf5Mutex
+std::set<std::string> createdCheckpointFiles;
+
+void DefineCheckpoint(const bool async, const int bufferNum,
+                      const bool singleFile) {
+    if (bufferNum < 1) {
+        ops_printf(
+            "Error! There must be at least one checkpoint buffer but we "
+            "get %i\n",
+            bufferNum);
+        assert(bufferNum >= 1);
+    }
+#ifdef OPS_MPI
+    if (async) {
+        ops_printf(
+            "Warning! The asynchronous checkpoint is not supported by the "
+            "MPI version, the checkpoints are written synchronously!\n");
+    }
+    ASYNCCHECKPOINT = false;
+#else
+    ASYNCCHECKPOINT = async;
+#endif
+    CHECKPOINTBUFFERNUM = bufferNum;
+    SINGLEFILECHECKPOINT = singleFile;
+    // The files of the blocks are written by OPS, which must not be called
+    // by the writer thread
+    if (ASYNCCHECKPOINT && !SINGLEFILECHECKPOINT) {
+        ops_printf(
+            "Warning! The asynchronous checkpoints are written into a single "
+            "file rather than a file per block!\n");
+        SINGLEFILECHECKPOINT = true;
+    }
+    if (ASYNCCHECKPOINT) {
+        ops_printf(
+            "The checkpoints are written asynchronously with %i buffers.\n",
+            CHECKPOINTBUFFERNUM);
+    }
+    if (SINGLEFILECHECKPOINT) {
+        ops_printf("Each checkpoint is written into a single file.\n");
+    }
+}
+
+/*!
+ * The zstd filter is a plugin, which falls back to deflate if it is not
+ * found by the HDF5 library. The lossy compression is ignored unless
+ * lossyAllowed is true.
+ */
+CheckpointCompression CheckCompression(const CheckpointCompression& compression,
+                                       const std::string& family,
+                                       const bool lossyAllowed) {
+    CheckpointCompression checked{compression};
+    if (checked.errorBound > 0 && !lossyAllowed) {
+        ops_printf(
+            "Warning! The %s must be exact, the error bound %g is ignored!\n",
+            family.c_str(), checked.errorBound);
+        checked.errorBound = 0;
+    }
+    if (checked.zstd && checked.level > 0 && H5Zfilter_avail(ZstdFilter) <= 0) {
+        ops_printf(
+            "Warning! The zstd filter is not available, the %s are compressed "
+            "by deflate!\n",
+            family.c_str());
+        checked.zstd = false;
+    }
+    if (IsCompressed(checked)) {
+        ops_printf(
+            "The %s are compressed at the level %i with the error bound %g\n",
+            family.c_str(), checked.level, checked.errorBound);
+    }
+    return checked;
+}
+
+void DefineCheckpointCompression(const CheckpointCompression& macroVar,
+                                 const CheckpointCompression& distribution,
+                                 const CheckpointCompression& nodeProperty) {
+    MACROVARCOMPRESSION =
+        CheckCompression(macroVar, "macroscopic variables", true);
+    DISTRIBUTIONCOMPRESSION =
+        CheckCompression(distribution, "distributions", false);
+    NODEPROPERTYCOMPRESSION =
+        CheckCompression(nodeProperty, "node properties", false);
+    const bool compressed{IsCompressed(MACROVARCOMPRESSION) ||
+                          IsCompressed(DISTRIBUTIONCOMPRESSION) ||
+                          IsCompressed(NODEPROPERTYCOMPRESSION)};
+    if (compressed && !SINGLEFILECHECKPOINT) {
+        ops_printf(
+            "Warning! The checkpoints are only compressed in the single file "
+            "layout, see DefineCheckpoint!\n");
+    }
+}
+
+void DefineCompactRestart(const bool compact) {
+    COMPACTRESTART = compact;
+    if (!COMPACTRESTART) {
+        return;
+    }
+    if (!CompactRestartSupported()) {
+        ops_printf(
+            "Error! The compact restart requires the isothermal BGK model for "
+            "all the components!\n");
+        assert(CompactRestartSupported());
+    }
+    DefineRestartMoments();
+    ops_printf(
+        "The checkpoints store %i moments per node and component rather than "
+        "the distributions.\n",
+        RestartMomentNum());
+}
+
+void DefineOutputPeriods(const SizeType macroVarPeriod,
+                         const SizeType distributionPeriod,
+                         const SizeType nodePropertyPeriod) {
+    MACROVAROUTPUTPERIOD = macroVarPeriod;
+    DISTRIBUTIONOUTPUTPERIOD = distributionPeriod;
+    NODEPROPERTYOUTPUTPERIOD = nodePropertyPeriod;
+    if (NODEPROPERTYOUTPUTPERIOD == 0) {
+        ops_printf(
+            "The node properties are static and written at the starting "
+            "step only.\n");
+    }
+}
+
+void DefineSnapshots(const SizeType period, const int keepNum) {
+    if (keepNum < 1) {
+        ops_printf("Error! At least one snapshot shall be kept but %i is set\n",
+                   keepNum);
+        assert(keepNum >= 1);
+    }
+    SNAPSHOTPERIOD = period;
+    SNAPSHOTKEEPNUM = keepNum;
+    if (SNAPSHOTPERIOD > 0) {
+        ops_printf(
+            "A snapshot is written every %zu steps and the latest %i are "
+            "kept.\n",
+            SNAPSHOTPERIOD, SNAPSHOTKEEPNUM);
+    }
+}
+
+bool IsSnapshotStep(const SizeType timeStep) {
+    return SNAPSHOTPERIOD > 0 && (timeStep % SNAPSHOTPERIOD) == 0;
+}
+
+std::vector<int> ResolveRegionRange(const OutputRegion& region,
+                                    const Block& block) {
+    std::vector<int> range{block.WholeRange()};
+    if (region.type == RegionType::Plane) {
+        const int axis{region.axis};
+        const bool valid{axis >= 0 && axis < SpaceDim() &&
+                         region.position >= range.at(2 * axis) &&
+                         region.position < range.at(2 * axis + 1)};
+        if (!valid) {
+            ops_printf(
+                "Error! The plane %i at the axis %i of the region %s is not "
+                "within the block %s\n",
+                region.position, axis, region.name.c_str(),
+                block.Name().c_str());
+            assert(valid);
+        }
+        range.at(2 * axis) = region.position;
+        range.at(2 * axis + 1) = region.position + 1;
+    }
+    if (region.type == RegionType::Box) {
+        bool valid{(int)region.range.size() == 2 * SpaceDim()};
+        for (int axis = 0; valid && axis < SpaceDim(); axis++) {
+            valid = region.range.at(2 * axis) >= range.at(2 * axis) &&
+                    region.range.at(2 * axis) < region.range.at(2 * axis + 1) &&
+                    region.range.at(2 * axis + 1) <= range.at(2 * axis + 1);
+        }
+        if (!valid) {
+            ops_printf(
+                "Error! The range of the region %s is not a box within the "
+                "block %s\n",
+                region.name.c_str(), block.Name().c_str());
+            assert(valid);
+        }
+        range = region.range;
+    }
+    return range;
+}
+
+std::vector<int> ResolveMacroVarIds(const OutputRegion& region) {
+    std::vector<int> ids;
+    for (const auto& pair : g_MacroVars()) {
+        const std::vector<std::string>& names{region.macroVarNames};
+        if (names.empty() || std::find(names.begin(), names.end(),
+                                       pair.second.Name()) != names.end()) {
+            ids.push_back(pair.first);
+        }
+    }
+    if (ids.size() < region.macroVarNames.size()) {
+        ops_printf(
+            "Error! Some macroscopic variables of the region %s are not "
+            "defined!\n",
+            region.name.c_str());
+        assert(ids.size() == region.macroVarNames.size());
+    }
+    return ids;
+}
+
+void DefineOutputRegions(const std::vector<OutputRegion>& regions) {
+    for (const auto& region : regions) {
+        if (g_Block().find(region.blockId) == g_Block().end()) {
+            ops_printf("Error! The block %i of the region %s is not defined\n",
+                       region.blockId, region.name.c_str());
+            assert(g_Block().find(region.blockId) != g_Block().end());
+        }
+        const Block& block{g_Block().at(region.blockId)};
+        RegionOutput output;
+        output.region = region;
+        output.range = ResolveRegionRange(region, block);
+        output.stride = region.stride;
+        if (output.stride.empty()) {
+            output.stride.assign(SpaceDim(), 1);
+        }
+        bool valid{(int)output.stride.size() == SpaceDim() &&
+                   region.period > 0};
+        for (const auto stride : output.stride) {
+            valid = valid && stride >= 1;
+        }
+        if (!valid) {
+            ops_printf(
+                "Error! The region %s needs a positive period and a positive "
+                "stride for each axis\n",
+                region.name.c_str());
+            assert(valid);
+        }
+        output.macroVarIds = ResolveMacroVarIds(region);
+        std::vector<int> size(SpaceDim(), 0);
+        std::vector<int> base(SpaceDim(), 0);
+        std::vector<int> d_m(SpaceDim(), 0);
+        std::vector<int> d_p(SpaceDim(), 0);
+        for (int axis = 0; axis < SpaceDim(); axis++) {
+            base.at(axis) = output.range.at(2 * axis);
+            size.at(axis) =
+                output.range.at(2 * axis + 1) - output.range.at(2 * axis);
+        }
+        Real* temp{nullptr};
+        const std::string dataName{"Region_" + region.name + "_" +
+                                   block.Name()};
+        output.buffer =
+            ops_decl_dat(block.Get(), output.macroVarIds.size(), size.data(),
+                         base.data(), d_m.data(), d_p.data(), temp, "double",
+                         dataName.c_str());
+        outputRegions.push_back(output);
+        ops_printf(
+            "The region %s of the block %s is written every %zu steps.\n",
+            region.name.c_str(), block.Name().c_str(), region.period);
+    }
+}
+
+bool IsRegionStep(const SizeType timeStep) {
+    for (const auto& output : outputRegions) {
+        if ((timeStep % output.region.period) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool IsDue(const SizeType timeStep, const SizeType period) {
+    return (timeStep % (period == 0 ? CHECKPERIOD : period)) == 0;
+}
+
+// All the parts are due if force is true, whatever their periods
+CheckpointParts DueParts(const SizeType timeStep, const bool force = false) {
+    CheckpointParts parts;
+    parts.macroVars = force || IsDue(timeStep, MACROVAROUTPUTPERIOD);
+    parts.distributions = force || IsDue(timeStep, DISTRIBUTIONOUTPUTPERIOD);
+    if (NODEPROPERTYOUTPUTPERIOD == 0) {
+        parts.nodePropertyLinks = (parts.macroVars || parts.distributions) &&
+                                  (timeStep != STATICNODEPROPERTYSTEP);
+    } else {
+        parts.nodeProperties =
+            force || IsDue(timeStep, NODEPROPERTYOUTPUTPERIOD);
+    }
+    return parts;
+}
+
+bool IsOutputStep(const SizeType timeStep) {
+    const CheckpointParts parts{DueParts(timeStep)};
+    return parts.macroVars || parts.distributions || parts.nodeProperties ||
+           IsSnapshotStep(timeStep) || IsRegionStep(timeStep);
+}
+
+std::string CheckpointFileName(const Block& block, const SizeType timeStep) {
+    if (SINGLEFILECHECKPOINT) {
+        return SingleCheckpointFileName(CaseName(), timeStep);
+    }
+    return CaseName() + "_" + block.Name() + "_T" + std::to_string(timeStep) +
+           ".h5";
+}
+
+/*!
+ * A single checkpoint file is created, i.e., truncated if existing, when it
+ * is first written by this run, and reopened afterwards, e.g., the flow
+ * field of the starting step after its node properties. The caller holds
+ * Hdf5Mutex.
+ */
+hid_t OpenSingleCheckpointFile(const SizeType timeStep) {
+    const std::string fileName{SingleCheckpointFileName(CaseName(), timeStep)};
+    const bool create{createdCheckpointFiles.insert(fileName).second};
+    return OpenCheckpointFile(fileName, true, create);
+}
+
+/*!
+ * The external links store the file name without the directory, which is
+ * found by the HDF5 library relative to the linking file.
+ */
+std::string FileBaseName(const std::string& fileName) {
+    return fileName.substr(fileName.find_last_of('/') + 1);
+}
+
+/*!
+ * Create the external link /blockName/fieldName_blockName in the file at
+ * timeStep pointing to the dataset in the file at STATICNODEPROPERTYSTEP.
+ * If the latter is a link itself, e.g., after restarting, its target is
+ * used so that the links are never chained. The caller holds Hdf5Mutex,
+ * since the links are created either by the main thread or by the writer
+ * thread.
+ */
+void LinkStaticDataToHdf5(const std::string& fieldName,
+                          const SizeType timeStep) {
+    for (const auto& idBlock : g_Block()) {
+        const Block& block{idBlock.second};
+        const std::string group{"/" + block.Name()};
+        const std::string path{group + "/" + fieldName + "_" + block.Name()};
+        const std::string sourceName{
+            CheckpointFileName(block, STATICNODEPROPERTYSTEP)};
+        std::string targetFile{FileBaseName(sourceName)};
+        std::string targetPath{path};
+        const hid_t source{
+            H5Fopen(sourceName.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT)};
+        H5L_info_t info;
+        const bool found{source >= 0 && H5Lget_info(source, path.c_str(),
+                                                    &info, H5P_DEFAULT) >= 0};
+        if (!found) {
+            ops_printf("Error! Cannot find the static data %s in %s\n",
+                       path.c_str(), sourceName.c_str());
+            assert(found);
+        }
+        if (info.type == H5L_TYPE_EXTERNAL) {
+            std::vector<char> value(info.u.val_size);
+            const char* file{nullptr};
+            const char* object{nullptr};
+            H5Lget_val(source, path.c_str(), value.data(), info.u.val_size,
+                       H5P_DEFAULT);
+            H5Lunpack_elink_val(value.data(), info.u.val_size, nullptr,
+                                &file, &object);
+            targetFile = file;
+            targetPath = object;
+        }
+        H5Fclose(source);
+        const std::string fileName{CheckpointFileName(block, timeStep)};
+        const hid_t dest{H5Fopen(fileName.c_str(), H5F_ACC_RDWR, H5P_DEFAULT)};
+        if (dest < 0) {
+            ops_printf("Error! Cannot open %s for linking the static data\n",
+                       fileName.c_str());
+            assert(dest >= 0);
+        }
+        if (H5Lexists(dest, group.c_str(), H5P_DEFAULT) <= 0) {
+            H5Gclose(H5Gcreate2(dest, group.c_str(), H5P_DEFAULT,
+                                H5P_DEFAULT, H5P_DEFAULT));
+        }
+        // A file written again by a rerun of the case keeps its old link
+        if (H5Lexists(dest, path.c_str(), H5P_DEFAULT) > 0) {
+            H5Ldelete(dest, path.c_str(), H5P_DEFAULT);
+        }
+        H5Lcreate_external(targetFile.c_str(), targetPath.c_str(), dest,
+                           path.c_str(), H5P_DEFAULT, H5P_DEFAULT);
+        H5Fclose(dest);
+    }
+}
+
+/*!
+ * In the MPI version, the files are written collectively and the links are
+ * created by the root rank afterwards.
+ */
+void LinkNodePropertiesToHdf5(const SizeType timeStep) {
+#ifdef OPS_MPI
+    MPI_Barrier(OPS_MPI_GLOBAL);
+    if (ops_my_global_rank == 0) {
+#endif
+        LinkStaticDataToHdf5(g_GeometryProperty().Name(), timeStep);
+        for (const auto& pair : g_NodeType()) {
+            LinkStaticDataToHdf5(pair.second.Name(), timeStep);
+        }
+#ifdef OPS_MPI
+    }
+    MPI_Barrier(OPS_MPI_GLOBAL);
+#endif
+}
+
+CheckpointFields FlowFieldOutput() {
+    return CheckpointFields{&g_MacroVars(), &g_CoordinateXYZ(),
+                            &g_MacroBodyforce(), &g_f(),
+                            &g_RestartMoments(), &g_GeometryProperty(),
+                            &g_NodeType()};
+}
+
+/*!
+ * The files of the blocks are written by OPS without any compression.
+ */
+template <typename T>
+void WriteCheckpointField(const Field<T>& field, const CheckpointCompression&,
+                          const std::string& caseName,
+                          const SizeType timeStep) {
+    field.WriteToHDF5(caseName, timeStep);
+}
+
+template <typename T>
+void WriteCheckpointField(const Field<T>& field,
+                          const CheckpointCompression& compression,
+                          const hid_t file) {
+    field.WriteToHDF5(file, compression);
+}
+
+// The asynchronous checkpoints are staged for the writer thread
+template <typename T>
+void WriteCheckpointField(const Field<T>& field,
+                          const CheckpointCompression& compression,
+                          CheckpointBuffer& buffer) {
+    field.StageToHost(compression, buffer.datasets, buffer.datasetNum);
+}
+
+// The snapshots are never compressed
+template <typename T>
+void WriteCheckpointField(const Field<T>& field, const CheckpointCompression&,
+                          SnapshotWriter& writer) {
+    field.WriteToSnapshot(writer);
+}
+
+/*!
+ * The target is either the case name and step for the files of the blocks,
+ * an opened single file, a staging buffer or a snapshot, see
+ * WriteCheckpointField. The order
+ * must be the same as WriteFlowfieldToHdf5, WriteDistributionsToHdf5 and
+ * WriteNodePropertyToHdf5.
+ */
+template <typename... Target>
+void WriteCheckpointParts(const CheckpointFields& fields,
+                          const CheckpointParts& parts, Target&&... target) {
+    if (parts.macroVars) {
+        for (const auto& macroVar : *fields.macroVars) {
+            WriteCheckpointField(macroVar.second, MACROVARCOMPRESSION,
+                                 target...);
+        }
+        // Only the macroscopic variables may be lossy
+        CheckpointCompression lossless{MACROVARCOMPRESSION};
+        lossless.errorBound = 0;
+        WriteCheckpointField(*fields.coordinateXYZ, lossless, target...);
+        for (const auto& force : *fields.macroBodyforce) {
+            WriteCheckpointField(force.second, lossless, target...);
+        }
+    }
+    if (parts.distributions && COMPACTRESTART) {
+        for (const auto& pair : *fields.restartMoments) {
+            WriteCheckpointField(pair.second, DISTRIBUTIONCOMPRESSION,
+                                 target...);
+        }
+    } else if (parts.distributions) {
+        WriteCheckpointField(*fields.f, DISTRIBUTIONCOMPRESSION, target...);
+    }
+    if (parts.nodeProperties) {
+        WriteCheckpointField(*fields.geometryProperty,
+                             NODEPROPERTYCOMPRESSION, target...);
+        for (const auto& pair : *fields.nodeType) {
+            WriteCheckpointField(pair.second, NODEPROPERTYCOMPRESSION,
+                                 target...);
+        }
+    }
+}
+
+void WriteCheckpointFields(const CheckpointFields& fields,
+                           const SizeType timeStep,
+                           const CheckpointParts& parts) {
+    std::lock_guard<std::mutex> lock(Hdf5Mutex());
+    if (SINGLEFILECHECKPOINT) {
+        const hid_t file{OpenSingleCheckpointFile(timeStep)};
+        WriteCheckpointParts(fields, parts, file);
+        H5Fclose(file);
+    } else {
+        WriteCheckpointParts(fields, parts, CaseName(), timeStep);
+        WriteDataLayoutToBlockFiles(timeStep);
+    }
+    if (parts.nodePropertyLinks) {
+        LinkNodePropertiesToHdf5(timeStep);
+    }
+}
+
+/*!
+ * A snapshot holds all the parts so that it is enough for restarting.
+ */
+void WriteSnapshot(const SizeType timeStep) {
+    const std::string fileName{SnapshotFileName(CaseName(), timeStep)};
+    SnapshotWriter writer{fileName, timeStep};
+    CheckpointParts parts;
+    parts.macroVars = true;
+    parts.distributions = true;
+    parts.nodeProperties = true;
+    WriteCheckpointParts(FlowFieldOutput(), parts, writer);
+    writer.Close();
+    snapshotNames.push_back(fileName);
+    while ((int)snapshotNames.size() > SNAPSHOTKEEPNUM) {
+        std::remove(snapshotNames.front().c_str());
+        snapshotNames.pop_front();
+    }
+}
+
+void WriteIntAttribute(const hid_t object, const std::string& name,
+                       const std::vector<int>& values) {
+    if (H5Aexists(object, name.c_str()) > 0) {
+        H5Adelete(object, name.c_str());
+    }
+    const hsize_t size{values.size()};
+    const hid_t space{H5Screate_simple(1, &size, nullptr)};
+    const hid_t attr{H5Acreate2(object, name.c_str(), H5T_NATIVE_INT, space,
+                                H5P_DEFAULT, H5P_DEFAULT)};
+    H5Awrite(attr, H5T_NATIVE_INT, values.data());
+    H5Aclose(attr);
+    H5Sclose(space);
+}
+
+/*!
+ * The buffer is subsampled by the stride of the hyperslab in memory, so
+ * that only the nodes of the region are transferred. The first node of the
+ * local partition on the stride is found from the displacement of the
+ * partition within the buffer. The variable is the component varIdx of the
+ * fetched buffer, which is the fastest axis in the AoS layout and the
+ * slowest one in the SoA layout.
+ */
+void WriteRegionVariable(const hid_t file, const std::string& path,
+                         const RegionOutput& output, const int varIdx,
+                         const std::vector<Real>& buffer) {
+    const int spaceDim{SpaceDim()};
+    std::vector<int> disp(spaceDim, 0);
+    std::vector<int> size(spaceDim, 0);
+    if (ops_dat_get_local_npartitions(output.buffer) > 0) {
+        ops_dat_get_extents(output.buffer, 0, disp.data(), size.data());
+    }
+    std::vector<hsize_t> dims;
+    std::vector<hsize_t> memDims;
+    std::vector<hsize_t> memStart;
+    std::vector<hsize_t> fileStart;
+    std::vector<hsize_t> stride;
+    std::vector<hsize_t> count;
+    SizeType selectedNum{1};
+    for (int axis = spaceDim - 1; axis >= 0; axis--) {
+        const int step{output.stride.at(axis)};
+        const int extent{output.range.at(2 * axis + 1) -
+                         output.range.at(2 * axis)};
+        const int first{(disp.at(axis) + step - 1) / step};
+        const int last{(disp.at(axis) + size.at(axis) + step - 1) / step};
+        dims.push_back((extent + step - 1) / step);
+        memDims.push_back(size.at(axis) > 0 ? size.at(axis) : 1);
+        memStart.push_back(first * step - disp.at(axis));
+        fileStart.push_back(first);
+        stride.push_back(step);
+        count.push_back(last > first ? last - first : 0);
+        selectedNum *= count.back();
+    }
+    std::vector<hsize_t> memCount{count};
+    const int varNum{(int)output.macroVarIds.size()};
+    dims.push_back(1);
+    fileStart.push_back(0);
+    count.push_back(1);
+#ifdef OPS_SOA
+    memDims.insert(memDims.begin(), varNum);
+    memStart.insert(memStart.begin(), varIdx);
+    stride.insert(stride.begin(), 1);
+    memCount.insert(memCount.begin(), 1);
+#else
+    memDims.push_back(varNum);
+    memStart.push_back(varIdx);
+    stride.push_back(1);
+    memCount.push_back(1);
+#endif
+    const hid_t fileSpace{H5Screate_simple(dims.size(), dims.data(), nullptr)};
+    const hid_t memSpace{
+        H5Screate_simple(memDims.size(), memDims.data(), nullptr)};
+    if (selectedNum == 0) {
+        H5Sselect_none(fileSpace);
+        H5Sselect_none(memSpace);
+    } else {
+        H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, fileStart.data(),
+                            nullptr, count.data(), nullptr);
+        H5Sselect_hyperslab(memSpace, H5S_SELECT_SET, memStart.data(),
+                            stride.data(), memCount.data(), nullptr);
+    }
+    const hid_t dataset{
+        H5Lexists(file, path.c_str(), H5P_DEFAULT) > 0
+            ? H5Dopen2(file, path.c_str(), H5P_DEFAULT)
+            : H5Dcreate2(file, path.c_str(), H5T_NATIVE_DOUBLE, fileSpace,
+                         H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT)};
+    const hid_t transfer{CheckpointTransferList()};
+    H5Dwrite(dataset, H5T_NATIVE_DOUBLE, memSpace, fileSpace, transfer,
+             buffer.data());
+    H5Pclose(transfer);
+    H5Dclose(dataset);
+    H5Sclose(memSpace);
+    H5Sclose(fileSpace);
+}
+
+/*!
+ * The regions are written on the main thread, which may overlap the writer
+ * thread of the asynchronous checkpoints.
+ */
+void WriteOutputRegions(const SizeType timeStep) {
+    std::lock_guard<std::mutex> lock(Hdf5Mutex());
+    for (const auto& output : outputRegions) {
+        const OutputRegion& region{output.region};
+        if ((timeStep % region.period) != 0) {
+            continue;
+        }
+        const Block& block{g_Block().at(region.blockId)};
+        const std::string fileName{CaseName() + "_" + region.name + "_T" +
+                                   std::to_string(timeStep) + ".h5"};
+        // A region file is written once per step
+        const hid_t file{OpenCheckpointFile(fileName, true, true)};
+        const std::string group{"/" + block.Name()};
+        if (H5Lexists(file, group.c_str(), H5P_DEFAULT) <= 0) {
+            H5Gclose(H5Gcreate2(file, group.c_str(), H5P_DEFAULT,
+                                H5P_DEFAULT, H5P_DEFAULT));
+        }
+        std::vector<int> start;
+        std::vector<int> count;
+        for (int axis = 0; axis < SpaceDim(); axis++) {
+            const int extent{output.range.at(2 * axis + 1) -
+                             output.range.at(2 * axis)};
+            start.push_back(output.range.at(2 * axis));
+            count.push_back((extent + output.stride.at(axis) - 1) /
+                            output.stride.at(axis));
+        }
+        const hid_t groupId{H5Gopen2(file, group.c_str(), H5P_DEFAULT)};
+        WriteIntAttribute(groupId, "Start", start);
+        WriteIntAttribute(groupId, "Stride", output.stride);
+        WriteIntAttribute(groupId, "Count", count);
+        H5Gclose(groupId);
+        CopyMacroVarsToRegion(output.buffer, output.macroVarIds, block,
+                              output.range);
+        std::vector<int> disp(SpaceDim(), 0);
+        std::vector<int> size(SpaceDim(), 0);
+        SizeType valueNum{0};
+        if (ops_dat_get_local_npartitions(output.buffer) > 0) {
+            ops_dat_get_extents(output.buffer, 0, disp.data(), size.data());
+            valueNum = output.macroVarIds.size();
+            for (const int extent : size) {
+                valueNum *= extent;
+            }
+        }
+        std::vector<Real> buffer(valueNum);
+        if (valueNum > 0) {
+            ops_dat_fetch_data(output.buffer, 0,
+                               reinterpret_cast<char*>(buffer.data()));
+        }
+        for (SizeType varIdx = 0; varIdx < output.macroVarIds.size();
+             varIdx++) {
+            const RealField& macroVar{
+                g_MacroVars().at(output.macroVarIds.at(varIdx))};
+            WriteRegionVariable(
+                file, group + "/" + macroVar.Name() + "_" + block.Name(),
+                output, varIdx, buffer);
+        }
+        H5Fclose(file);
+    }
+}
+
+void StartCheckpoints(const SizeType start, const SizeType checkPeriod) {
+    CHECKPERIOD = checkPeriod;
+    STATICNODEPROPERTYSTEP = start;
+    // In the case of restarting, the node properties are either in the file
+    // of the starting step or linked from there.
+    if (NODEPROPERTYOUTPUTPERIOD == 0 && start == 0) {
+        CheckpointParts parts;
+        parts.nodeProperties = true;
+        WriteCheckpointFields(FlowFieldOutput(), start, parts);
+    }
+}
+
+/*!
+ * Write a staged checkpoint into the single file by plain HDF5 calls, which
+ * is run by the writer thread.
+ */
+void WriteCheckpointBuffer(const CheckpointBuffer& buffer) {
+    std::lock_guard<std::mutex> lock(Hdf5Mutex());
+    const hid_t file{OpenSingleCheckpointFile(buffer.timeStep)};
+    for (SizeType idx = 0; idx < buffer.datasetNum; idx++) {
+        WriteHostDataset(file, buffer.datasets.at(idx));
+    }
+    H5Fclose(file);
+    if (buffer.parts.nodePropertyLinks) {
+        LinkNodePropertiesToHdf5(buffer.timeStep);
+    }
+}
+
+void RunCheckpointWriter() {
+    while (true) {
+        int bufferIdx{-1};
+        {
+            std::unique_lock<std::mutex> lock(checkpointMutex);
+            checkpointCondition.wait(lock, [] {
+                return stopCheckpointWriter || !checkpointQueue.empty();
+            });
+            if (checkpointQueue.empty()) {
+                return;
+            }
+            bufferIdx = checkpointQueue.front();
+            checkpointQueue.pop_front();
+        }
+        WriteCheckpointBuffer(checkpointBuffers.at(bufferIdx));
+        {
+            std::lock_guard<std::mutex> lock(checkpointMutex);
+            checkpointBuffers.at(bufferIdx).busy = false;
+        }
+        checkpointCondition.notify_all();
+    }
+}
+
+void WriteCheckpoint(const SizeType timeStep, const bool force) {
+    if (!(force || IsOutputStep(timeStep))) {
+        return;
+    }
+    const CheckpointParts parts{DueParts(timeStep, force)};
+    const bool snapshot{IsSnapshotStep(timeStep)};
+    if ((parts.distributions || snapshot) && COMPACTRESTART) {
+#ifdef OPS_3D
+        CalcRestartMoments3D();
+#endif
+#ifdef OPS_2D
+        CalcRestartMoments();
+#endif
+    }
+    if (snapshot) {
+        WriteSnapshot(timeStep);
+    }
+    WriteOutputRegions(timeStep);
+    if (!(parts.macroVars || parts.distributions || parts.nodeProperties)) {
+        return;
+    }
+    if (!ASYNCCHECKPOINT) {
+        WriteCheckpointFields(FlowFieldOutput(), timeStep, parts);
+        return;
+    }
+    if (checkpointBuffers.empty()) {
+        checkpointBuffers.resize(CHECKPOINTBUFFERNUM);
+    }
+    if (!checkpointWriter.joinable()) {
+        stopCheckpointWriter = false;
+        checkpointWriter = std::thread(RunCheckpointWriter);
+    }
+    int bufferIdx{-1};
+    {
+        // Backpressure: wait for the writer if all the buffers are in use
+        std::unique_lock<std::mutex> lock(checkpointMutex);
+        checkpointCondition.wait(lock, [&bufferIdx] {
+            for (int idx = 0; idx < CHECKPOINTBUFFERNUM; idx++) {
+                if (!checkpointBuffers.at(idx).busy) {
+                    bufferIdx = idx;
+                    return true;
+                }
+            }
+            return false;
+        });
+        checkpointBuffers.at(bufferIdx).busy = true;
+    }
+    CheckpointBuffer& buffer{checkpointBuffers.at(bufferIdx)};
+    buffer.timeStep = timeStep;
+    buffer.parts = parts;
+    buffer.datasetNum = 0;
+    WriteCheckpointParts(FlowFieldOutput(), parts, buffer);
+    {
+        std::lock_guard<std::mutex> lock(checkpointMutex);
+        checkpointQueue.push_back(bufferIdx);
+    }
+    checkpointCondition.notify_all();
+}
+
+void FinishCheckpoints() {
+    if (!checkpointWriter.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(checkpointMutex);
+        stopCheckpointWriter = true;
+    }
+    checkpointCondition.notify_all();
+    checkpointWriter.join();
+    ops_printf("All the checkpoints are written.\n");
+}
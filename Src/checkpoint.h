@@ -0,0 +1,171 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*! @brief   Declare functions for writing checkpoints
+ * @author  Jianping Meng
+ * @details A checkpoint consists of the flow field, the distribution
+ * functions and the node properties, each of which has its own output
+ * period. It is either written synchronously, or asynchronously where the
+ * fields are fetched into a staging buffer in the host memory and a
+ * background thread writes the buffer while the time loop carries on.
+ */
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+#include <string>
+#include <vector>
+#include "type.h"
+#include "field.h"
+/*!
+ * The shape of an output region on a block.
+ * Plane: the nodes at position along axis, e.g., a mid-plane.
+ * Box: the nodes within range, e.g., around an obstacle.
+ * Volume: all the nodes of the block, which is usually subsampled.
+ */
+enum class RegionType { Plane = 0, Box = 1, Volume = 2 };
+/*!
+ * A region written every period steps rather than the full field, see
+ * DefineOutputRegions.
+ * range: the iteration range of a box, e.g., [xmin, xmax, ymin, ymax].
+ * stride: every stride-th node along each axis is written, 1 if empty.
+ * macroVarNames: the macroscopic variables written, all if empty.
+ */
+struct OutputRegion {
+    std::string name;
+    RegionType type{RegionType::Volume};
+    int blockId{0};
+    int axis{0};
+    int position{0};
+    std::vector<int> range;
+    std::vector<int> stride;
+    SizeType period{1};
+    std::vector<std::string> macroVarNames;
+};
+/*!
+ * Choose how the checkpoints are written.
+ * async: true for the asynchronous mode.
+ * bufferNum: the number of staging buffers, i.e., the maximum number of
+ * checkpoints which are queued. The time loop waits for a free buffer if
+ * all of them are in use. Each buffer holds a host copy of the parts being
+ * written, e.g., including the distribution functions.
+ * singleFile: true for writing a checkpoint into a single file named
+ * caseName_TtimeStep.h5 with a group per block, see
+ * SingleCheckpointFileName, rather than a file per block. A restart reads
+ * the single file if it exists.
+ * Note: the asynchronous mode is not available for the MPI version, where
+ * the HDF5 output is collective, and the synchronous mode is used instead.
+ * The asynchronous checkpoints are always written into the single file,
+ * since the files of the blocks are written by OPS on the main thread.
+ */
+void DefineCheckpoint(const bool async, const int bufferNum = 2,
+                      const bool singleFile = false);
+/*!
+ * Define the compression of the datasets in the single checkpoint file for
+ * the flow field, i.e., the macroscopic variables, the coordinates and the
+ * body forces, the distribution functions and the node properties. The
+ * datasets are chunked and compressed by the HDF5 filters, see
+ * CheckpointCompression, and read back transparently when restarting.
+ * The error bound of the lossy compression only applies to the macroscopic
+ * variables, the coordinates, the body forces, the distributions and the
+ * node properties are always exact. It shall be called after
+ * DefineCheckpoint.
+ */
+void DefineCheckpointCompression(const CheckpointCompression& macroVar,
+                                 const CheckpointCompression& distribution,
+                                 const CheckpointCompression& nodeProperty);
+/*!
+ * Store the density, the velocity and the non-equilibrium momentum flux of
+ * each component rather than the distribution functions in the checkpoints,
+ * i.e., 6 instead of NUMXI values per node in 2D and 10 in 3D. A restart
+ * rebuilds the distributions as the equilibrium plus the Chapman-Enskog
+ * non-equilibrium part, see KerRestoreFromRestartMoments, which requires the
+ * isothermal BGK model for all the components.
+ * It shall be called after DefineComponents and before Partition.
+ */
+void DefineCompactRestart(const bool compact);
+/*!
+ * Define the output periods of the parts of a checkpoint.
+ * macroVarPeriod: the flow field, 0 means the check period.
+ * distributionPeriod: the distribution functions, which are only needed for
+ * restarting and NUMXI times larger than a macroscopic variable, 0 means the
+ * check period.
+ * nodePropertyPeriod: the node properties, 0 means that they are static and
+ * written only once at the starting step, where the later checkpoint files
+ * refer to them by HDF5 external links.
+ * Note: a simulation can only be restarted from a step where the
+ * distribution functions are written.
+ */
+void DefineOutputPeriods(const SizeType macroVarPeriod,
+                         const SizeType distributionPeriod,
+                         const SizeType nodePropertyPeriod = 0);
+/*!
+ * Write a raw snapshot every period steps besides the checkpoints, where 0
+ * switches them off. A snapshot holds all the parts of a checkpoint in a
+ * file per process, see snapshot.h, and only the latest keepNum snapshots
+ * of a run are kept. A restart reads the snapshot of the step if it
+ * exists, which requires the same number of processes, and
+ * ConvertSnapshotsToHDF5 in PostProcess.py converts the snapshots into the
+ * single checkpoint file.
+ */
+void DefineSnapshots(const SizeType period, const int keepNum = 2);
+/*!
+ * Define the regions written besides the checkpoints. A region is extracted
+ * into a buffer covering the region only and written as
+ * caseName_regionName_TtimeStep.h5, where the dataset of a variable is
+ * /blockName/varName_blockName of the subsampled nodes, i.e.,
+ * [nz][ny][nx][1], and the group has the attributes Start, Stride and Count
+ * in the order of x, y and z. It shall be called after DefineMacroVars and
+ * before Partition.
+ */
+void DefineOutputRegions(const std::vector<OutputRegion>& regions);
+/*!
+ * Prepare the checkpoints before the time loop, where start is the starting
+ * step. The static node properties are written if start is 0.
+ */
+void StartCheckpoints(const SizeType start, const SizeType checkPeriod);
+/*!
+ * If any part of the checkpoint, a snapshot or an output region is written
+ * at timeStep.
+ */
+bool IsOutputStep(const SizeType timeStep);
+/*!
+ * Write the parts of the checkpoint which are due at timeStep, or all of
+ * them if force is true, e.g., at the converged step. The files of the
+ * blocks are the same as those written by WriteFlowfieldToHdf5,
+ * WriteDistributionsToHdf5 and WriteNodePropertyToHdf5 except that the
+ * static node properties are external links.
+ */
+void WriteCheckpoint(const SizeType timeStep, const bool force = false);
+/*!
+ * Wait until all the queued checkpoints are written and stop the writer.
+ */
+void FinishCheckpoints();
+#endif  // CHECKPOINT_H
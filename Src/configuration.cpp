@@ -130,9 +130,48 @@ NLOHMANN_JSON_SERIALIZE_ENUM(SchemeType,
                                  {Scheme_E1st2nd, "Scheme_E1st2nd"},
                                  {Scheme_StreamCollision,
                                   "Scheme_StreamCollision"},
+                                 {Scheme_StreamCollisionFusedMoments,
+                                  "Scheme_StreamCollisionFusedMoments"},
+                                 {Scheme_StreamCollisionInPlace,
+                                  "Scheme_StreamCollisionInPlace"},
+                                 {Scheme_StreamCollisionPull,
+                                  "Scheme_StreamCollisionPull"},
                                  {Scheme_I1st2nd, " Scheme_I1st2nd"},
                              });
 
+NLOHMANN_JSON_SERIALIZE_ENUM(RegionType,
+                             {
+                                 {RegionType::Plane, "Plane"},
+                                 {RegionType::Box, "Box"},
+                                 {RegionType::Volume, "Volume"},
+                             });
+
+/*!
+ * The items not given keep the defaults of CheckpointCompression
+ */
+void from_json(const json& item, CheckpointCompression& compression) {
+    compression.level = item.value("Level", compression.level);
+    compression.zstd = item.value("Zstd", compression.zstd);
+    compression.shuffle = item.value("Shuffle", compression.shuffle);
+    compression.errorBound = item.value("ErrorBound", compression.errorBound);
+}
+
+/*!
+ * A region needs its name, and the other items keep the defaults of
+ * OutputRegion if not given
+ */
+void from_json(const json& item, OutputRegion& region) {
+    region.name = item.at("Name").get<std::string>();
+    region.type = item.value("Type", region.type);
+    region.blockId = item.value("BlockIndex", region.blockId);
+    region.axis = item.value("Axis", region.axis);
+    region.position = item.value("Position", region.position);
+    region.range = item.value("Range", region.range);
+    region.stride = item.value("Stride", region.stride);
+    region.period = item.value("Period", region.period);
+    region.macroVarNames = item.value("MacroVarNames", region.macroVarNames);
+}
+
 const Configuration& Config() { return config; }
 
 const json& JsonConfig() { return jsonConfig; }
@@ -181,7 +220,23 @@ void ParseJson() {
         config.startPos.emplace(id, pos);
     }
     Query(config.checkPeriod, "CheckPeriod");
+    Check(config.asyncCheckpoint, "AsyncCheckpoint");
+    Check(config.checkpointBufferNum, "CheckpointBufferNum");
+    Check(config.singleFileCheckpoint, "SingleFileCheckpoint");
+    Check(config.macroVarCompression, "MacroVarCompression");
+    Check(config.distributionCompression, "DistributionCompression");
+    Check(config.nodePropertyCompression, "NodePropertyCompression");
+    Check(config.compactRestart, "CompactRestart");
+    Check(config.snapshotPeriod, "SnapshotPeriod");
+    Check(config.snapshotKeepNum, "SnapshotKeepNum");
+    Check(config.outputRegions, "OutputRegions");
+    Check(config.macroVarOutputPeriod, "MacroVarOutputPeriod");
+    Check(config.distributionOutputPeriod, "DistributionOutputPeriod");
+    Check(config.nodePropertyOutputPeriod, "NodePropertyOutputPeriod");
     Query(config.meshSize, "MeshSize");
+    Check(config.solidTileSize, "SolidTileSize");
+    Check(config.selectiveHalo, "SelectiveHalo");
+    Check(config.blockThreadNum, "BlockThreadNum");
     int boundaryConditionNum{GetBlockBoundaryConditionNum()};
     config.blockBoundaryConfig.resize(boundaryConditionNum);
     for (int bcIdx = 0; bcIdx < boundaryConditionNum; bcIdx++) {
@@ -217,6 +272,7 @@ void ParseJson() {
 
     } else {
         Query(config.convergenceCriteria, "ConvergenceCriteria");
+        Check(config.compressedResidualCopy, "CompressedResidualCopy");
     }
 }
 
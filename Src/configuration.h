@@ -56,6 +56,8 @@
 #include "model_host_device.h"
 #include "flowfield_host_device.h"
 #include "boundary.h"
+#include "field.h"
+#include "checkpoint.h"
 
 /**
  * Structure for holding various input parameters.
@@ -88,12 +90,42 @@ struct Configuration {
     std::vector<VertexType> blockConnectionType;
     std::map<int, std::vector<Real>> startPos;
     Real meshSize;
+    // 0 switches the skipping of the solid tiles off, see SetSolidTileSize.
+    // It only shrinks the iteration ranges, the memory is not reduced
+    int solidTileSize{0};
+    // Exchange only the crossing populations, see SetSelectiveHalo
+    bool selectiveHalo{false};
+    // 1 executes the blocks one after another, see SetBlockThreadNum. More
+    // threads require the OPS diagnostics level at most one and no tiling.
+    int blockThreadNum{1};
     std::vector<Real> tauRef;
     bool transient{true};
     Real convergenceCriteria{-1};
+    bool compressedResidualCopy{false};
     SizeType timeStepsToRun{0};
     SizeType currentTimeStep{0};
     SizeType checkPeriod{1000};
+    bool asyncCheckpoint{false};
+    int checkpointBufferNum{2};
+    // A single file per checkpoint, see DefineCheckpoint
+    bool singleFileCheckpoint{false};
+    // The compression of the single checkpoint file, see
+    // DefineCheckpointCompression
+    CheckpointCompression macroVarCompression;
+    CheckpointCompression distributionCompression;
+    CheckpointCompression nodePropertyCompression;
+    // The moments instead of the distributions, see DefineCompactRestart
+    bool compactRestart{false};
+    // 0 means no snapshot, see DefineSnapshots
+    SizeType snapshotPeriod{0};
+    int snapshotKeepNum{2};
+    // See DefineOutputRegions
+    std::vector<OutputRegion> outputRegions;
+    // 0 means the check period, see DefineOutputPeriods
+    SizeType macroVarOutputPeriod{0};
+    SizeType distributionOutputPeriod{0};
+    // 0 means static node properties
+    SizeType nodePropertyOutputPeriod{0};
     std::vector<BlockBoundary> blockBoundaryConfig;
 };
 /**
@@ -44,6 +44,7 @@
 #include "boundary.h"
 #include "flowfield.h"
 #include "model.h"
+#include "timer.h"
 
 /*
  * In the following routines, there are some variables are defined
@@ -68,86 +69,101 @@
 // }
 
 
-void Iterate(const SizeType steps, const SizeType checkPointPeriod,
-             const SizeType start) {
+/*!
+ * Choose the cycle function according to the scheme defined by
+ * DefineScheme().
+ */
+void (*SchemeCycle())(const Real) {
     const SchemeType scheme = Scheme();
-    ops_printf("Starting the iteration...\n");
     switch (scheme) {
-        case Scheme_StreamCollision: {
-            for (SizeType iter = start; iter < start + steps; iter++) {
-                const Real time{iter * TimeStep()};
-                StreamCollision(time);
-                if (((iter + 1) % checkPointPeriod) == 0) {
-                    ops_printf("%d iterations!\n", iter + 1);
-#ifdef OPS_3D
-                    UpdateMacroVars3D();
-#endif
-#ifdef OPS_2D
-                    UpdateMacroVars();
-#endif
-                    WriteFlowfieldToHdf5((iter + 1));
-                    WriteDistributionsToHdf5((iter + 1));
-                    WriteNodePropertyToHdf5((iter + 1));
-                }
+        case Scheme_StreamCollision:
+            return StreamCollision;
+        case Scheme_StreamCollisionInPlace:
+            return StreamCollisionInPlace;
+        case Scheme_StreamCollisionPull:
+            return StreamCollisionPull;
+        case Scheme_StreamCollisionFusedMoments: {
+            if (FusedCollisionSupported()) {
+                return StreamCollisionFusedMoments;
             }
-        } break;
+            ops_printf(
+                "Warning! The fused moment-collision kernel does not support "
+                "the defined components, the standard stream-collision "
+                "scheme is used instead!\n");
+            return StreamCollision;
+        }
         default:
+            ops_printf("Error! The chosen scheme is not implemented!\n");
+            assert(false);
             break;
     }
-    ops_printf("Simulation finished! Exiting...\n");
-    DestroyModel();
+    return StreamCollision;
+}
 
+void Iterate(const SizeType steps, const SizeType checkPointPeriod,
+             const SizeType start) {
+    Iterate(SchemeCycle(), steps, checkPointPeriod, start);
 }
 
 void Iterate(const Real convergenceCriteria, const SizeType checkPointPeriod,
              const SizeType start) {
-    const SchemeType scheme = Scheme();
     ops_printf("Starting the iteration...\n");
-    switch (scheme) {
-        case Scheme_StreamCollision: {
-            SizeType iter{start};
-            Real residualError{1};
-            do {
-                const Real time{iter * TimeStep()};
-                StreamCollision(time);
-                iter = iter + 1;
-                if ((iter % checkPointPeriod) == 0) {
+    Iterate(SchemeCycle(), convergenceCriteria, checkPointPeriod, start);
+}
+
+/*!
+ * The part shared by the stream-collision schemes after the collision:
+ * transfer the halos, stream by stream and implement the boundary
+ * conditions. OPS transfers the halos in a blocking call, so that the
+ * streaming starts after it.
+ */
+static void StreamAndImplementBoundary(void (*stream)()) {
+#if DebugLevel >= 1
+    ops_printf("Updating the halos...\n");
+#endif
+    StartTimer(Timer_HaloTransfer);
+    TransferHalos();
+    StopTimer(Timer_HaloTransfer);
+
+#if DebugLevel >= 1
+    ops_printf("Streaming...\n");
+#endif
+    StartTimer(Timer_Stream);
+    stream();
+    StopTimer(Timer_Stream);
+
+#if DebugLevel >= 1
+    ops_printf("Implementing the boundary conditions...\n");
+#endif
+    StartTimer(Timer_Boundary);
 #ifdef OPS_3D
-                    UpdateMacroVars3D();
+    ImplementBoundary3D();
 #endif
 #ifdef OPS_2D
-                    UpdateMacroVars();
-#endif
-                    CalcResidualError();
-                    residualError = GetMaximumResidual(checkPointPeriod);
-                    DispResidualError(iter, checkPointPeriod);
-                    WriteFlowfieldToHdf5(iter);
-                    WriteDistributionsToHdf5(iter);
-                    WriteNodePropertyToHdf5(iter);
-                }
-            } while (residualError >= convergenceCriteria);
-        } break;
-        default:
-            break;
-    }
-    ops_printf("Simulation finished! Exiting...\n");
-    DestroyModel();
+    ImplementBoundary();
+#endif
+    StopTimer(Timer_Boundary);
 }
 
 void StreamCollision(const Real time) {
 #if DebugLevel >= 1
     ops_printf("Calculating the macroscopic variables...\n");
 #endif
+    StartTimer(Timer_MacroVars);
 #ifdef OPS_3D
     UpdateMacroVars3D();
 #endif
 #ifdef OPS_2D
     UpdateMacroVars();
 #endif
+    StopTimer(Timer_MacroVars);
+    StartTimer(Timer_EnvelopeCopy);
     CopyBlockEnvelopDistribution(g_fStage(), g_f());
+    StopTimer(Timer_EnvelopeCopy);
 #if DebugLevel >= 1
     ops_printf("Calculating the mesoscopic body force term...\n");
 #endif
+    StartTimer(Timer_BodyForce);
     UpdateMacroscopicBodyForce(time);
 #ifdef OPS_3D
     PreDefinedBodyForce3D();
@@ -155,40 +171,142 @@ void StreamCollision(const Real time) {
 #ifdef OPS_2D
     PreDefinedBodyForce();
 #endif
+    StopTimer(Timer_BodyForce);
 #if DebugLevel >= 1
     ops_printf("Calculating the collision term...\n");
 #endif
+    StartTimer(Timer_Collision);
 #ifdef OPS_3D
     PreDefinedCollision3D();
 #endif
 #ifdef OPS_2D
     PreDefinedCollision();
 #endif
+    StopTimer(Timer_Collision);
 
-#if DebugLevel >= 1
-    ops_printf("Updating the halos...\n");
+#ifdef OPS_3D
+    StreamAndImplementBoundary(Stream3D);
 #endif
-    TransferHalos();
+#ifdef OPS_2D
+    StreamAndImplementBoundary(Stream);
+#endif
+}
 
+
+void StreamCollisionFusedMoments(const Real time) {
+    StartTimer(Timer_EnvelopeCopy);
+    CopyBlockEnvelopDistribution(g_fStage(), g_f());
+    StopTimer(Timer_EnvelopeCopy);
 #if DebugLevel >= 1
-    ops_printf("Streaming...\n");
+    ops_printf("Calculating the mesoscopic body force term...\n");
+#endif
+    StartTimer(Timer_BodyForce);
+    UpdateMacroscopicBodyForce(time);
+    StopTimer(Timer_BodyForce);
+#if DebugLevel >= 1
+    ops_printf(
+        "Calculating the macroscopic variables and the collision term...\n");
+#endif
+    StartTimer(Timer_Collision);
+#ifdef OPS_3D
+    FusedCollision3D();
+#endif
+#ifdef OPS_2D
+    FusedCollision();
 #endif
+    StopTimer(Timer_Collision);
+
 #ifdef OPS_3D
-    Stream3D();
+    StreamAndImplementBoundary(Stream3D);
 #endif
 #ifdef OPS_2D
-    Stream();
+    StreamAndImplementBoundary(Stream);
 #endif
+}
 
+void StreamCollisionInPlace(const Real time) {
+    // No CopyBlockEnvelopDistribution: the in-place collision visits every
+    // node of the active tiles including the solid ones, which copy their
+    // populations into the swap array, and TransferHalos fills the halos of
+    // both f and the swap array, so that every value streamed is defined.
 #if DebugLevel >= 1
-    ops_printf("Implementing the boundary conditions...\n");
+    ops_printf("Calculating the mesoscopic body force term...\n");
+#endif
+    StartTimer(Timer_BodyForce);
+    UpdateMacroscopicBodyForce(time);
+    StopTimer(Timer_BodyForce);
+#if DebugLevel >= 1
+    ops_printf(
+        "Calculating the macroscopic variables and the collision term...\n");
+#endif
+    StartTimer(Timer_Collision);
+#ifdef OPS_3D
+    InPlaceCollision3D();
+#endif
+#ifdef OPS_2D
+    InPlaceCollision();
 #endif
+    StopTimer(Timer_Collision);
 
 #ifdef OPS_3D
-    ImplementBoundary3D();
+    StreamAndImplementBoundary(StreamInPlace3D);
 #endif
 #ifdef OPS_2D
-    ImplementBoundary();
+    StreamAndImplementBoundary(StreamInPlace);
 #endif
 }
 
+// Whether g_fStage() holds the post-collision distribution of the current
+// step, i.e., the first step of the pull scheme has been done
+static bool PullCollided{false};
+
+void StreamCollisionPull(const Real time) {
+    if (!PullCollided) {
+        StartTimer(Timer_EnvelopeCopy);
+        CopyBlockEnvelopDistribution(g_fStage(), g_f());
+        StopTimer(Timer_EnvelopeCopy);
+        StartTimer(Timer_BodyForce);
+        UpdateMacroscopicBodyForce(time);
+        StopTimer(Timer_BodyForce);
+        StartTimer(Timer_Collision);
+#ifdef OPS_3D
+        FusedCollision3D();
+#endif
+#ifdef OPS_2D
+        FusedCollision();
+#endif
+        StopTimer(Timer_Collision);
+        PullCollided = true;
+    }
+    // The collision in this step is for the next one
+    StartTimer(Timer_BodyForce);
+    UpdateMacroscopicBodyForce(time + TimeStep());
+    StopTimer(Timer_BodyForce);
+
+#ifdef OPS_3D
+    StreamAndImplementBoundary(PullStreamCollision3D);
+#endif
+#ifdef OPS_2D
+    StreamAndImplementBoundary(PullStreamCollision);
+#endif
+
+    // The block surfaces are out of the Fluid boxes and are copied before
+    // their collision as in StreamCollision
+    StartTimer(Timer_EnvelopeCopy);
+    CopyBlockEnvelopDistribution(g_fNext(), g_f());
+    StopTimer(Timer_EnvelopeCopy);
+#if DebugLevel >= 1
+    ops_printf(
+        "Calculating the macroscopic variables and the collision term of "
+        "the other nodes...\n");
+#endif
+    StartTimer(Timer_Collision);
+#ifdef OPS_3D
+    FusedCollisionNonFluid3D();
+#endif
+#ifdef OPS_2D
+    FusedCollisionNonFluid();
+#endif
+    StopTimer(Timer_Collision);
+    SwapStageDistributions();
+}
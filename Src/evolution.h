@@ -41,6 +41,8 @@
 //#include "boundary.h"
 //#include "flowfield.h"
 //#include "model.h"
+#include "checkpoint.h"
+#include "timer.h"
 //#include "scheme.h"
 #include "type.h"
 #include "field.h"
@@ -68,6 +70,48 @@
  * Overall wrap for stream-collision scheme
  */
 void StreamCollision(const Real time);
+/*!
+ * Choose the cycle function according to the scheme defined by
+ * DefineScheme().
+ */
+void (*SchemeCycle())(const Real);
+/*!
+ * Stream-collision scheme where the macroscopic variables, the body force
+ * term and the collision term are calculated by a single fused kernel.
+ * The streaming is not fused and stays a separate sweep, i.e., f is swept
+ * once for the collision, rather than once by each of UpdateMacroVars,
+ * PreDefinedBodyForce and PreDefinedCollision, and once for the streaming
+ * per time step. Only valid if FusedCollisionSupported() is true.
+ * The boundary conditions are treated in the same way as StreamCollision.
+ */
+void StreamCollisionFusedMoments(const Real time);
+/*!
+ * Stream-collision scheme working on g_f() and a half-size swap array, i.e.,
+ * 1.5 rather than 2 copies of the distribution: the fused collision stores
+ * one population of each opposite pair back in f and the other in the swap
+ * array. Three sweeps then stream them, each reading at the neighbours only
+ * a dat which it does not write: f is pulled from the swap array, the swap
+ * array from f, and the swap array is copied back into f, which is in the
+ * natural layout again for the boundary conditions and the output.
+ * Only valid if FusedCollisionSupported() is true.
+ */
+void StreamCollisionInPlace(const Real time);
+/*!
+ * Stream-collision scheme which pulls and collides the Fluid boxes of the bulk
+ * in one loop per block, i.e., each of their populations is read once from
+ * g_fStage() and written once into g_f() and g_fNext() per step, rather than
+ * read and written twice by the separate collision and streaming loops of
+ * StreamCollisionFusedMoments. The post-collision distribution is computed one
+ * step ahead: the first call collides g_f() into g_fStage(), and each call then
+ * streams g_fStage() into g_f(), collides the Fluid boxes into g_fNext() in the
+ * same loop, implements the boundary conditions, collides the other nodes into
+ * g_fNext() and swaps it with g_fStage(). Thus g_f() and the boundary
+ * conditions are the same as StreamCollision after every step, but three copies
+ * of the distribution are kept. The macroscopic variables are the moments of
+ * g_f() after the step. Only valid if FusedCollisionSupported() is true, and
+ * g_f() shall not be changed between the calls.
+ */
+void StreamCollisionPull(const Real time);
 
 void Iterate(const SizeType steps, const SizeType checkPointPeriod,
              const SizeType start = 0);
@@ -78,22 +122,33 @@ template <typename T>
 void Iterate(void (*cycle)(T), const SizeType steps,
              const SizeType checkPointPeriod, const SizeType start = 0) {
     ops_printf("Starting the iteration...\n");
+    StartCheckpoints(start, checkPointPeriod);
+    StartPerformanceMonitor(start);
     for (SizeType iter = start; iter < start + steps; iter++) {
         const Real time{iter * TimeStep()};
         cycle(time);
-        if (((iter + 1) % checkPointPeriod) == 0) {
+        const bool checkStep{((iter + 1) % checkPointPeriod) == 0};
+        if (checkStep) {
             ops_printf("%d iterations!\n", iter + 1);
+        }
+        if (IsOutputStep(iter + 1)) {
+            StartTimer(Timer_MacroVars);
 #ifdef OPS_3D
             UpdateMacroVars3D();
 #endif
 #ifdef OPS_2D
             UpdateMacroVars();
 #endif
-            WriteFlowfieldToHdf5((iter + 1));
-            WriteDistributionsToHdf5((iter + 1));
-            WriteNodePropertyToHdf5((iter + 1));
+            StopTimer(Timer_MacroVars);
+            StartTimer(Timer_Output);
+            WriteCheckpoint(iter + 1);
+            StopTimer(Timer_Output);
+        }
+        if (checkStep) {
+            ReportPerformance(iter + 1);
         }
     }
+    FinishCheckpoints();
     ops_printf("Simulation finished! Exiting...\n");
     DestroyModel();
 }
@@ -103,26 +158,45 @@ void Iterate(void (*cycle)(T), const Real convergenceCriteria,
              const SizeType checkPointPeriod, const SizeType start = 0) {
     SizeType iter{start};
     Real residualError{1};
+    StartCheckpoints(start, checkPointPeriod);
+    StartPerformanceMonitor(start);
     do {
         const Real time{iter * TimeStep()};
         cycle(time);
         iter = iter + 1;
-        if ((iter % checkPointPeriod) == 0) {
+        const bool checkStep{(iter % checkPointPeriod) == 0};
+        const bool outputStep{IsOutputStep(iter)};
+        if (checkStep || outputStep) {
+            StartTimer(Timer_MacroVars);
 #ifdef OPS_3D
             UpdateMacroVars3D();
 #endif
 #ifdef OPS_2D
             UpdateMacroVars();
 #endif
-            CalcResidualError();
-            residualError = GetMaximumResidual(checkPointPeriod);
-            DispResidualError(iter, checkPointPeriod);
-            WriteFlowfieldToHdf5(iter);
-            WriteDistributionsToHdf5(iter);
-            WriteNodePropertyToHdf5(iter);
+            StopTimer(Timer_MacroVars);
+            StartTimer(Timer_Output);
+            if (checkStep) {
+                CalcResidualError();
+                residualError = GetMaximumResidual(checkPointPeriod);
+                DispResidualError(iter, checkPointPeriod);
+            }
+            // The converged step is written below
+            if (outputStep && residualError >= convergenceCriteria) {
+                WriteCheckpoint(iter);
+            }
+            StopTimer(Timer_Output);
+        }
+        if (checkStep) {
+            ReportPerformance(iter);
         }
     } while (residualError >= convergenceCriteria);
-
+    // The converged field is always written, where the macroscopic
+    // variables are up to date as the residual is only checked with them
+    StartTimer(Timer_Output);
+    WriteCheckpoint(iter, true);
+    StopTimer(Timer_Output);
+    FinishCheckpoints();
     ops_printf("Simulation finished! Exiting...\n");
     DestroyModel();
 }
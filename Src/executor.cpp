@@ -0,0 +1,133 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*! @brief   Implementing functions for the pool of threads
+ * @author  Jianping Meng
+ * @details A task is identified by its index in a phase, and the queues
+ * of the threads are filled round-robin when the phase is started.
+ */
+#include "executor.h"
+
+TaskExecutor::TaskExecutor(const int threadNum) {
+    const int poolSize{threadNum > 1 ? threadNum : 1};
+    for (int threadId = 0; threadId < poolSize; threadId++) {
+        queues.emplace_back(new TaskQueue);
+    }
+    for (int threadId = 1; threadId < poolSize; threadId++) {
+        workers.emplace_back(&TaskExecutor::Work, this, threadId);
+    }
+}
+
+TaskExecutor::~TaskExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(phaseMutex);
+        stopping = true;
+    }
+    phaseStarted.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void TaskExecutor::Run(const int taskNum,
+                       const std::function<void(const int)>& task) {
+    if (taskNum <= 0) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(phaseMutex);
+        currentTask = &task;
+        unfinished = taskNum;
+        for (int taskId = 0; taskId < taskNum; taskId++) {
+            TaskQueue& queue{*queues.at(taskId % queues.size())};
+            std::lock_guard<std::mutex> queueLock(queue.mutex);
+            queue.tasks.push_back(taskId);
+        }
+        phase++;
+    }
+    phaseStarted.notify_all();
+    ExecuteTasks(0);
+    std::unique_lock<std::mutex> lock(phaseMutex);
+    phaseFinished.wait(lock, [this] { return unfinished == 0; });
+    currentTask = nullptr;
+}
+
+bool TaskExecutor::NextTask(const int threadId, int& taskId) {
+    const int threadNum{ThreadNum()};
+    {
+        TaskQueue& queue{*queues.at(threadId)};
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            taskId = queue.tasks.front();
+            queue.tasks.pop_front();
+            return true;
+        }
+    }
+    for (int offset = 1; offset < threadNum; offset++) {
+        TaskQueue& queue{*queues.at((threadId + offset) % threadNum)};
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            taskId = queue.tasks.back();
+            queue.tasks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void TaskExecutor::ExecuteTasks(const int threadId) {
+    int taskId{0};
+    while (NextTask(threadId, taskId)) {
+        (*currentTask)(taskId);
+        if (--unfinished == 0) {
+            std::lock_guard<std::mutex> lock(phaseMutex);
+            phaseFinished.notify_all();
+        }
+    }
+}
+
+void TaskExecutor::Work(const int threadId) {
+    SizeType finishedPhase{0};
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(phaseMutex);
+            phaseStarted.wait(lock, [this, finishedPhase] {
+                return stopping || phase != finishedPhase;
+            });
+            if (stopping) {
+                return;
+            }
+            finishedPhase = phase;
+        }
+        ExecuteTasks(threadId);
+    }
+}
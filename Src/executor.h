@@ -0,0 +1,89 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*! @brief   Declare a pool of threads executing independent tasks
+ * @author  Jianping Meng
+ * @details The tasks of a phase, e.g., the kernels of the blocks in a
+ * collision, are dealt to the queues of the threads and a thread steals
+ * from the back of the other queues once its own queue is empty. Run
+ * returns only after all the tasks of the phase are finished, so that the
+ * phases of a time step are still executed one after another.
+ */
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "type.h"
+
+class TaskExecutor {
+   public:
+    /*!
+     * The calling thread works as the first thread of the pool, so that
+     * threadNum - 1 threads are launched.
+     */
+    explicit TaskExecutor(const int threadNum);
+    ~TaskExecutor();
+    TaskExecutor(const TaskExecutor&) = delete;
+    TaskExecutor& operator=(const TaskExecutor&) = delete;
+    /*!
+     * Run task(0), ..., task(taskNum - 1) on the pool and wait until all of
+     * them are finished. It shall be called by one thread at a time.
+     */
+    void Run(const int taskNum, const std::function<void(const int)>& task);
+    int ThreadNum() const { return (int)queues.size(); }
+
+   private:
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<int> tasks;
+    };
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+    std::vector<std::thread> workers;
+    const std::function<void(const int)>* currentTask{nullptr};
+    std::mutex phaseMutex;
+    std::condition_variable phaseStarted;
+    std::condition_variable phaseFinished;
+    // Increased by every Run, so that a worker joins each phase only once
+    SizeType phase{0};
+    std::atomic<int> unfinished{0};
+    bool stopping{false};
+    bool NextTask(const int threadId, int& taskId);
+    void ExecuteTasks(const int threadId);
+    void Work(const int threadId);
+};
+#endif  // EXECUTOR_H
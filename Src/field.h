@@ -38,16 +38,492 @@
  */
 #ifndef FIELD_H
 #define FIELD_H
+#include <cmath>
+#include <fstream>
+#include <functional>
 #include <list>
 #include <map>
+#include <mutex>
 #include <string>
 #include <vector>
 #include "block.h"
+#include "hdf5.h"
 #include "ops_lib_core.h"
 #ifdef OPS_MPI
 #include "ops_mpi_core.h"
 #endif
+#include "snapshot.h"
 #include "type.h"
+/*!
+ * The order of the components of a multi-dimensional field in memory.
+ * AoS: the components at a node are contiguous, i.e., the OPS default.
+ * SoA: each component is contiguous over the block, which helps vectorising
+ * a kernel across neighbouring nodes.
+ * OPS uses a single switch for all the multi-dimensional data so that the
+ * layout is chosen when building, see DATA_LAYOUT in CMakeLists.txt.
+ */
+enum class DataLayout { AoS = 0, SoA = 1 };
+inline const char* DataLayoutName(const DataLayout layout) {
+    return layout == DataLayout::SoA ? "SoA" : "AoS";
+}
+// The layout chosen when building
+inline DataLayout BuildDataLayout() {
+#ifdef OPS_SOA
+    return DataLayout::SoA;
+#else
+    return DataLayout::AoS;
+#endif
+}
+/*!
+ * Transpose the components of nodeNum nodes from the layout from into the
+ * other one, e.g., into the AoS layout of the single checkpoint file.
+ */
+template <typename T>
+void TransposeDataLayout(T* values, const SizeType nodeNum, const int dim,
+                         const DataLayout from) {
+    const std::vector<T> source(values, values + nodeNum * dim);
+    for (SizeType node = 0; node < nodeNum; node++) {
+        for (int comp = 0; comp < dim; comp++) {
+            const SizeType aos{node * dim + comp};
+            const SizeType soa{comp * nodeNum + node};
+            if (from == DataLayout::SoA) {
+                values[aos] = source[soa];
+            } else {
+                values[soa] = source[aos];
+            }
+        }
+    }
+}
+/*!
+ * The layout is recorded as the attribute "Layout" of a dataset, or of the
+ * root group of a file of a block, so that the restarting and the
+ * post-processing can interpret the components. A dataset without the
+ * attribute is in the AoS layout. The single checkpoint file is always in
+ * the AoS layout, and the files of the blocks are in the layout of the
+ * build.
+ */
+inline void WriteDataLayoutToDataset(const hid_t dataset,
+                                     const DataLayout layout) {
+    if (H5Aexists(dataset, "Layout") > 0) {
+        H5Adelete(dataset, "Layout");
+    }
+    const std::string value{DataLayoutName(layout)};
+    const hid_t strType{H5Tcopy(H5T_C_S1)};
+    H5Tset_size(strType, value.size());
+    const hid_t space{H5Screate(H5S_SCALAR)};
+    const hid_t attr{H5Acreate2(dataset, "Layout", strType, space,
+                                H5P_DEFAULT, H5P_DEFAULT)};
+    H5Awrite(attr, strType, value.c_str());
+    H5Aclose(attr);
+    H5Sclose(space);
+    H5Tclose(strType);
+}
+inline DataLayout ReadDataLayoutFromDataset(const hid_t dataset) {
+    DataLayout layout{DataLayout::AoS};
+    if (H5Aexists(dataset, "Layout") > 0) {
+        const hid_t attr{H5Aopen(dataset, "Layout", H5P_DEFAULT)};
+        const hid_t strType{H5Aget_type(attr)};
+        std::string value(H5Tget_size(strType), '\0');
+        H5Aread(attr, strType, &value[0]);
+        if (value == DataLayoutName(DataLayout::SoA)) {
+            layout = DataLayout::SoA;
+        }
+        H5Tclose(strType);
+        H5Aclose(attr);
+    }
+    return layout;
+}
+/*!
+ * The file of a block is written by OPS, so that the layout is recorded
+ * once at its root group after all the fields are written rather than
+ * reopening the file for each field. In the MPI version, the root rank
+ * writes it after the collective output.
+ */
+inline void WriteDataLayoutToHdf5(const std::string& fileName,
+                                  const DataLayout layout) {
+#ifdef OPS_MPI
+    MPI_Barrier(OPS_MPI_GLOBAL);
+    if (ops_my_global_rank == 0) {
+#endif
+        const hid_t file{
+            H5Fopen(fileName.c_str(), H5F_ACC_RDWR, H5P_DEFAULT)};
+        if (file < 0) {
+            ops_printf("Error! Cannot open %s for writing the data layout\n",
+                       fileName.c_str());
+            assert(file >= 0);
+        }
+        WriteDataLayoutToDataset(file, layout);
+        H5Fclose(file);
+#ifdef OPS_MPI
+    }
+    MPI_Barrier(OPS_MPI_GLOBAL);
+#endif
+}
+inline DataLayout ReadDataLayoutFromHdf5(const std::string& fileName,
+                                         const std::string& path) {
+    const hid_t file{H5Fopen(fileName.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT)};
+    if (file < 0) {
+        ops_printf("Error! Cannot open %s for reading the data layout\n",
+                   fileName.c_str());
+        assert(file >= 0);
+    }
+    // The attribute of a dataset is found in the files of older versions
+    const hid_t dataset{H5Dopen2(file, path.c_str(), H5P_DEFAULT)};
+    const DataLayout layout{H5Aexists(dataset, "Layout") > 0
+                                ? ReadDataLayoutFromDataset(dataset)
+                                : ReadDataLayoutFromDataset(file)};
+    H5Dclose(dataset);
+    H5Fclose(file);
+    return layout;
+}
+/*!
+ * A field may store its values shifted by a constant per component, i.e.,
+ * stored = value - offset, e.g., the distribution functions in single
+ * precision hold f-w_i, see StoreF. The offsets are recorded as the
+ * attribute "Offset" of a dataset, so that the restarting of another build
+ * and the post-processing can recover the values. A dataset without the
+ * attribute is not shifted.
+ */
+inline void WriteOffsetsToDataset(const hid_t dataset,
+                                  const std::vector<Real>& offsets) {
+    if (H5Aexists(dataset, "Offset") > 0) {
+        H5Adelete(dataset, "Offset");
+    }
+    const std::vector<double> values(offsets.begin(), offsets.end());
+    const hsize_t num{values.size()};
+    const hid_t space{H5Screate_simple(1, &num, nullptr)};
+    const hid_t attr{H5Acreate2(dataset, "Offset", H5T_NATIVE_DOUBLE, space,
+                                H5P_DEFAULT, H5P_DEFAULT)};
+    H5Awrite(attr, H5T_NATIVE_DOUBLE, values.data());
+    H5Aclose(attr);
+    H5Sclose(space);
+}
+// The offsets of the dim components of a dataset, which are zero if absent
+inline std::vector<Real> ReadOffsetsFromDataset(const hid_t dataset,
+                                                const int dim) {
+    std::vector<Real> offsets(dim, 0);
+    if (H5Aexists(dataset, "Offset") > 0) {
+        const hid_t attr{H5Aopen(dataset, "Offset", H5P_DEFAULT)};
+        const hid_t space{H5Aget_space(attr)};
+        if (H5Sget_simple_extent_npoints(space) != dim) {
+            ops_printf("Error! The offsets do not match the %i components\n",
+                       dim);
+            assert(H5Sget_simple_extent_npoints(space) == dim);
+        }
+        std::vector<double> values(dim);
+        H5Aread(attr, H5T_NATIVE_DOUBLE, values.data());
+        offsets.assign(values.begin(), values.end());
+        H5Sclose(space);
+        H5Aclose(attr);
+    }
+    return offsets;
+}
+/*!
+ * The dataset at path in the file of a block is written by OPS, so that the
+ * offsets are added afterwards in the same way as WriteDataLayoutToHdf5.
+ */
+inline void WriteOffsetsToHdf5(const std::string& fileName,
+                               const std::string& path,
+                               const std::vector<Real>& offsets) {
+#ifdef OPS_MPI
+    MPI_Barrier(OPS_MPI_GLOBAL);
+    if (ops_my_global_rank == 0) {
+#endif
+        const hid_t file{
+            H5Fopen(fileName.c_str(), H5F_ACC_RDWR, H5P_DEFAULT)};
+        const hid_t dataset{
+            file < 0 ? file : H5Dopen2(file, path.c_str(), H5P_DEFAULT)};
+        if (dataset < 0) {
+            ops_printf("Error! Cannot open %s in %s for writing the offsets\n",
+                       path.c_str(), fileName.c_str());
+            assert(dataset >= 0);
+        }
+        WriteOffsetsToDataset(dataset, offsets);
+        H5Dclose(dataset);
+        H5Fclose(file);
+#ifdef OPS_MPI
+    }
+    MPI_Barrier(OPS_MPI_GLOBAL);
+#endif
+}
+inline std::vector<Real> ReadOffsetsFromHdf5(const std::string& fileName,
+                                             const std::string& path,
+                                             const int dim) {
+    const hid_t file{H5Fopen(fileName.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT)};
+    if (file < 0) {
+        ops_printf("Error! Cannot open %s for reading the offsets\n",
+                   fileName.c_str());
+        assert(file >= 0);
+    }
+    const hid_t dataset{H5Dopen2(file, path.c_str(), H5P_DEFAULT)};
+    const std::vector<Real> offsets{ReadOffsetsFromDataset(dataset, dim)};
+    H5Dclose(dataset);
+    H5Fclose(file);
+    return offsets;
+}
+/*!
+ * A checkpoint may be written into a single file holding all the blocks,
+ * where the dataset of a field has the same path as in the file of a block,
+ * i.e., /blockName/fieldName_blockName, and stores the nodes without the
+ * halos, e.g., [nz][ny][nx][dim] in 3D.
+ */
+inline std::string SingleCheckpointFileName(const std::string& caseName,
+                                            const SizeType timeStep) {
+    return caseName + "_T" + std::to_string(timeStep) + ".h5";
+}
+/*!
+ * Open the single checkpoint file for reading, or for writing where it is
+ * created or truncated if create is true. The caller decides create in the
+ * same way on all the ranks, rather than by checking the file system on
+ * each rank. In the MPI version, the file is accessed through MPI-IO so
+ * that it is opened once by all the ranks.
+ */
+inline hid_t OpenCheckpointFile(const std::string& fileName,
+                                const bool writing,
+                                const bool create = false) {
+    const hid_t access{H5Pcreate(H5P_FILE_ACCESS)};
+#ifdef OPS_MPI
+    H5Pset_fapl_mpio(access, OPS_MPI_GLOBAL, MPI_INFO_NULL);
+#endif
+    hid_t file{-1};
+    if (!writing) {
+        file = H5Fopen(fileName.c_str(), H5F_ACC_RDONLY, access);
+    } else if (create) {
+        file = H5Fcreate(fileName.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT,
+                         access);
+    } else {
+        file = H5Fopen(fileName.c_str(), H5F_ACC_RDWR, access);
+    }
+    H5Pclose(access);
+    if (file < 0) {
+        ops_printf("Error! Cannot open the checkpoint file %s\n",
+                   fileName.c_str());
+        assert(file >= 0);
+    }
+    return file;
+}
+/*!
+ * The partitions of a dataset are transferred collectively in the MPI
+ * version
+ */
+inline hid_t CheckpointTransferList() {
+    const hid_t transfer{H5Pcreate(H5P_DATASET_XFER)};
+#ifdef OPS_MPI
+    H5Pset_dxpl_mpio(transfer, H5FD_MPIO_COLLECTIVE);
+#endif
+    return transfer;
+}
+/*!
+ * The compression of a family of fields in the single checkpoint file.
+ * level: the level of the lossless compression from 1 to 9, where 0
+ * switches it off.
+ * zstd: use the zstd filter plugin instead of deflate if it is available.
+ * shuffle: shuffle the bytes before the lossless compression.
+ * errorBound: the absolute error bound of the lossy compression of the real
+ * fields, where 0 switches it off. The scale-offset filter of HDF5 keeps the
+ * decimal digits needed by the bound and the shuffle is not applied. Only
+ * the macroscopic variables are lossy, see DefineCheckpointCompression.
+ */
+struct CheckpointCompression {
+    int level{0};
+    bool zstd{false};
+    bool shuffle{true};
+    Real errorBound{0};
+};
+// The registered filter of the zstd plugin
+constexpr H5Z_filter_t ZstdFilter{32015};
+inline bool IsCompressed(const CheckpointCompression& compression) {
+    return compression.level > 0 || compression.errorBound > 0;
+}
+/*!
+ * A compressed dataset is chunked by halving its axes from the slowest one
+ * until a chunk is not larger than about 1 MiB, e.g., a few planes of a 3D
+ * block with all the components.
+ */
+inline hid_t CheckpointCreationList(const std::vector<hsize_t>& dims,
+                                    const std::string& type,
+                                    const hid_t dataType,
+                                    const CheckpointCompression& compression) {
+    const hid_t creation{H5Pcreate(H5P_DATASET_CREATE)};
+    const bool lossy{compression.errorBound > 0 &&
+                     (type == "double" || type == "float")};
+    if (compression.level <= 0 && !lossy) {
+        return creation;
+    }
+    const hsize_t maxChunkBytes{1 << 20};
+    std::vector<hsize_t> chunk{dims};
+    hsize_t chunkBytes{H5Tget_size(dataType)};
+    for (const auto size : chunk) {
+        chunkBytes *= (size > 0 ? size : 1);
+    }
+    for (SizeType axis = 0; axis + 1 < chunk.size(); axis++) {
+        while (chunkBytes > maxChunkBytes && chunk.at(axis) > 1) {
+            chunkBytes = chunkBytes / chunk.at(axis);
+            chunk.at(axis) = (chunk.at(axis) + 1) / 2;
+            chunkBytes *= chunk.at(axis);
+        }
+    }
+    for (auto& size : chunk) {
+        size = (size > 0 ? size : 1);
+    }
+    H5Pset_chunk(creation, chunk.size(), chunk.data());
+    if (lossy) {
+        // D-scale: the error is at most half of the last kept decimal digit
+        const int digits{
+            (int)std::ceil(std::log10(0.5 / compression.errorBound))};
+        H5Pset_scaleoffset(creation, H5Z_SO_FLOAT_DSCALE, digits);
+    } else if (compression.shuffle) {
+        H5Pset_shuffle(creation);
+    }
+    if (compression.level > 0) {
+        if (compression.zstd) {
+            const unsigned int level{(unsigned int)compression.level};
+            H5Pset_filter(creation, ZstdFilter, H5Z_FLAG_OPTIONAL, 1, &level);
+        } else {
+            H5Pset_deflate(creation, compression.level);
+        }
+    }
+    return creation;
+}
+inline hid_t Hdf5NativeType(const std::string& type) {
+    if (type == "int") {
+        return H5T_NATIVE_INT;
+    }
+    if (type == "float") {
+        return H5T_NATIVE_FLOAT;
+    }
+    if (type == "short") {
+        return H5T_NATIVE_SHORT;
+    }
+    return H5T_NATIVE_DOUBLE;
+}
+/*!
+ * The HDF5 library is only thread-safe if it is built so. All the HDF5 calls
+ * which may overlap the writer thread of the asynchronous checkpoints are
+ * serialised by this mutex, see checkpoint.cpp.
+ */
+inline std::mutex& Hdf5Mutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+/*!
+ * Open the dataset at path in the single checkpoint file, where the group
+ * and the dataset are created if not existing. A dataset may exist if the
+ * step is written again, e.g., restarting, where the compression does not
+ * apply.
+ */
+inline hid_t OpenCheckpointDataset(const hid_t file, const std::string& group,
+                                   const std::string& path,
+                                   const std::string& type,
+                                   const hid_t fileSpace,
+                                   const std::vector<hsize_t>& dims,
+                                   const CheckpointCompression& compression) {
+    if (H5Lexists(file, group.c_str(), H5P_DEFAULT) <= 0) {
+        H5Gclose(H5Gcreate2(file, group.c_str(), H5P_DEFAULT, H5P_DEFAULT,
+                            H5P_DEFAULT));
+    }
+    if (H5Lexists(file, path.c_str(), H5P_DEFAULT) > 0) {
+        return H5Dopen2(file, path.c_str(), H5P_DEFAULT);
+    }
+    const hid_t creation{
+        CheckpointCreationList(dims, type, Hdf5NativeType(type), compression)};
+    const hid_t dataset{H5Dcreate2(file, path.c_str(), Hdf5NativeType(type),
+                                   fileSpace, H5P_DEFAULT, creation,
+                                   H5P_DEFAULT)};
+    H5Pclose(creation);
+    return dataset;
+}
+/*!
+ * A dataset of the single checkpoint file staged in the host memory, see
+ * Field::StageToHost, which is written by plain HDF5 calls without OPS.
+ * bytes holds the nodes of a block without the halos in the AoS layout.
+ */
+struct HostDataset {
+    std::string group;
+    std::string path;
+    std::string type;
+    std::vector<hsize_t> dims;
+    CheckpointCompression compression;
+    // Empty if the values are not shifted, see WriteOffsetsToDataset
+    std::vector<Real> offsets;
+    std::vector<char> bytes;
+};
+inline void WriteHostDataset(const hid_t file, const HostDataset& staged) {
+    const hid_t fileSpace{
+        H5Screate_simple(staged.dims.size(), staged.dims.data(), nullptr)};
+    const hid_t dataset{OpenCheckpointDataset(file, staged.group, staged.path,
+                                              staged.type, fileSpace,
+                                              staged.dims, staged.compression)};
+    H5Dwrite(dataset, Hdf5NativeType(staged.type), H5S_ALL, H5S_ALL,
+             H5P_DEFAULT, staged.bytes.data());
+    if (staged.dims.back() > 1) {
+        WriteDataLayoutToDataset(dataset, DataLayout::AoS);
+    }
+    if (!staged.offsets.empty()) {
+        WriteOffsetsToDataset(dataset, staged.offsets);
+    }
+    H5Sclose(fileSpace);
+    H5Dclose(dataset);
+}
+/*!
+ * The readers of the fields restarting from the single checkpoint files,
+ * keyed by the file name, see Field::CreateFieldFromFile. A reader refers
+ * to its field so that the field shall not be moved before the reading.
+ */
+inline std::map<std::string, std::vector<std::function<void(const hid_t)>>>&
+CheckpointReaders() {
+    static std::map<std::string,
+                    std::vector<std::function<void(const hid_t)>>>
+        readers;
+    return readers;
+}
+/*!
+ * The readers of the fields restarting from the snapshots in the same way,
+ * see CheckpointReaders
+ */
+inline std::map<std::string,
+                std::vector<std::function<void(const SnapshotReader&)>>>&
+SnapshotReaders() {
+    static std::map<std::string,
+                    std::vector<std::function<void(const SnapshotReader&)>>>
+        readers;
+    return readers;
+}
+/*!
+ * Read the fields restarting from the single checkpoint files or the
+ * snapshots, where each file is opened once. It shall be called after the
+ * partition.
+ */
+inline void ReadCheckpointFields() {
+    for (const auto& fileReaders : CheckpointReaders()) {
+        const hid_t file{OpenCheckpointFile(fileReaders.first, false)};
+        for (const auto& reader : fileReaders.second) {
+            reader(file);
+        }
+        H5Fclose(file);
+    }
+    CheckpointReaders().clear();
+    for (const auto& fileReaders : SnapshotReaders()) {
+        const SnapshotReader snapshot{fileReaders.first};
+        for (const auto& reader : fileReaders.second) {
+            reader(snapshot);
+        }
+    }
+    SnapshotReaders().clear();
+}
+/*!
+ * A halo declared between two blocks: the nodes of fromBlock within
+ * fromRange are copied to the halo nodes of toBlock within toRange, where
+ * surface is the surface of fromBlock connected to toBlock.
+ */
+struct HaloRange {
+    int fromBlock;
+    int toBlock;
+    BoundarySurface surface;
+    std::vector<int> fromRange;
+    std::vector<int> toRange;
+};
+
 template <typename T>
 class Field {
    private:
@@ -57,6 +533,9 @@ class Field {
     int dim{1};
     int haloDepth{1};
     ops_halo_group haloGroup{nullptr};
+    // The halos normal to each axis, see CreateAxisHalos
+    std::map<int, ops_halo_group> axisHaloGroups;
+    std::vector<HaloRange> haloRanges;
 #ifdef OPS_3D
     int spaceDim{3};
 #endif
@@ -64,6 +543,44 @@ class Field {
     int spaceDim{2};
 #endif
     std::string type;
+    DataLayout layout{BuildDataLayout()};
+    // The shift of the stored values, see WriteOffsetsToDataset
+    std::vector<Real> offsets;
+    void ApplyLayout() const;
+    // Whether the values written with fileOffsets are stored in the same way
+    bool IsSameShift(const std::vector<Real>& fileOffsets) const;
+    // Convert the AoS values written with fileOffsets to the shift of the
+    // field
+    void Shift(std::vector<T>& values,
+               const std::vector<Real>& fileOffsets) const;
+    // Declare the halos of the surfaces normal to axis, or all of them if
+    // axis is negative
+    std::vector<ops_halo> DeclareHalos(const int axis);
+    void RecordHaloRange(const int fromBlock, const int toBlock,
+                         const BoundarySurface surface, const int* haloIter,
+                         const int* baseFrom, const int* baseTo);
+    std::string DataPath(const Block& block) const {
+        return "/" + block.Name() + "/" + name + "_" + block.Name();
+    };
+    // The space of a block in the single checkpoint file
+    std::vector<hsize_t> CheckpointDims(const Block& block) const;
+    // Select the local partition of dat in fileSpace and create its space
+    // in memory, where nodeNum is the number of the local nodes
+    hid_t SelectPartition(const ops_dat dat, const hid_t fileSpace,
+                          SizeType& nodeNum) const;
+    // The AoS values of the nodes of a block from the values of a dataset in
+    // rawLayout, where the nodes are surrounded by halo layers
+    std::vector<T> BlockValues(const Block& block, const std::vector<T>& raw,
+                               const int halo,
+                               const DataLayout rawLayout) const;
+    // Set the local partition of a block from the AoS values of its nodes
+    void SetFromBlockValues(const Block& block, const std::vector<T>& values);
+    // Read a file of a block written in the other layout
+    void ReadFromOtherLayout(const hid_t file, const Block& block,
+                             const DataLayout fileLayout);
+    // The entry of the local partition of a block in a snapshot
+    SnapshotEntry LocalSnapshotEntry(const Block& block,
+                                     const ops_dat dat) const;
 
    public:
     Field(const std::string& varName, const int dataDim = 1,
@@ -78,20 +595,91 @@ class Field {
     void CreateFieldFromFile(const std::string& caseName,
                              const BlockGroup& blocks,
                              const SizeType timeStep);
+    /*!
+     * If the field of all the blocks is found in the checkpoint of
+     * timeStep, which is either the single file or the files of the blocks
+     */
+    bool IsInCheckpoint(const std::string& caseName, const BlockGroup& blocks,
+                        const SizeType timeStep) const;
+    /*!
+     * Read a block from an opened single checkpoint file after the
+     * partition, where the halos are left to the halo transfers and
+     * boundary conditions.
+     */
+    void ReadFromHDF5(const hid_t file, const Block& block);
+    /*!
+     * Set the local partitions of all the blocks from a mapped snapshot
+     * after the partition
+     */
+    void ReadFromSnapshot(const SnapshotReader& reader);
     void SetDataDim(const int dataDim) { dim = dataDim; };
     void SetDataHalo(const int halo) { haloDepth = halo; };
     void WriteToHDF5(const std::string& caseName, const SizeType timeStep) const;
+    /*!
+     * Write all the blocks into an opened single checkpoint file, which is
+     * collective in the MPI version. The compression only applies when the
+     * datasets are created.
+     */
+    void WriteToHDF5(const hid_t file,
+                     const CheckpointCompression& compression =
+                         CheckpointCompression{}) const;
+    /*!
+     * Stage all the blocks for the single checkpoint file in the host
+     * memory, which is the only OPS call of an asynchronous checkpoint and
+     * is only available in the sequential version. The datasets are stored
+     * from staged.at(stagedNum) on, where the existing entries are reused
+     * so that their memory is kept between the checkpoints.
+     */
+    void StageToHost(const CheckpointCompression& compression,
+                     std::vector<HostDataset>& staged,
+                     SizeType& stagedNum) const;
+    // Append the local partitions of all the blocks to a snapshot
+    void WriteToSnapshot(SnapshotWriter& writer) const;
     int HaloDepth() const { return haloDepth; };
+    // The bytes allocated for all the blocks including the halos
+    SizeType MemorySize() const;
+    const std::string& Name() const { return name; };
     int DataDim() const { return dim; };
+    // The type string passed to OPS, e.g., "double"
+    const char* Type() const { return type.c_str(); };
+    DataLayout Layout() const { return layout; };
+    /*!
+     * Store the values shifted by the offsets of the components, which must
+     * be set before the field is created from a file
+     */
+    void SetOffsets(const std::vector<Real>& shift) { offsets = shift; };
+    const std::vector<Real>& Offsets() const { return offsets; };
     ~Field(){};
     ops_dat& at(int blockIdx) { return data.at(blockIdx); };
     const ops_dat& at(int blockIdx) const { return data.at(blockIdx); };
+    bool IsAllocated(int blockIdx) const {
+        return data.find(blockIdx) != data.end();
+    };
     ops_dat& operator[](int blockIdx) { return this->at(blockIdx); };
     const ops_dat& operator[](int blockIdx) const { return this->at(blockIdx); };
     void CreateHalos();
     void TransferHalos();
+    /*!
+     * Create one halo group per axis so that the halos normal to an axis
+     * can be transferred separately, e.g., by the selective halo exchange
+     */
+    void CreateAxisHalos();
+    void TransferHalos(const int axis);
+    const std::vector<HaloRange>& HaloRanges() const { return haloRanges; };
 };
 template <typename T>
+SizeType Field<T>::MemorySize() const {
+    SizeType bytes{0};
+    for (const auto& idBlock : dataBlock) {
+        SizeType nodeNum{1};
+        for (const auto nodes : idBlock.second.Size()) {
+            nodeNum *= nodes + 2 * haloDepth;
+        }
+        bytes += nodeNum * dim * sizeof(T);
+    }
+    return bytes;
+}
+template <typename T>
 void Field<T>::TransferHalos() {
     if (haloGroup != nullptr) {
         ops_halo_transfer(haloGroup);
@@ -112,6 +700,9 @@ Field<T>::Field(const std::string& varName, const int dataDim, const int halo) {
     if (name == "d") {
         type = "double";
     }
+    if (name == "s") {
+        type = "short";
+    }
 }
 template <typename T>
 Field<T>::Field(const char* varName, const int dataDim,
@@ -129,10 +720,49 @@ Field<T>::Field(const char* varName, const int dataDim,
     if (name == "d") {
         type = "double";
     }
+    if (name == "s") {
+        type = "short";
+    }
+}
+
+/*!
+ * OPS reads the layout switch when declaring and accessing the
+ * multi-dimensional data, so it is set before any field is created.
+ */
+template <typename T>
+void Field<T>::ApplyLayout() const {
+#ifdef OPS_SOA
+    OPS_instance::getOPSInstance()->OPS_soa = 1;
+#endif
+}
+
+template <typename T>
+bool Field<T>::IsSameShift(const std::vector<Real>& fileOffsets) const {
+    for (int comp = 0; comp < dim; comp++) {
+        const Real offset{offsets.empty() ? 0 : offsets.at(comp)};
+        if (fileOffsets.at(comp) != offset) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename T>
+void Field<T>::Shift(std::vector<T>& values,
+                     const std::vector<Real>& fileOffsets) const {
+    if (IsSameShift(fileOffsets)) {
+        return;
+    }
+    for (SizeType idx = 0; idx < values.size(); idx++) {
+        const int comp{(int)(idx % dim)};
+        const Real offset{offsets.empty() ? 0 : offsets.at(comp)};
+        values[idx] = (T)(values[idx] + fileOffsets.at(comp) - offset);
+    }
 }
 
 template <typename T>
 void Field<T>::CreateFieldFromScratch(const Block& block) {
+    ApplyLayout();
     T* temp{nullptr};
     int* d_p = new int[spaceDim];
     int* d_m = new int[spaceDim];
@@ -166,6 +796,35 @@ void Field<T>::CreateFieldFromScratch(const BlockGroup& blocks) {
 template <typename T>
 void Field<T>::CreateFieldFromFile(const std::string& fileName,
                                    const Block& block) {
+    ApplyLayout();
+    if (dim > 1) {
+        // The file is converted after the partition
+        const DataLayout fileLayout{
+            ReadDataLayoutFromHdf5(fileName, DataPath(block))};
+        const bool sameShift{
+            IsSameShift(ReadOffsetsFromHdf5(fileName, DataPath(block), dim))};
+        if (fileLayout != layout || !sameShift) {
+            if (fileLayout != layout) {
+                ops_printf(
+                    "%s in %s is converted from the %s layout to %s\n",
+                    name.c_str(), fileName.c_str(), DataLayoutName(fileLayout),
+                    DataLayoutName(layout));
+            }
+            if (!sameShift) {
+                ops_printf(
+                    "%s in %s is converted to the offsets of the build\n",
+                    name.c_str(), fileName.c_str());
+            }
+            CreateFieldFromScratch(block);
+            const int blockId{block.ID()};
+            CheckpointReaders()[fileName].push_back(
+                [this, blockId, fileLayout](const hid_t file) {
+                    ReadFromOtherLayout(file, dataBlock.at(blockId),
+                                        fileLayout);
+                });
+            return;
+        }
+    }
     std::string dataName{name + "_" + block.Name()};
     ops_dat localDat = ops_decl_dat_hdf5(block.Get(), dim, type.c_str(),
                                          dataName.c_str(), fileName.c_str());
@@ -182,15 +841,354 @@ void Field<T>::CreateFieldFromFile(const std::string& caseName,
     CreateFieldFromFile(fileName, block);
 }
 
+/*!
+ * The snapshot is preferred if it exists, then the single checkpoint file,
+ * otherwise the files of the blocks are read. The partitions of a field can
+ * only be set after the partition, so that the field is declared here and
+ * read later by ReadCheckpointFields.
+ */
 template <typename T>
 void Field<T>::CreateFieldFromFile(const std::string& caseName,
                                    const BlockGroup& blocks,
                                    const SizeType timeStep) {
+    const std::string snapshotName{SnapshotFileName(caseName, timeStep)};
+    if (std::ifstream{snapshotName}.good()) {
+        CreateFieldFromScratch(blocks);
+        SnapshotReaders()[snapshotName].push_back(
+            [this](const SnapshotReader& reader) { ReadFromSnapshot(reader); });
+        return;
+    }
+    const std::string fileName{SingleCheckpointFileName(caseName, timeStep)};
+    if (std::ifstream{fileName}.good()) {
+        CreateFieldFromScratch(blocks);
+        CheckpointReaders()[fileName].push_back([this](const hid_t file) {
+            for (const auto& idBlock : dataBlock) {
+                ReadFromHDF5(file, idBlock.second);
+            }
+        });
+        return;
+    }
     for (const auto& idBlock : blocks) {
         const Block& block{idBlock.second};
         CreateFieldFromFile(caseName, block, timeStep);
     }
 }
+
+template <typename T>
+bool Field<T>::IsInCheckpoint(const std::string& caseName,
+                              const BlockGroup& blocks,
+                              const SizeType timeStep) const {
+    const std::string snapshotName{SnapshotFileName(caseName, timeStep)};
+    if (std::ifstream{snapshotName}.good()) {
+        const SnapshotReader reader{snapshotName};
+        for (const auto& idBlock : blocks) {
+            const std::string blockName{idBlock.second.Name()};
+            if (reader.Find(name, blockName) == nullptr) {
+                return false;
+            }
+        }
+        return true;
+    }
+    const std::string singleName{SingleCheckpointFileName(caseName, timeStep)};
+    const bool singleFile{std::ifstream{singleName}.good()};
+    for (const auto& idBlock : blocks) {
+        const Block& block{idBlock.second};
+        const std::string fileName{
+            singleFile ? singleName
+                       : caseName + "_" + block.Name() + "_T" +
+                             std::to_string(timeStep) + ".h5"};
+        if (!std::ifstream{fileName}.good()) {
+            return false;
+        }
+        const hid_t file{
+            H5Fopen(fileName.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT)};
+        const std::string group{"/" + block.Name()};
+        const bool found{
+            file >= 0 && H5Lexists(file, group.c_str(), H5P_DEFAULT) > 0 &&
+            H5Lexists(file, DataPath(block).c_str(), H5P_DEFAULT) > 0};
+        if (file >= 0) {
+            H5Fclose(file);
+        }
+        if (!found) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename T>
+std::vector<hsize_t> Field<T>::CheckpointDims(const Block& block) const {
+    const std::vector<int> size{block.Size()};
+    std::vector<hsize_t> dims;
+    for (int axis = spaceDim - 1; axis >= 0; axis--) {
+        dims.push_back(size.at(axis));
+    }
+    dims.push_back(dim);
+    return dims;
+}
+
+/*!
+ * OPS holds at most one partition of a block in a process, whose
+ * displacement and size are found by ops_dat_get_extents. A process without
+ * any node of the block still joins the collective transfer with an empty
+ * selection.
+ */
+template <typename T>
+hid_t Field<T>::SelectPartition(const ops_dat dat, const hid_t fileSpace,
+                                SizeType& nodeNum) const {
+    std::vector<int> disp(spaceDim, 0);
+    std::vector<int> size(spaceDim, 0);
+    if (ops_dat_get_local_npartitions(dat) > 0) {
+        ops_dat_get_extents(dat, 0, disp.data(), size.data());
+    }
+    std::vector<hsize_t> start;
+    std::vector<hsize_t> count;
+    nodeNum = 1;
+    for (int axis = spaceDim - 1; axis >= 0; axis--) {
+        start.push_back(disp.at(axis));
+        count.push_back(size.at(axis));
+        nodeNum *= size.at(axis);
+    }
+    start.push_back(0);
+    count.push_back(dim);
+    const hid_t memSpace{
+        H5Screate_simple(count.size(), count.data(), nullptr)};
+    if (nodeNum == 0) {
+        H5Sselect_none(fileSpace);
+        H5Sselect_none(memSpace);
+    } else {
+        H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, start.data(), nullptr,
+                            count.data(), nullptr);
+    }
+    return memSpace;
+}
+
+template <typename T>
+void Field<T>::ReadFromHDF5(const hid_t file, const Block& block) {
+    const std::string path{DataPath(block)};
+    const hid_t dataset{H5Dopen2(file, path.c_str(), H5P_DEFAULT)};
+    if (dataset < 0) {
+        ops_printf("Error! Cannot find %s in the checkpoint file\n",
+                   path.c_str());
+        assert(dataset >= 0);
+    }
+    const hid_t fileSpace{H5Dget_space(dataset)};
+    const std::vector<hsize_t> dims{CheckpointDims(block)};
+    std::vector<hsize_t> fileDims(H5Sget_simple_extent_ndims(fileSpace));
+    H5Sget_simple_extent_dims(fileSpace, fileDims.data(), nullptr);
+    if (fileDims != dims) {
+        ops_printf("Error! The size of %s does not match the block %s\n",
+                   path.c_str(), block.Name().c_str());
+        assert(fileDims == dims);
+    }
+    // The single files of older versions may be in the SoA layout
+    if (dim > 1 && ReadDataLayoutFromDataset(dataset) == DataLayout::SoA) {
+        H5Sclose(fileSpace);
+        H5Dclose(dataset);
+        ReadFromOtherLayout(file, block, DataLayout::SoA);
+        return;
+    }
+    SizeType nodeNum{0};
+    const hid_t memSpace{SelectPartition(data.at(block.ID()), fileSpace,
+                                         nodeNum)};
+    std::vector<T> buffer(nodeNum * dim);
+    const hid_t transfer{CheckpointTransferList()};
+    H5Dread(dataset, Hdf5NativeType(type), memSpace, fileSpace, transfer,
+            buffer.data());
+    Shift(buffer, ReadOffsetsFromDataset(dataset, dim));
+    if (dim > 1 && layout == DataLayout::SoA) {
+        TransposeDataLayout(buffer.data(), nodeNum, dim, DataLayout::AoS);
+    }
+    if (nodeNum > 0) {
+        ops_dat_set_data(data.at(block.ID()), 0,
+                         reinterpret_cast<char*>(buffer.data()));
+    }
+    H5Pclose(transfer);
+    H5Sclose(memSpace);
+    H5Sclose(fileSpace);
+    H5Dclose(dataset);
+}
+template <typename T>
+std::vector<T> Field<T>::BlockValues(const Block& block,
+                                     const std::vector<T>& raw,
+                                     const int halo,
+                                     const DataLayout rawLayout) const {
+    const std::vector<int> blockSize{block.Size()};
+    SizeType nodeNum{1};
+    SizeType rawNodeNum{1};
+    for (int axis = 0; axis < spaceDim; axis++) {
+        nodeNum *= blockSize.at(axis);
+        rawNodeNum *= blockSize.at(axis) + 2 * halo;
+    }
+    if (raw.size() != rawNodeNum * dim) {
+        ops_printf("Error! The size of %s does not match the block %s\n",
+                   name.c_str(), block.Name().c_str());
+        assert(raw.size() == rawNodeNum * dim);
+    }
+    std::vector<T> values(nodeNum * dim);
+    for (SizeType node = 0; node < nodeNum; node++) {
+        // x is the fastest axis
+        SizeType rest{node};
+        SizeType rawNode{0};
+        SizeType rawStride{1};
+        for (int axis = 0; axis < spaceDim; axis++) {
+            rawNode += (rest % blockSize.at(axis) + halo) * rawStride;
+            rest /= blockSize.at(axis);
+            rawStride *= blockSize.at(axis) + 2 * halo;
+        }
+        for (int comp = 0; comp < dim; comp++) {
+            values.at(node * dim + comp) =
+                raw.at(rawLayout == DataLayout::SoA
+                           ? comp * rawNodeNum + rawNode
+                           : rawNode * dim + comp);
+        }
+    }
+    return values;
+}
+
+template <typename T>
+void Field<T>::SetFromBlockValues(const Block& block,
+                                  const std::vector<T>& values) {
+    const ops_dat dat{data.at(block.ID())};
+    if (ops_dat_get_local_npartitions(dat) == 0) {
+        return;
+    }
+    std::vector<int> disp(spaceDim, 0);
+    std::vector<int> size(spaceDim, 0);
+    ops_dat_get_extents(dat, 0, disp.data(), size.data());
+    const std::vector<int> blockSize{block.Size()};
+    SizeType nodeNum{1};
+    for (int axis = 0; axis < spaceDim; axis++) {
+        nodeNum *= size.at(axis);
+    }
+    std::vector<T> buffer(nodeNum * dim);
+    for (SizeType node = 0; node < nodeNum; node++) {
+        SizeType rest{node};
+        SizeType blockNode{0};
+        SizeType blockStride{1};
+        for (int axis = 0; axis < spaceDim; axis++) {
+            blockNode +=
+                (disp.at(axis) + rest % size.at(axis)) * blockStride;
+            rest /= size.at(axis);
+            blockStride *= blockSize.at(axis);
+        }
+        for (int comp = 0; comp < dim; comp++) {
+            buffer.at(node * dim + comp) = values.at(blockNode * dim + comp);
+        }
+    }
+    if (dim > 1 && layout == DataLayout::SoA) {
+        TransposeDataLayout(buffer.data(), nodeNum, dim, DataLayout::AoS);
+    }
+    if (nodeNum > 0) {
+        ops_dat_set_data(dat, 0, reinterpret_cast<char*>(buffer.data()));
+    }
+}
+
+/*!
+ * The whole dataset is read by every rank since the nodes of a partition
+ * are not contiguous in the other layout. The halo depth of a file of a
+ * block is found from the slowest axis, which excludes the components.
+ */
+template <typename T>
+void Field<T>::ReadFromOtherLayout(const hid_t file, const Block& block,
+                                   const DataLayout fileLayout) {
+    const std::string path{DataPath(block)};
+    const hid_t dataset{H5Dopen2(file, path.c_str(), H5P_DEFAULT)};
+    if (dataset < 0) {
+        ops_printf("Error! Cannot find %s in the checkpoint file\n",
+                   path.c_str());
+        assert(dataset >= 0);
+    }
+    const hid_t fileSpace{H5Dget_space(dataset)};
+    std::vector<hsize_t> fileDims(H5Sget_simple_extent_ndims(fileSpace));
+    H5Sget_simple_extent_dims(fileSpace, fileDims.data(), nullptr);
+    SizeType valueNum{1};
+    for (const auto size : fileDims) {
+        valueNum *= size;
+    }
+    const int halo{
+        ((int)fileDims.at(0) - block.Size().at(spaceDim - 1)) / 2};
+    std::vector<T> raw(valueNum);
+    H5Dread(dataset, Hdf5NativeType(type), H5S_ALL, H5S_ALL, H5P_DEFAULT,
+            raw.data());
+    const std::vector<Real> fileOffsets{ReadOffsetsFromDataset(dataset, dim)};
+    H5Sclose(fileSpace);
+    H5Dclose(dataset);
+    std::vector<T> values{BlockValues(block, raw, halo, fileLayout)};
+    Shift(values, fileOffsets);
+    SetFromBlockValues(block, values);
+}
+/*!
+ * The payload is what ops_dat_fetch_data returns for the local partition,
+ * i.e., the same as the buffer written into the single checkpoint file.
+ * The values keep the shift of the field, see SetOffsets, since a snapshot
+ * is only read by a build of the same type, see IsSameSnapshotShape.
+ */
+template <typename T>
+SnapshotEntry Field<T>::LocalSnapshotEntry(const Block& block,
+                                           const ops_dat dat) const {
+    SnapshotEntry entry{MakeSnapshotEntry(name, block.Name(), type)};
+    entry.blockId = block.ID();
+    entry.spaceDim = spaceDim;
+    entry.dim = dim;
+    entry.typeSize = sizeof(T);
+    entry.layout = (int32_t)layout;
+    std::vector<int> disp(spaceDim, 0);
+    std::vector<int> size(spaceDim, 0);
+    if (ops_dat_get_local_npartitions(dat) > 0) {
+        ops_dat_get_extents(dat, 0, disp.data(), size.data());
+    }
+    const std::vector<int> blockSize{block.Size()};
+    SizeType nodeNum{1};
+    for (int axis = 0; axis < 3; axis++) {
+        const bool inSpace{axis < spaceDim};
+        entry.blockSize[axis] = inSpace ? blockSize.at(axis) : 1;
+        entry.disp[axis] = inSpace ? disp.at(axis) : 0;
+        entry.size[axis] = inSpace ? size.at(axis) : 1;
+        nodeNum *= entry.size[axis];
+    }
+    entry.bytes = nodeNum * dim * sizeof(T);
+    return entry;
+}
+template <typename T>
+void Field<T>::ReadFromSnapshot(const SnapshotReader& reader) {
+    for (const auto& idData : data) {
+        const Block& block{dataBlock.at(idData.first)};
+        const SnapshotEntry local{LocalSnapshotEntry(block, idData.second)};
+        const SnapshotEntry* entry{reader.Find(name, block.Name())};
+        if (entry == nullptr) {
+            ops_printf("Error! Cannot find %s_%s in the snapshot %s\n",
+                       name.c_str(), block.Name().c_str(),
+                       reader.FileName().c_str());
+            assert(entry != nullptr);
+        }
+        // e.g., restarting with another number of processes
+        if (!IsSameSnapshotShape(*entry, local)) {
+            ops_printf(
+                "Error! %s_%s in the snapshot %s does not match the local "
+                "partition\n",
+                name.c_str(), block.Name().c_str(), reader.FileName().c_str());
+            assert(IsSameSnapshotShape(*entry, local));
+        }
+        if (entry->bytes > 0) {
+            // OPS only reads from the mapping
+            ops_dat_set_data(idData.second, 0,
+                             const_cast<char*>(reader.Payload(*entry)));
+        }
+    }
+}
+template <typename T>
+void Field<T>::WriteToSnapshot(SnapshotWriter& writer) const {
+    for (const auto& idData : data) {
+        const Block& block{dataBlock.at(idData.first)};
+        const SnapshotEntry entry{LocalSnapshotEntry(block, idData.second)};
+        char* buffer{writer.Buffer(entry.bytes)};
+        if (entry.bytes > 0) {
+            ops_dat_fetch_data(idData.second, 0, buffer);
+        }
+        writer.Append(entry);
+    }
+}
 template <typename T>
 void Field<T>::WriteToHDF5(const std::string& caseName,
                            const SizeType timeStep) const {
@@ -201,6 +1199,78 @@ void Field<T>::WriteToHDF5(const std::string& caseName,
                                std::to_string(timeStep) + ".h5";
         ops_fetch_block_hdf5_file(block.Get(), fileName.c_str());
         ops_fetch_dat_hdf5_file(idData.second, fileName.c_str());
+        if (!offsets.empty()) {
+            WriteOffsetsToHdf5(fileName, DataPath(block), offsets);
+        }
+    }
+}
+template <typename T>
+void Field<T>::WriteToHDF5(const hid_t file,
+                           const CheckpointCompression& compression) const {
+    const hid_t transfer{CheckpointTransferList()};
+    for (const auto& idData : data) {
+        const Block& block{dataBlock.at(idData.first)};
+        const std::vector<hsize_t> dims{CheckpointDims(block)};
+        const hid_t fileSpace{
+            H5Screate_simple(dims.size(), dims.data(), nullptr)};
+        const hid_t dataset{OpenCheckpointDataset(file, "/" + block.Name(),
+                                                  DataPath(block), type,
+                                                  fileSpace, dims,
+                                                  compression)};
+        SizeType nodeNum{0};
+        const hid_t memSpace{SelectPartition(idData.second, fileSpace,
+                                             nodeNum)};
+        std::vector<T> buffer(nodeNum * dim);
+        if (nodeNum > 0) {
+            ops_dat_fetch_data(idData.second, 0,
+                               reinterpret_cast<char*>(buffer.data()));
+        }
+        if (dim > 1 && layout == DataLayout::SoA) {
+            TransposeDataLayout(buffer.data(), nodeNum, dim, layout);
+        }
+        H5Dwrite(dataset, Hdf5NativeType(type), memSpace, fileSpace,
+                 transfer, buffer.data());
+        if (dim > 1) {
+            WriteDataLayoutToDataset(dataset, DataLayout::AoS);
+        }
+        if (!offsets.empty()) {
+            WriteOffsetsToDataset(dataset, offsets);
+        }
+        H5Sclose(memSpace);
+        H5Sclose(fileSpace);
+        H5Dclose(dataset);
+    }
+    H5Pclose(transfer);
+}
+template <typename T>
+void Field<T>::StageToHost(const CheckpointCompression& compression,
+                           std::vector<HostDataset>& staged,
+                           SizeType& stagedNum) const {
+    for (const auto& idData : data) {
+        const Block& block{dataBlock.at(idData.first)};
+        if (stagedNum == staged.size()) {
+            staged.emplace_back();
+        }
+        HostDataset& dataset{staged.at(stagedNum)};
+        stagedNum++;
+        dataset.group = "/" + block.Name();
+        dataset.path = DataPath(block);
+        dataset.type = type;
+        dataset.dims = CheckpointDims(block);
+        dataset.compression = compression;
+        dataset.offsets = offsets;
+        SizeType valueNum{1};
+        for (const auto size : dataset.dims) {
+            valueNum *= size;
+        }
+        dataset.bytes.resize(valueNum * sizeof(T));
+        if (valueNum > 0) {
+            ops_dat_fetch_data(idData.second, 0, dataset.bytes.data());
+        }
+        if (dim > 1 && layout == DataLayout::SoA) {
+            TransposeDataLayout(reinterpret_cast<T*>(dataset.bytes.data()),
+                                valueNum / dim, dim, layout);
+        }
     }
 }
 /**
@@ -211,9 +1281,59 @@ void Field<T>::WriteToHDF5(const std::string& caseName,
  *
  * The periodic boundary can be treated by setting the neighbor to the
  * block itself.
+ *
+ * The halos are transferred axis by axis: a halo normal to an axis also
+ * covers the halos of the other axes at its edges, so that the corners are
+ * only current if the halos of the earlier axes have been transferred for
+ * all the blocks.
  */
 template <typename T>
 void Field<T>::CreateHalos() {
+    std::vector<ops_halo> halos;
+    for (int axis = 0; axis < spaceDim; axis++) {
+        const std::vector<ops_halo> axisHalos{DeclareHalos(axis)};
+        halos.insert(halos.end(), axisHalos.begin(), axisHalos.end());
+    }
+    if (halos.size() >= 1) {
+        haloGroup = ops_decl_halo_group(halos.size(), halos.data());
+    }
+}
+
+template <typename T>
+void Field<T>::CreateAxisHalos() {
+    for (int axis = 0; axis < spaceDim; axis++) {
+        std::vector<ops_halo> halos{DeclareHalos(axis)};
+        if (halos.size() >= 1) {
+            axisHaloGroups.emplace(
+                axis, ops_decl_halo_group(halos.size(), halos.data()));
+        }
+    }
+}
+
+template <typename T>
+void Field<T>::TransferHalos(const int axis) {
+    if (axisHaloGroups.find(axis) != axisHaloGroups.end()) {
+        ops_halo_transfer(axisHaloGroups.at(axis));
+    }
+}
+
+template <typename T>
+void Field<T>::RecordHaloRange(const int fromBlock, const int toBlock,
+                               const BoundarySurface surface,
+                               const int* haloIter, const int* baseFrom,
+                               const int* baseTo) {
+    HaloRange range{fromBlock, toBlock, surface, {}, {}};
+    for (int axis = 0; axis < spaceDim; axis++) {
+        range.fromRange.push_back(baseFrom[axis]);
+        range.fromRange.push_back(baseFrom[axis] + haloIter[axis]);
+        range.toRange.push_back(baseTo[axis]);
+        range.toRange.push_back(baseTo[axis] + haloIter[axis]);
+    }
+    haloRanges.push_back(range);
+}
+
+template <typename T>
+std::vector<ops_halo> Field<T>::DeclareHalos(const int axis) {
     std::vector<ops_halo> halos;
     for (const auto& idBlock : dataBlock) {
         const int id{idBlock.first};
@@ -235,6 +1355,10 @@ void Field<T>::CreateHalos() {
             const Neighbor& neighbor{surfaceNeighbor.second};
             const BoundarySurface surface{surfaceNeighbor.first};
             const VertexType type{neighbor.type};
+            // Left and Right are normal to x, Top and Bottom to y and so on
+            if (axis >= 0 && (int)surface / 2 != axis) {
+                continue;
+            }
             switch (surface) {
                 case BoundarySurface::Right: {
                     int disp{0};
@@ -260,6 +1384,8 @@ void Field<T>::CreateHalos() {
                         data.at(id), data.at(neighbor.blockId),
                         halo_iter, base_from, base_to, dir, dir);
                     halos.push_back(rightToLeft);
+                    RecordHaloRange(id, neighbor.blockId, surface, halo_iter,
+                                    base_from, base_to);
                 } break;
                 case BoundarySurface::Left: {
                     const int neighborBase{
@@ -287,6 +1413,8 @@ void Field<T>::CreateHalos() {
                         data.at(id), data.at(neighbor.blockId),
                         halo_iter, base_from, base_to, dir, dir);
                     halos.push_back(leftToRight);
+                    RecordHaloRange(id, neighbor.blockId, surface, halo_iter,
+                                    base_from, base_to);
                 } break;
                 case BoundarySurface::Bottom: {
                     const int neighborBase{
@@ -314,6 +1442,8 @@ void Field<T>::CreateHalos() {
                         data.at(id), data.at(neighbor.blockId),
                         halo_iter, base_from, base_to, dir, dir);
                     halos.push_back(botToTop);
+                    RecordHaloRange(id, neighbor.blockId, surface, halo_iter,
+                                    base_from, base_to);
                 } break;
 
                 case BoundarySurface::Top: {
@@ -340,6 +1470,8 @@ void Field<T>::CreateHalos() {
                         data.at(id), data.at(neighbor.blockId),
                         halo_iter, base_from, base_to, dir, dir);
                     halos.push_back(topToBot);
+                    RecordHaloRange(id, neighbor.blockId, surface, halo_iter,
+                                    base_from, base_to);
                 } break;
 #ifdef OPS_3D
                 case BoundarySurface::Back: {
@@ -362,6 +1494,8 @@ void Field<T>::CreateHalos() {
                         data.at(id), data.at(neighbor.blockId),
                         halo_iter, base_from, base_to, dir, dir);
                     halos.push_back(backToFront);
+                    RecordHaloRange(id, neighbor.blockId, surface, halo_iter,
+                                    base_from, base_to);
                 } break;
 
                 case BoundarySurface::Front: {
@@ -382,6 +1516,8 @@ void Field<T>::CreateHalos() {
                         data.at(id), data.at(neighbor.blockId),
                         halo_iter, base_from, base_to, dir, dir);
                     halos.push_back(frontToBack);
+                    RecordHaloRange(id, neighbor.blockId, surface, halo_iter,
+                                    base_from, base_to);
                 } break;
 #endif
                 default:
@@ -389,13 +1525,14 @@ void Field<T>::CreateHalos() {
             }
         }
     }
-    if (halos.size()>=1){
-        haloGroup = ops_decl_halo_group(halos.size(), halos.data());
-    }
+    return halos;
 }
 
 using RealField = Field<Real>;
+using DistributionField = Field<DistReal>;
 using IntField = Field<int>;
 using IntFieldGroup = std::map<int, IntField>;
+using ShortField = Field<short>;
+using ShortFieldGroup = std::map<int, ShortField>;
 using RealFieldGroup = std::map<int, RealField>;
 #endif
\ No newline at end of file
@@ -41,14 +41,19 @@
 #include "ops_mpi_core.h"
 #endif
 #include "flowfield.h"
+#include <algorithm>
 #include <type_traits>
 #include "block.h"
 #include "field.h"
 #include "model.h"
 #include "boundary.h"
 #include "scheme.h"
+#include "step_plan.h"
 std::string CASENAME;
 bool TRANSIENT{false};
+bool COMPRESSEDRESIDUALCOPY{false};
+int SOLIDTILESIZE{0};
+bool SELECTIVEHALO{false};
 /*!
  * SPACEDIM=2 for 2D 3 for three 3D
  */
@@ -59,10 +64,18 @@ int SPACEDIM{3};
 int SPACEDIM{2};
 #endif // ops_2D
 BlockGroup BLOCKS;
-RealField f{"f"};
-RealField fStage{"fStage"};
+DistributionField f{"f"};
+DistributionField fStage{"fStage"};
+// The post-collision distribution of the next step for the pull scheme, and
+// whether it has been swapped with fStage, see SwapStageDistributions
+DistributionField fNext{"fNext"};
+bool StageSwapped{false};
+// The populations crossing the block surfaces, see SetSelectiveHalo
+DistributionField fHalo{"fHalo"};
+std::map<BoundarySurface, std::vector<int>> HaloPopulations;
 RealFieldGroup MacroVars;
 RealFieldGroup MacroVarsCopy;
+std::map<int, Field<float>> MacroVarsCompressedCopy;
 std::map<int,Real> ResidualError;
 std::map<int, ops_reduction> ResidualErrorHandle;
 std::map<int, Real>& g_ResidualError() { return ResidualError; };
@@ -72,11 +85,17 @@ std::map<int, ops_reduction>& g_ResidualErrorHandle() {
 
 RealFieldGroup MacroBodyforce;
 const BlockGroup& g_Block() { return BLOCKS; };
-RealField& g_f() { return f; };
-RealField& g_fStage() { return fStage; };
+DistributionField& g_f() { return f; };
+DistributionField& g_fStage() { return StageSwapped ? fNext : fStage; };
+DistributionField& g_fNext() { return StageSwapped ? fStage : fNext; };
 RealFieldGroup& g_MacroVars() { return MacroVars; };
 RealFieldGroup& g_MacroVarsCopy() { return MacroVarsCopy; };
+std::map<int, Field<float>>& g_MacroVarsCompressedCopy() {
+    return MacroVarsCompressedCopy;
+};
 RealFieldGroup& g_MacroBodyforce() { return MacroBodyforce; };
+RealFieldGroup RestartMoments;
+RealFieldGroup& g_RestartMoments() { return RestartMoments; };
 /**
  * DT: time step
  */
@@ -84,27 +103,175 @@ Real DT{1};
 
 RealField CoordinateXYZ{"CoordinateXYZ"};
 RealField& g_CoordinateXYZ() { return CoordinateXYZ; };
+const RealField& AccelerationField(const int compoId) {
+    if (MacroBodyforce.find(compoId) != MacroBodyforce.end()) {
+        return MacroBodyforce.at(compoId);
+    }
+    if (UsesBodyForceField(g_Components().at(compoId))) {
+        ops_printf("Error! No body force field for Component %i!\n",
+                   compoId);
+        assert(!UsesBodyForceField(g_Components().at(compoId)));
+    }
+    return CoordinateXYZ;
+}
 std::map<SizeType, std::vector<std::vector<Real>>> COORDINATES;
 IntFieldGroup NodeType;
 IntField GeometryProperty{"GeometryProperty"};
 IntFieldGroup& g_NodeType() { return NodeType; };
 IntField& g_GeometryProperty() { return GeometryProperty; };
+ShortFieldGroup NodeDescriptor;
+ShortFieldGroup& g_NodeDescriptor() { return NodeDescriptor; };
 
 void DefineCase(const std::string& caseName, const int spaceDim,
-                const bool transient) {
+                const bool transient, const bool compressedResidualCopy) {
     if (SPACEDIM != spaceDim) {
         ops_printf("Error! The SPACEDIM here is inconsistent with the\n");
         assert(SPACEDIM == spaceDim);
     }
     CASENAME = caseName;
     TRANSIENT = transient;
+    COMPRESSEDRESIDUALCOPY = compressedResidualCopy;
 }
 
 bool IsTransient() { return TRANSIENT; }
 
+bool CompressedResidualCopy() { return COMPRESSEDRESIDUALCOPY; }
+
+void SetSolidTileSize(const int tileSize) {
+    if (tileSize < 0) {
+        ops_printf("Error! The solid tile size %i is negative!\n", tileSize);
+        assert(tileSize >= 0);
+    }
+    SOLIDTILESIZE = tileSize;
+}
+
+int SolidTileSize() { return SOLIDTILESIZE; }
+
+void SetSelectiveHalo(const bool selective) { SELECTIVEHALO = selective; }
+
+bool SelectiveHalo() { return SELECTIVEHALO; }
+
+/*!
+ * The populations pulled by the neighbour from the halo behind a surface
+ * of the sending block, e.g., those with a positive x velocity for Right
+ */
+std::vector<int> CrossingPopulations(const BoundarySurface surface) {
+    const int axis{(int)surface / 2};
+    int sign{1};
+    if (surface == BoundarySurface::Left ||
+        surface == BoundarySurface::Bottom) {
+        sign = -1;
+    }
+#ifdef OPS_3D
+    if (surface == BoundarySurface::Back) {
+        sign = -1;
+    }
+#endif
+    std::vector<int> populations;
+    for (int xiIdx = 0; xiIdx < NUMXI; xiIdx++) {
+        if (sign * XI[xiIdx * LATTDIM + axis] > 0) {
+            populations.push_back(xiIdx);
+        }
+    }
+    return populations;
+}
+
+/*!
+ * Allocate the buffer of the selective halo exchange, which holds the
+ * largest set of crossing populations and exchanges its halos per axis
+ */
+void DefineHaloBuffer() {
+    int populationNum{0};
+    for (int surfaceIdx = 0; surfaceIdx < 2 * SPACEDIM; surfaceIdx++) {
+        const BoundarySurface surface{(BoundarySurface)surfaceIdx};
+        HaloPopulations.emplace(surface, CrossingPopulations(surface));
+        populationNum = std::max(populationNum,
+                                 (int)HaloPopulations.at(surface).size());
+    }
+    fHalo.SetDataDim(populationNum);
+    fHalo.SetDataHalo(fStage.HaloDepth());
+    fHalo.CreateFieldFromScratch(BLOCKS);
+    fHalo.CreateAxisHalos();
+    ops_printf(
+        "The halos exchange %i of %i populations across each block "
+        "surface!\n",
+        populationNum, NUMXI);
+}
+
+std::vector<std::pair<int, std::vector<int>>> ActiveBlockRanges() {
+    std::vector<std::pair<int, std::vector<int>>> blockRanges;
+    for (const auto& idBlock : BLOCKS) {
+        const Block& block{idBlock.second};
+        for (const auto& range : block.ActiveRanges(block.WholeRange())) {
+            blockRanges.emplace_back(idBlock.first, range);
+        }
+    }
+    return blockRanges;
+}
+
+/*!
+ * fStage is allocated after the scheme is chosen: the two-array schemes
+ * need all the populations, while the in-place scheme only keeps one
+ * population of each opposite pair in it (the swap array, see
+ * OppositePairNum) and exchanges the halos of f directly. The pull scheme
+ * also needs fNext, which takes the place of fStage every other step.
+ */
+void DefineStageDistribution() {
+    if (Scheme() == Scheme_StreamCollisionInPlace) {
+        f.CreateHalos();
+        fStage.SetDataDim(OppositePairNum(0, NUMXI - 1));
+        fStage.CreateFieldFromScratch(BLOCKS);
+        fStage.CreateHalos();
+        ops_printf(
+            "The distribution function is updated in place and fStage only "
+            "holds %i of the %i populations!\n",
+            fStage.DataDim(), NUMXI);
+        if (SelectiveHalo()) {
+            ops_printf(
+                "Warning! The in-place scheme exchanges all the populations "
+                "in the halos!\n");
+        }
+    } else if (Scheme() == Scheme_StreamCollisionPull) {
+        fStage.SetDataDim(NUMXI);
+        fStage.CreateFieldFromScratch(BLOCKS);
+        fStage.CreateHalos();
+        fNext.SetDataDim(NUMXI);
+        fNext.CreateFieldFromScratch(BLOCKS);
+        fNext.CreateHalos();
+        ops_printf(
+            "The pull scheme keeps the post-collision distribution of the "
+            "next step in fNext, i.e., three copies of the distribution!\n");
+        if (SelectiveHalo()) {
+            ops_printf(
+                "Warning! The pull scheme exchanges all the populations in "
+                "the halos!\n");
+        }
+    } else {
+        fStage.SetDataDim(NUMXI);
+        fStage.CreateFieldFromScratch(BLOCKS);
+        if (SelectiveHalo()) {
+            DefineHaloBuffer();
+        } else {
+            fStage.CreateHalos();
+        }
+    }
+}
+
 void Partition() {
+    DefineStageDistribution();
     ops_partition((char*)"LBM Solver");
+    ReadCheckpointFields();
     PrepareFlowField();
+    // The distributions are rebuilt with the node descriptors, which are
+    // packed by PrepareFlowField
+    if (RestoringFromMoments()) {
+#ifdef OPS_3D
+        RestoreFromRestartMoments3D();
+#endif
+#ifdef OPS_2D
+        RestoreFromRestartMoments();
+#endif
+    }
 }
 
 /*
@@ -120,10 +287,12 @@ void WriteFlowfieldToHdf5(const SizeType timeStep) {
     for (const auto& force : MacroBodyforce) {
         force.second.WriteToHDF5(CASENAME, timeStep);
     }
+    WriteDataLayoutToBlockFiles(timeStep);
 }
 
 void WriteDistributionsToHdf5(const SizeType timeStep) {
     f.WriteToHDF5(CASENAME, timeStep);
+    WriteDataLayoutToBlockFiles(timeStep);
 }
 
 void WriteNodePropertyToHdf5(const SizeType timeStep) {
@@ -131,6 +300,16 @@ void WriteNodePropertyToHdf5(const SizeType timeStep) {
     for (const auto& pair : NodeType) {
         pair.second.WriteToHDF5(CASENAME, timeStep);
     }
+    WriteDataLayoutToBlockFiles(timeStep);
+}
+
+void WriteDataLayoutToBlockFiles(const SizeType timeStep) {
+    for (const auto& idBlock : g_Block()) {
+        const Block& block{idBlock.second};
+        WriteDataLayoutToHdf5(CASENAME + "_" + block.Name() + "_T" +
+                                  std::to_string(timeStep) + ".h5",
+                              BuildDataLayout());
+    }
 }
 
 const std::string& CaseName() { return CASENAME; }
@@ -155,7 +334,39 @@ Real GetMaximumResidual(const SizeType checkPeriod) {
 }
 
 void TransferHalos() {
-    fStage.TransferHalos();
+    if (Scheme() == Scheme_StreamCollisionInPlace) {
+        f.TransferHalos();
+        fStage.TransferHalos();
+    } else if (Scheme() == Scheme_StreamCollisionPull) {
+        g_fStage().TransferHalos();
+    } else if (SelectiveHalo()) {
+        // Axis by axis, so that the edge and corner halos are filled from
+        // the halos exchanged across the previous axes
+        for (int axis = 0; axis < SPACEDIM; axis++) {
+            for (const auto& halo : fHalo.HaloRanges()) {
+                if ((int)halo.surface / 2 == axis) {
+                    PackHaloPopulations(fHalo, fStage, halo,
+                                        HaloPopulations.at(halo.surface));
+                }
+            }
+            fHalo.TransferHalos(axis);
+            for (const auto& halo : fHalo.HaloRanges()) {
+                if ((int)halo.surface / 2 == axis) {
+                    UnpackHaloPopulations(fStage, fHalo, halo,
+                                          HaloPopulations.at(halo.surface));
+                }
+            }
+        }
+    } else {
+        fStage.TransferHalos();
+    }
+}
+
+void SwapStageDistributions() {
+    StageSwapped = !StageSwapped;
+    for (BlockPlan& plan : StepPlan()) {
+        std::swap(plan.fStage, plan.fNext);
+    }
 }
 
 void DefineBlocks(const std::vector<int>& blockIds,
@@ -239,9 +450,73 @@ void PrepareFlowField() {
         AssignCoordinates(block, COORDINATES.at(blockId));
     }
     SetBoundaryNodeType();
+    PackNodeDescriptors();
+    DecomposeBulkRanges();
     if (!IsTransient()) {
         CopyCurrentMacroVar();
     }
+    ReportFieldMemory();
+}
+
+void DecomposeBulkRanges() {
+    for (auto& idBlock : BLOCKS) {
+        Block& block{idBlock.second};
+        block.DecomposeBulkRange(MarkNonFluidPlanes(block));
+        ops_printf(
+            "The bulk of Block %i is split into %i Fluid and %i boundary "
+            "boxes\n",
+            idBlock.first, (int)block.FluidRanges().size(),
+            (int)block.BulkBoundaryRanges().size());
+        if (SolidTileSize() > 0) {
+            block.SetActiveTiles(SolidTileSize(),
+                                 MarkActiveTiles(block, SolidTileSize()));
+            ops_printf("Block %i is iterated over %i boxes of active tiles\n",
+                       idBlock.first,
+                       (int)block.ActiveRanges(block.WholeRange()).size());
+        }
+    }
+    BuildStepPlan();
+}
+
+template <typename T>
+static SizeType ReportMemory(const Field<T>& field) {
+    const SizeType bytes{field.MemorySize()};
+    if (bytes > 0) {
+        ops_printf("Field %s with halo %i: %.2f MB\n", field.Name().c_str(),
+                   field.HaloDepth(), bytes / (1024.0 * 1024.0));
+    }
+    return bytes;
+}
+
+template <typename T>
+static SizeType ReportMemory(const std::map<int, Field<T>>& fields) {
+    SizeType bytes{0};
+    for (const auto& idField : fields) {
+        bytes += ReportMemory(idField.second);
+    }
+    return bytes;
+}
+
+void ReportFieldMemory() {
+    SizeType bytes{0};
+    bytes += ReportMemory(f);
+    bytes += ReportMemory(fStage);
+    bytes += ReportMemory(fNext);
+    bytes += ReportMemory(fHalo);
+    bytes += ReportMemory(MacroVars);
+    bytes += ReportMemory(MacroVarsCopy);
+    bytes += ReportMemory(MacroVarsCompressedCopy);
+    bytes += ReportMemory(MacroBodyforce);
+    bytes += ReportMemory(CoordinateXYZ);
+    bytes += ReportMemory(NodeType);
+    bytes += ReportMemory(NodeDescriptor);
+    bytes += ReportMemory(GeometryProperty);
+    ops_printf("The fields take %.2f MB in total\n", bytes / (1024.0 * 1024.0));
+    if (SolidTileSize() > 0) {
+        ops_printf(
+            "The solid tiles are only skipped in the computation, the "
+            "fields are allocated for the whole blocks\n");
+    }
 }
 
 void DispResidualError(const int iter, const SizeType checkPeriod) {
@@ -45,21 +45,58 @@
 #define FLOWFIELD_H
 #include <map>
 #include <string>
+#include <utility>
+#include <vector>
 #include "type.h"
 #include "block.h"
 #include "field.h"
 
 const BlockGroup& g_Block();
-RealField& g_f();
-RealField& g_fStage();
+DistributionField& g_f();
+/*!
+ * The distribution before the streaming. The pull scheme keeps the
+ * post-collision distribution of the next step in g_fNext(), and the two
+ * take the place of each other every step, see SwapStageDistributions.
+ */
+DistributionField& g_fStage();
+DistributionField& g_fNext();
 RealFieldGroup& g_MacroVars();
 RealFieldGroup& g_MacroVarsCopy();
+/*!
+ * The copy of macroscopic variables kept in float for calculating the
+ * residual error if CompressedResidualCopy() is true, which replaces
+ * g_MacroVarsCopy() and halves its memory.
+ */
+std::map<int, Field<float>>& g_MacroVarsCompressedCopy();
 
 RealFieldGroup& g_MacroBodyforce();
+/*!
+ * The moments of each component for the compact restart, which are only
+ * allocated if used, see DefineRestartMoments
+ */
+RealFieldGroup& g_RestartMoments();
+/*!
+ * The body force field of a component. Only the components which use it
+ * have one (see UsesBodyForceField and DefineBodyForce). The kernels of the
+ * others receive the coordinates instead, which have the same shape and are
+ * never used as both the body force and the force correction are off. A
+ * component which uses the field but has none is an error.
+ */
+const RealField& AccelerationField(const int compoId);
 
 RealField& g_CoordinateXYZ();
+/*!
+ * The node types and the geometry property are only used for setting up the
+ * nodes and writing them, and the kernels of the time loop and the
+ * initialisation read the node descriptors instead
+ */
 IntFieldGroup& g_NodeType();
 IntField& g_GeometryProperty();
+/*!
+ * The node descriptors of each component, which pack the node type and the
+ * geometry property for the kernels, see PackNodeDescriptor
+ */
+ShortFieldGroup& g_NodeDescriptor();
 Real TimeStep();
 const Real* pTimeStep();
 const std::string& CaseName();
@@ -69,9 +106,8 @@ void SetTimeStep(Real dt);
 
 /**
  * the residual error for steady flows
- * for each macroscopic variable, there are two values: the absolute
- * and relative
- * for each component of a vector, two values are allocated
+ * for each macroscopic variable, the reduction handle accumulates two
+ * values: the square of difference and the square
  */
 std::map<int, Real>& g_ResidualError();
 std::map<int, ops_reduction>& g_ResidualErrorHandle();
@@ -79,12 +115,21 @@ std::map<int, ops_reduction>& g_ResidualErrorHandle();
 void WriteFlowfieldToHdf5(const SizeType timeStep);
 void WriteDistributionsToHdf5(const SizeType timeStep);
 void WriteNodePropertyToHdf5(const SizeType timeStep);
+/*!
+ * Record the layout of the build in the files of the blocks at timeStep,
+ * which is called after the fields are written, see WriteDataLayoutToHdf5
+ */
+void WriteDataLayoutToBlockFiles(const SizeType timeStep);
+void DefineStageDistribution();
 void Partition();
 void PrepareFlowField();
 // caseName: case name
 // spaceDim: 2D or 3D application
+// compressedResidualCopy: keep the copy of macroscopic variables for the
+// residual error in float for steady flows
 void DefineCase(const std::string& caseName, const int spaceDim,
-                const bool transient=false);
+                const bool transient = false,
+                const bool compressedResidualCopy = false);
 Real GetMaximumResidual(const SizeType checkPeriod);
 // blockNum: total number if blocks.
 // blockSize: array of integers specifying the block blocksize.
@@ -99,11 +144,91 @@ void DefineBlocks(const std::vector<int>& blockIds,
                   const std::vector<int>& blockSizes, const Real meshSize,
                   const std::map<int, std::vector<Real>>& startPos);
 bool IsTransient();
+bool CompressedResidualCopy();
 
 void CalcResidualError();
+/*!
+ * The number of nodes updated per time step summed over all the components,
+ * i.e., all the nodes except the immersed solid ones
+ */
+SizeType CountFluidNodes();
+/*!
+ * The planes of the block bulk which have a node other than Fluid for any
+ * component, see Block::DecomposeBulkRange
+ */
+std::vector<std::vector<int>> MarkNonFluidPlanes(const Block& block);
+/*!
+ * Pack the node types and the geometry property into the node descriptors.
+ * It is called by PrepareFlowField and shall be called again if either is
+ * changed afterwards.
+ */
+void PackNodeDescriptors();
+/*!
+ * The tiles of the block which have a node other than ImmersedSolid for
+ * any component, see Block::SetActiveTiles
+ */
+std::vector<int> MarkActiveTiles(const Block& block, const int tileSize);
+/*!
+ * Switch on the skipping of the solid tiles, i.e., tiles of tileSize nodes
+ * along each axis which are fully ImmersedSolid, e.g., in porous media, are
+ * never iterated by the kernels. Zero, the default, switches it off. It is
+ * only an optimisation of the iteration ranges: every field is still
+ * allocated for the whole block, so that the memory is unchanged. It shall
+ * be called before PrepareFlowField.
+ */
+void SetSolidTileSize(const int tileSize);
+int SolidTileSize();
+/*!
+ * Switch on the selective halo exchange of the two-array schemes, where
+ * only the populations which cross a block surface during the streaming
+ * are packed into a buffer and exchanged, one axis after another. It shall
+ * be called before Partition.
+ */
+void SetSelectiveHalo(const bool selective);
+bool SelectiveHalo();
+/*!
+ * Pack the populations of fSrc listed in populations into buffer over the
+ * sending nodes of a halo, and unpack them into the halo nodes of fDest
+ */
+void PackHaloPopulations(DistributionField& buffer,
+                         const DistributionField& fSrc, const HaloRange& halo,
+                         const std::vector<int>& populations);
+void UnpackHaloPopulations(DistributionField& fDest,
+                           const DistributionField& buffer,
+                           const HaloRange& halo,
+                           const std::vector<int>& populations);
+/*!
+ * The block ID and each range for the kernels over the whole range of a
+ * block, i.e., the whole range itself or the active tiles if the solid tiles
+ * are skipped, see Block::ActiveRanges
+ */
+std::vector<std::pair<int, std::vector<int>>> ActiveBlockRanges();
+/*!
+ * Split the bulk range of every block into Fluid and boundary boxes and
+ * find the active tiles if the solid tiles are skipped, then rebuild the
+ * step plan with the new ranges, see step_plan.h. It is called by
+ * PrepareFlowField and shall be called again if the node types are
+ * changed afterwards, e.g., by an embedded body.
+ */
+void DecomposeBulkRanges();
+/*!
+ * Print the memory of every allocated field, which is called by
+ * PrepareFlowField
+ */
+void ReportFieldMemory();
 void DispResidualError(const int iter, const SizeType checkPeriod);
-void CopyDistribution(RealField& fDest, RealField& fSrc);
-void CopyBlockEnvelopDistribution(Field<Real>& fDest, Field<Real>& fSrc);
+void CopyDistribution(DistributionField& fDest, DistributionField& fSrc);
+void CopyBlockEnvelopDistribution(DistributionField& fDest,
+                                  DistributionField& fSrc);
+/*!
+ * Copy the macroscopic variables within range of a block into the
+ * components of buffer in the order of macroVarIds, where buffer is declared
+ * over the range only, e.g., for writing an output region. Up to four
+ * variables are copied by each loop.
+ */
+void CopyMacroVarsToRegion(ops_dat buffer,
+                           const std::vector<int>& macroVarIds,
+                           const Block& block, const std::vector<int>& range);
 void NormaliseF(Real* ratio);
 void CopyCurrentMacroVar();
 void SetBulkandHaloNodesType(const Block& block, int compoId);
@@ -119,4 +244,9 @@ void DefineBlockConnection(const std::vector<int>& fromBlock,
                            const std::vector<BoundarySurface>& toSurface,
                            const std::vector<VertexType>& connectionType);
 void TransferHalos();
+/*!
+ * Swap g_fStage() and g_fNext() together with their dats in the step plan,
+ * which is called by the pull scheme at the end of each step
+ */
+void SwapStageDistributions();
 #endif
@@ -142,6 +142,304 @@ enum VertexGeometryType {
     VG_IMJMKM_O = 1121311,
 
 };  // vg
+/*!
+ * The node descriptor packs the vertex type of a component and the geometry
+ * property of a node into a short, so that a kernel reads one small integer
+ * instead of two int fields. Both are remapped to dense codes, i.e., the
+ * vertex type in the lowest four bits and the geometry in the six bits
+ * above them, see PackNodeDescriptors.
+ */
+static const int VERTEXTYPEBITS{4};
+static const int VERTEXTYPEMASK{(1 << VERTEXTYPEBITS) - 1};
+/*!
+ * The codes of the values without a dense code, which PackNodeDescriptors
+ * reports on the host, so that a kernel never decodes them
+ */
+static const int INVALIDVERTEXTYPECODE{VERTEXTYPEMASK};
+static const int INVALIDGEOMETRYCODE{(1 << 6) - 1};
+
+static inline OPS_FUN_PREFIX int VertexTypeCode(const VertexType vt) {
+    switch (vt) {
+        case VertexType::Fluid:
+            return 0;
+        case VertexType::Inlet:
+            return 1;
+        case VertexType::OutLet:
+            return 2;
+        case VertexType::MDPeriodic:
+            return 3;
+        case VertexType::FDPeriodic:
+            return 4;
+        case VertexType::Symmetry:
+            return 5;
+        case VertexType::Wall:
+            return 6;
+        case VertexType::ImmersedSolid:
+            return 7;
+        case VertexType::ImmersedBoundary:
+            return 8;
+        case VertexType::VirtualBoundary:
+            return 9;
+        default:
+            return INVALIDVERTEXTYPECODE;
+    }
+}
+
+static inline OPS_FUN_PREFIX VertexType CodeToVertexType(const int code) {
+    switch (code) {
+        case 0:
+            return VertexType::Fluid;
+        case 1:
+            return VertexType::Inlet;
+        case 2:
+            return VertexType::OutLet;
+        case 3:
+            return VertexType::MDPeriodic;
+        case 4:
+            return VertexType::FDPeriodic;
+        case 5:
+            return VertexType::Symmetry;
+        case 6:
+            return VertexType::Wall;
+        case 7:
+            return VertexType::ImmersedSolid;
+        case 8:
+            return VertexType::ImmersedBoundary;
+        case 9:
+            return VertexType::VirtualBoundary;
+        default:
+            // Not reached, see INVALIDVERTEXTYPECODE
+            return VertexType::Fluid;
+    }
+}
+
+static inline OPS_FUN_PREFIX int GeometryCode(const VertexGeometryType vg) {
+    switch (vg) {
+        case VG_Fluid:
+            return 0;
+        case VG_ImmersedSolid:
+            return 1;
+        case VG_IP:
+            return 2;
+        case VG_IM:
+            return 3;
+        case VG_JP:
+            return 4;
+        case VG_JM:
+            return 5;
+        case VG_KP:
+            return 6;
+        case VG_KM:
+            return 7;
+        case VG_IPKP_I:
+            return 8;
+        case VG_IPKM_I:
+            return 9;
+        case VG_IMKP_I:
+            return 10;
+        case VG_IMKM_I:
+            return 11;
+        case VG_JPKP_I:
+            return 12;
+        case VG_JPKM_I:
+            return 13;
+        case VG_JMKP_I:
+            return 14;
+        case VG_JMKM_I:
+            return 15;
+        case VG_IPJP_I:
+            return 16;
+        case VG_IPJM_I:
+            return 17;
+        case VG_IMJP_I:
+            return 18;
+        case VG_IMJM_I:
+            return 19;
+        case VG_IPJPKP_I:
+            return 20;
+        case VG_IPJPKM_I:
+            return 21;
+        case VG_IPJMKP_I:
+            return 22;
+        case VG_IPJMKM_I:
+            return 23;
+        case VG_IMJPKP_I:
+            return 24;
+        case VG_IMJPKM_I:
+            return 25;
+        case VG_IMJMKP_I:
+            return 26;
+        case VG_IMJMKM_I:
+            return 27;
+        case VG_IPKP_O:
+            return 28;
+        case VG_IPKM_O:
+            return 29;
+        case VG_IMKP_O:
+            return 30;
+        case VG_IMKM_O:
+            return 31;
+        case VG_JPKP_O:
+            return 32;
+        case VG_JPKM_O:
+            return 33;
+        case VG_JMKP_O:
+            return 34;
+        case VG_JMKM_O:
+            return 35;
+        case VG_IPJP_O:
+            return 36;
+        case VG_IPJM_O:
+            return 37;
+        case VG_IMJP_O:
+            return 38;
+        case VG_IMJM_O:
+            return 39;
+        case VG_IPJPKP_O:
+            return 40;
+        case VG_IPJPKM_O:
+            return 41;
+        case VG_IPJMKP_O:
+            return 42;
+        case VG_IPJMKM_O:
+            return 43;
+        case VG_IMJPKP_O:
+            return 44;
+        case VG_IMJPKM_O:
+            return 45;
+        case VG_IMJMKP_O:
+            return 46;
+        case VG_IMJMKM_O:
+            return 47;
+        default:
+            return INVALIDGEOMETRYCODE;
+    }
+}
+
+static inline OPS_FUN_PREFIX VertexGeometryType CodeToGeometry(const int code) {
+    switch (code) {
+        case 0:
+            return VG_Fluid;
+        case 1:
+            return VG_ImmersedSolid;
+        case 2:
+            return VG_IP;
+        case 3:
+            return VG_IM;
+        case 4:
+            return VG_JP;
+        case 5:
+            return VG_JM;
+        case 6:
+            return VG_KP;
+        case 7:
+            return VG_KM;
+        case 8:
+            return VG_IPKP_I;
+        case 9:
+            return VG_IPKM_I;
+        case 10:
+            return VG_IMKP_I;
+        case 11:
+            return VG_IMKM_I;
+        case 12:
+            return VG_JPKP_I;
+        case 13:
+            return VG_JPKM_I;
+        case 14:
+            return VG_JMKP_I;
+        case 15:
+            return VG_JMKM_I;
+        case 16:
+            return VG_IPJP_I;
+        case 17:
+            return VG_IPJM_I;
+        case 18:
+            return VG_IMJP_I;
+        case 19:
+            return VG_IMJM_I;
+        case 20:
+            return VG_IPJPKP_I;
+        case 21:
+            return VG_IPJPKM_I;
+        case 22:
+            return VG_IPJMKP_I;
+        case 23:
+            return VG_IPJMKM_I;
+        case 24:
+            return VG_IMJPKP_I;
+        case 25:
+            return VG_IMJPKM_I;
+        case 26:
+            return VG_IMJMKP_I;
+        case 27:
+            return VG_IMJMKM_I;
+        case 28:
+            return VG_IPKP_O;
+        case 29:
+            return VG_IPKM_O;
+        case 30:
+            return VG_IMKP_O;
+        case 31:
+            return VG_IMKM_O;
+        case 32:
+            return VG_JPKP_O;
+        case 33:
+            return VG_JPKM_O;
+        case 34:
+            return VG_JMKP_O;
+        case 35:
+            return VG_JMKM_O;
+        case 36:
+            return VG_IPJP_O;
+        case 37:
+            return VG_IPJM_O;
+        case 38:
+            return VG_IMJP_O;
+        case 39:
+            return VG_IMJM_O;
+        case 40:
+            return VG_IPJPKP_O;
+        case 41:
+            return VG_IPJPKM_O;
+        case 42:
+            return VG_IPJMKP_O;
+        case 43:
+            return VG_IPJMKM_O;
+        case 44:
+            return VG_IMJPKP_O;
+        case 45:
+            return VG_IMJPKM_O;
+        case 46:
+            return VG_IMJMKP_O;
+        case 47:
+            return VG_IMJMKM_O;
+        default:
+            // Not reached, see INVALIDGEOMETRYCODE
+            return VG_Fluid;
+    }
+}
+
+static inline OPS_FUN_PREFIX short PackNodeDescriptor(
+    const VertexType vt, const VertexGeometryType vg) {
+    return (short)(VertexTypeCode(vt) | (GeometryCode(vg) << VERTEXTYPEBITS));
+}
+
+static inline OPS_FUN_PREFIX bool IsValidDescriptor(const short descriptor) {
+    return (descriptor & VERTEXTYPEMASK) != INVALIDVERTEXTYPECODE &&
+           (descriptor >> VERTEXTYPEBITS) != INVALIDGEOMETRYCODE;
+}
+
+static inline OPS_FUN_PREFIX VertexType
+DescriptorVertexType(const short descriptor) {
+    return CodeToVertexType(descriptor & VERTEXTYPEMASK);
+}
+
+static inline OPS_FUN_PREFIX VertexGeometryType
+DescriptorGeometry(const short descriptor) {
+    return CodeToGeometry(descriptor >> VERTEXTYPEBITS);
+}
+
 #ifdef OPS_3D
 static inline OPS_FUN_PREFIX int SpaceDim(){return 3;};
 #endif
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <vector>
 #include "flowfield.h"
 #include "flowfield_host_device.h"
@@ -11,84 +12,238 @@ void CopyCurrentMacroVar() {
     for (auto& pair : g_MacroVars()) {
         const int varId{pair.first};
         RealField& macroVar{pair.second};
-        RealField& macroVarCopy{g_MacroVarsCopy().at(varId)};
         for (const auto& idBlock : g_Block()) {
             const Block& block{idBlock.second};
             std::vector<int> iterRng;
             iterRng.assign(block.WholeRange().begin(),
                            block.WholeRange().end());
             const int blockIdx{block.ID()};
-            ops_par_loop(KerCopyMacroVars, "KerCopyMacroVars", block.Get(),
-                         SpaceDim(), iterRng.data(),
-                         ops_arg_dat(macroVar.at(blockIdx), 1, LOCALSTENCIL,
-                                     "double", OPS_READ),
-                         ops_arg_dat(macroVarCopy.at(blockIdx), 1, LOCALSTENCIL,
-                                     "double", OPS_RW));
+            if (CompressedResidualCopy()) {
+                Field<float>& macroVarCopy{
+                    g_MacroVarsCompressedCopy().at(varId)};
+                ops_par_loop(KerCopyMacroVarsCompressed,
+                             "KerCopyMacroVarsCompressed", block.Get(),
+                             SpaceDim(), iterRng.data(),
+                             ops_arg_dat(macroVar.at(blockIdx), 1,
+                                         LOCALSTENCIL, "double", OPS_READ),
+                             ops_arg_dat(macroVarCopy.at(blockIdx), 1,
+                                         LOCALSTENCIL, "float", OPS_WRITE));
+            } else {
+                RealField& macroVarCopy{g_MacroVarsCopy().at(varId)};
+                ops_par_loop(KerCopyMacroVars, "KerCopyMacroVars",
+                             block.Get(), SpaceDim(), iterRng.data(),
+                             ops_arg_dat(macroVar.at(blockIdx), 1,
+                                         LOCALSTENCIL, "double", OPS_READ),
+                             ops_arg_dat(macroVarCopy.at(blockIdx), 1,
+                                         LOCALSTENCIL, "double", OPS_RW));
+            }
         }
     }
 }
 
 void CalcResidualError() {
-    std::map<int, Real> diff;
-    for (const auto& pair : g_MacroVars()) {
+    // A single sweep per variable and block accumulates both the square of
+    // difference and the square, and updates the copy
+    for (auto& pair : g_MacroVars()) {
         const int varId{pair.first};
         const RealField& macroVar{pair.second};
-        const RealField& macroVarCopy{g_MacroVarsCopy().at(varId)};
-        Real error{0};
-        diff.emplace(varId, error);
         for (const auto& idBlock : g_Block()) {
             const Block& block{idBlock.second};
             std::vector<int> iterRng;
             iterRng.assign(block.WholeRange().begin(),
                            block.WholeRange().end());
             const int blockIdx{block.ID()};
-            ops_par_loop(KerCalcMacroVarSquareofDifference,
-                         "KerCalcMacroVarSquareofDifference", block.Get(),
-                         SpaceDim(), iterRng.data(),
-                         ops_arg_dat(macroVar.at(blockIdx), 1, LOCALSTENCIL,
-                                     "double", OPS_READ),
-                         ops_arg_dat(macroVarCopy.at(blockIdx), 1, LOCALSTENCIL,
-                                     "double", OPS_READ),
-                         // TODO if we can change "double" here?
-                         ops_arg_reduce(g_ResidualErrorHandle().at(varId), 1,
-                                        "double", OPS_INC));
+            if (CompressedResidualCopy()) {
+                Field<float>& macroVarCopy{
+                    g_MacroVarsCompressedCopy().at(varId)};
+                ops_par_loop(KerCalcMacroVarResidualCompressed,
+                             "KerCalcMacroVarResidualCompressed", block.Get(),
+                             SpaceDim(), iterRng.data(),
+                             ops_arg_dat(macroVar.at(blockIdx), 1,
+                                         LOCALSTENCIL, "double", OPS_READ),
+                             ops_arg_dat(macroVarCopy.at(blockIdx), 1,
+                                         LOCALSTENCIL, "float", OPS_RW),
+                             ops_arg_reduce(g_ResidualErrorHandle().at(varId),
+                                            2, "double", OPS_INC));
+            } else {
+                RealField& macroVarCopy{g_MacroVarsCopy().at(varId)};
+                ops_par_loop(KerCalcMacroVarResidual,
+                             "KerCalcMacroVarResidual", block.Get(),
+                             SpaceDim(), iterRng.data(),
+                             ops_arg_dat(macroVar.at(blockIdx), 1,
+                                         LOCALSTENCIL, "double", OPS_READ),
+                             ops_arg_dat(macroVarCopy.at(blockIdx), 1,
+                                         LOCALSTENCIL, "double", OPS_RW),
+                             ops_arg_reduce(g_ResidualErrorHandle().at(varId),
+                                            2, "double", OPS_INC));
+            }
         }
     }
-    // TODO:check if ops_reduction_results works directly for multi-block
+    // The results are fetched after all the loops are queued so that there
+    // is only one synchronisation
     for (const auto& pair : g_MacroVars()) {
-        ops_reduction_result(g_ResidualErrorHandle().at(pair.first),
-                             &diff.at(pair.first));
+        const int varId{pair.first};
+        Real sumSquares[2]{0, 0};
+        ops_reduction_result(g_ResidualErrorHandle().at(varId), sumSquares);
+        g_ResidualError().at(varId) = sumSquares[0] / sumSquares[1];
     }
+}
 
-    CopyCurrentMacroVar();
-
-    for (const auto& pair : g_MacroVars()) {
-        const int varId{pair.first};
-        const RealField& macroVar{pair.second};
-        for (const auto& idBlock : g_Block()) {
-            const Block& block{idBlock.second};
-            std::vector<int> iterRng;
-            iterRng.assign(block.WholeRange().begin(),
-                           block.WholeRange().end());
-            const int blockIdx{block.ID()};
-            ops_par_loop(KerCalcMacroVarSquare, "KerCalcMacroVarSquare3D",
+void PackNodeDescriptors() {
+    ops_reduction handle{ops_decl_reduction_handle(sizeof(int), "int",
+                                                   "InvalidDescriptorNum")};
+    for (const auto& idBlock : g_Block()) {
+        const Block& block{idBlock.second};
+        std::vector<int> iterRng;
+        iterRng.assign(block.WholeRange().begin(), block.WholeRange().end());
+        const int blockIdx{block.ID()};
+        for (const auto& idCompo : g_Components()) {
+            const int compoId{idCompo.first};
+            ops_par_loop(KerPackNodeDescriptor, "KerPackNodeDescriptor",
                          block.Get(), SpaceDim(), iterRng.data(),
-                         ops_arg_dat(macroVar.at(blockIdx), 1, LOCALSTENCIL,
-                                     "double", OPS_READ),
-                         ops_arg_reduce(g_ResidualErrorHandle().at(varId), 1,
-                                        "double", OPS_INC));
+                         ops_arg_dat(g_NodeType().at(compoId).at(blockIdx), 1,
+                                     LOCALSTENCIL, "int", OPS_READ),
+                         ops_arg_dat(g_GeometryProperty()[blockIdx], 1,
+                                     LOCALSTENCIL, "int", OPS_READ),
+                         ops_arg_dat(g_NodeDescriptor()
+                                         .at(compoId)
+                                         .at(blockIdx),
+                                     1, LOCALSTENCIL, "short", OPS_WRITE),
+                         ops_arg_reduce(handle, 1, "int", OPS_INC));
+            int invalidNum{0};
+            ops_reduction_result(handle, &invalidNum);
+            if (invalidNum > 0) {
+                ops_printf(
+                    "Error! %i nodes of Component %i at Block %i have a "
+                    "vertex type or geometry property without a node "
+                    "descriptor code!\n",
+                    invalidNum, compoId, blockIdx);
+                assert(invalidNum == 0);
+            }
         }
     }
+}
 
-    for (const auto& pair : g_MacroVars()) {
-        int varId{pair.first};
-        Real sum{0};
-        ops_reduction_result(g_ResidualErrorHandle().at(varId), &sum);
-        g_ResidualError().at(varId) = diff.at(varId) / sum;
+std::vector<std::vector<int>> MarkNonFluidPlanes(const Block& block) {
+    std::vector<int> iterRng;
+    iterRng.assign(block.BulkRange().begin(), block.BulkRange().end());
+    const int blockIdx{block.ID()};
+    std::vector<ops_reduction> handles;
+    for (int axis = 0; axis < SpaceDim(); axis++) {
+        const int planeNum{block.Size().at(axis)};
+        const std::string name{"NonFluidPlanes" + std::to_string(axis)};
+        handles.push_back(ops_decl_reduction_handle(planeNum * sizeof(int),
+                                                    "int", name.c_str()));
+    }
+    for (const auto& idCompo : g_Components()) {
+        const int compoId{idCompo.first};
+#ifdef OPS_2D
+        ops_par_loop(KerMarkNonFluidPlanes, "KerMarkNonFluidPlanes",
+                     block.Get(), SpaceDim(), iterRng.data(),
+                     ops_arg_dat(g_NodeType().at(compoId).at(blockIdx), 1,
+                                 LOCALSTENCIL, "int", OPS_READ),
+                     ops_arg_idx(),
+                     ops_arg_reduce(handles.at(0), block.Size().at(0), "int",
+                                    OPS_MAX),
+                     ops_arg_reduce(handles.at(1), block.Size().at(1), "int",
+                                    OPS_MAX));
+#endif
+#ifdef OPS_3D
+        ops_par_loop(KerMarkNonFluidPlanes3D, "KerMarkNonFluidPlanes3D",
+                     block.Get(), SpaceDim(), iterRng.data(),
+                     ops_arg_dat(g_NodeType().at(compoId).at(blockIdx), 1,
+                                 LOCALSTENCIL, "int", OPS_READ),
+                     ops_arg_idx(),
+                     ops_arg_reduce(handles.at(0), block.Size().at(0), "int",
+                                    OPS_MAX),
+                     ops_arg_reduce(handles.at(1), block.Size().at(1), "int",
+                                    OPS_MAX),
+                     ops_arg_reduce(handles.at(2), block.Size().at(2), "int",
+                                    OPS_MAX));
+#endif
+    }
+    // A plane is never marked if the reduction keeps its initial value,
+    // i.e., the minimum integer
+    std::vector<std::vector<int>> nonFluidPlanes;
+    for (int axis = 0; axis < SpaceDim(); axis++) {
+        std::vector<int> planes(block.Size().at(axis), 0);
+        ops_reduction_result(handles.at(axis), planes.data());
+        for (auto& plane : planes) {
+            plane = plane > 0 ? 1 : 0;
+        }
+        nonFluidPlanes.push_back(planes);
+    }
+    return nonFluidPlanes;
+}
+
+std::vector<int> MarkActiveTiles(const Block& block, const int tileSize) {
+    std::vector<int> iterRng;
+    iterRng.assign(block.WholeRange().begin(), block.WholeRange().end());
+    const int blockIdx{block.ID()};
+    std::vector<int> tiling{tileSize};
+    int tileNum{1};
+    for (int axis = 0; axis < SpaceDim(); axis++) {
+        tiling.push_back((block.Size().at(axis) + tileSize - 1) / tileSize);
+        tileNum *= tiling.back();
+    }
+    ops_reduction handle{ops_decl_reduction_handle(tileNum * sizeof(int),
+                                                   "int", "ActiveTiles")};
+    for (const auto& idCompo : g_Components()) {
+        const int compoId{idCompo.first};
+#ifdef OPS_2D
+        ops_par_loop(KerMarkActiveTiles, "KerMarkActiveTiles", block.Get(),
+                     SpaceDim(), iterRng.data(),
+                     ops_arg_dat(g_NodeType().at(compoId).at(blockIdx), 1,
+                                 LOCALSTENCIL, "int", OPS_READ),
+                     ops_arg_idx(),
+                     ops_arg_gbl(tiling.data(), 3, "int", OPS_READ),
+                     ops_arg_reduce(handle, tileNum, "int", OPS_MAX));
+#endif
+#ifdef OPS_3D
+        ops_par_loop(KerMarkActiveTiles3D, "KerMarkActiveTiles3D",
+                     block.Get(), SpaceDim(), iterRng.data(),
+                     ops_arg_dat(g_NodeType().at(compoId).at(blockIdx), 1,
+                                 LOCALSTENCIL, "int", OPS_READ),
+                     ops_arg_idx(),
+                     ops_arg_gbl(tiling.data(), 4, "int", OPS_READ),
+                     ops_arg_reduce(handle, tileNum, "int", OPS_MAX));
+#endif
+    }
+    // As for MarkNonFluidPlanes, an unmarked tile keeps the minimum integer
+    std::vector<int> activeTiles(tileNum, 0);
+    ops_reduction_result(handle, activeTiles.data());
+    for (auto& tile : activeTiles) {
+        tile = tile > 0 ? 1 : 0;
+    }
+    return activeTiles;
+}
+
+SizeType CountFluidNodes() {
+    SizeType fluidNodeNum{0};
+    ops_reduction handle{
+        ops_decl_reduction_handle(sizeof(int), "int", "FluidNodeNum")};
+    for (const auto& idBlock : g_Block()) {
+        const Block& block{idBlock.second};
+        std::vector<int> iterRng;
+        iterRng.assign(block.WholeRange().begin(), block.WholeRange().end());
+        const int blockIdx{block.ID()};
+        for (const auto& idCompo : g_Components()) {
+            ops_par_loop(KerCountFluidNodes, "KerCountFluidNodes", block.Get(),
+                         SpaceDim(), iterRng.data(),
+                         ops_arg_dat(g_NodeType()
+                                         .at(idCompo.first)
+                                         .at(blockIdx),
+                                     1, LOCALSTENCIL, "int", OPS_READ),
+                         ops_arg_reduce(handle, 1, "int", OPS_INC));
+            int count{0};
+            ops_reduction_result(handle, &count);
+            fluidNodeNum += count;
+        }
     }
+    return fluidNodeNum;
 }
 
-void CopyDistribution(RealField& fDest, RealField& fSrc) {
+void CopyDistribution(DistributionField& fDest, DistributionField& fSrc) {
     for (const auto& idBlock : g_Block()) {
         const Block& block{idBlock.second};
         std::vector<int> iterRng;
@@ -97,12 +252,79 @@ void CopyDistribution(RealField& fDest, RealField& fSrc) {
         ops_par_loop(KerCopyf, "KerCopyf", block.Get(), SpaceDim(),
                      iterRng.data(),
                      ops_arg_dat(fDest[blockIndex], NUMXI, LOCALSTENCIL,
-                                 "double", OPS_WRITE),
+                                 fDest.Type(), OPS_WRITE),
                      ops_arg_dat(fSrc[blockIndex], NUMXI, LOCALSTENCIL,
-                                 "double", OPS_READ));
+                                 fSrc.Type(), OPS_READ));
     }
 }
 
+void CopyMacroVarsToRegion(ops_dat buffer,
+                           const std::vector<int>& macroVarIds,
+                           const Block& block, const std::vector<int>& range) {
+    // The number of the variables copied by KerCopyMacroVarsToRegion
+    const int batchSize{4};
+    std::vector<int> iterRng{range};
+    const int varNum{(int)macroVarIds.size()};
+    for (int start = 0; start < varNum; start += batchSize) {
+        const int num{std::min(varNum - start, batchSize)};
+        // The unused arguments repeat the last variable of the batch
+        std::vector<ops_dat> vars;
+        for (int idx = 0; idx < batchSize; idx++) {
+            const int varId{macroVarIds.at(start + std::min(idx, num - 1))};
+            vars.push_back(g_MacroVars().at(varId).at(block.ID()));
+        }
+        ops_par_loop(KerCopyMacroVarsToRegion, "KerCopyMacroVarsToRegion",
+                     block.Get(), SpaceDim(), iterRng.data(),
+                     ops_arg_dat(vars.at(0), 1, LOCALSTENCIL, "double",
+                                 OPS_READ),
+                     ops_arg_dat(vars.at(1), 1, LOCALSTENCIL, "double",
+                                 OPS_READ),
+                     ops_arg_dat(vars.at(2), 1, LOCALSTENCIL, "double",
+                                 OPS_READ),
+                     ops_arg_dat(vars.at(3), 1, LOCALSTENCIL, "double",
+                                 OPS_READ),
+                     ops_arg_dat(buffer, varNum, LOCALSTENCIL, "double",
+                                 OPS_RW),
+                     ops_arg_gbl(&start, 1, "int", OPS_READ),
+                     ops_arg_gbl(&num, 1, "int", OPS_READ));
+    }
+}
+
+void PackHaloPopulations(DistributionField& buffer,
+                         const DistributionField& fSrc, const HaloRange& halo,
+                         const std::vector<int>& populations) {
+    const Block& block{g_Block().at(halo.fromBlock)};
+    std::vector<int> iterRng{halo.fromRange};
+    const int populationNum{(int)populations.size()};
+    ops_par_loop(KerPackHaloPopulations, "KerPackHaloPopulations",
+                 block.Get(), SpaceDim(), iterRng.data(),
+                 ops_arg_dat(buffer[halo.fromBlock], buffer.DataDim(),
+                             LOCALSTENCIL, buffer.Type(), OPS_WRITE),
+                 ops_arg_dat(fSrc.at(halo.fromBlock), NUMXI, LOCALSTENCIL,
+                             fSrc.Type(), OPS_READ),
+                 ops_arg_gbl(populations.data(), populationNum, "int",
+                             OPS_READ),
+                 ops_arg_gbl(&populationNum, 1, "int", OPS_READ));
+}
+
+void UnpackHaloPopulations(DistributionField& fDest,
+                           const DistributionField& buffer,
+                           const HaloRange& halo,
+                           const std::vector<int>& populations) {
+    const Block& block{g_Block().at(halo.toBlock)};
+    std::vector<int> iterRng{halo.toRange};
+    const int populationNum{(int)populations.size()};
+    ops_par_loop(KerUnpackHaloPopulations, "KerUnpackHaloPopulations",
+                 block.Get(), SpaceDim(), iterRng.data(),
+                 ops_arg_dat(fDest[halo.toBlock], NUMXI, LOCALSTENCIL,
+                             fDest.Type(), OPS_RW),
+                 ops_arg_dat(buffer.at(halo.toBlock), buffer.DataDim(),
+                             LOCALSTENCIL, buffer.Type(), OPS_READ),
+                 ops_arg_gbl(populations.data(), populationNum, "int",
+                             OPS_READ),
+                 ops_arg_gbl(&populationNum, 1, "int", OPS_READ));
+}
+
 // This routine is necessary now due to the following reason:
 // 1. the collision process might not be implemented at some kind of boundary
 // points so that f_stage will not be updated.
@@ -110,7 +332,8 @@ void CopyDistribution(RealField& fDest, RealField& fSrc) {
 // which needs the information at halo points.
 // The routine shall be removed if the stream process can be implemented in a
 // way that f_stage is not necessary.
-void CopyBlockEnvelopDistribution(Field<Real>& fDest, Field<Real>& fSrc) {
+void CopyBlockEnvelopDistribution(DistributionField& fDest,
+                                  DistributionField& fSrc) {
     // int haloIterRng[]{0, 0, 0, 0, 0, 0};
     for (const auto& idBlock : g_Block()) {
         const Block& block{idBlock.second};
@@ -131,9 +354,9 @@ void CopyBlockEnvelopDistribution(Field<Real>& fDest, Field<Real>& fSrc) {
         ops_par_loop(KerCopyf, "KerCopyf", block.Get(), SpaceDim(),
                      iterRng.data(),
                      ops_arg_dat(fDest[blockIndex], NUMXI, LOCALSTENCIL,
-                                 "double", OPS_WRITE),
+                                 fDest.Type(), OPS_WRITE),
                      ops_arg_dat(fSrc[blockIndex], NUMXI, LOCALSTENCIL,
-                                 "double", OPS_READ));
+                                 fSrc.Type(), OPS_READ));
 
         iterRng.assign(
             block.BoundarySurfaceRange().at(BoundarySurface::Right).begin(),
@@ -150,9 +373,9 @@ void CopyBlockEnvelopDistribution(Field<Real>& fDest, Field<Real>& fSrc) {
         ops_par_loop(KerCopyf, "KerCopyf", block.Get(), SpaceDim(),
                      iterRng.data(),
                      ops_arg_dat(fDest[blockIndex], NUMXI, LOCALSTENCIL,
-                                 "double", OPS_WRITE),
+                                 fDest.Type(), OPS_WRITE),
                      ops_arg_dat(fSrc[blockIndex], NUMXI, LOCALSTENCIL,
-                                 "double", OPS_READ));
+                                 fSrc.Type(), OPS_READ));
 
         iterRng.assign(
             block.BoundarySurfaceRange().at(BoundarySurface::Bottom).begin(),
@@ -169,9 +392,9 @@ void CopyBlockEnvelopDistribution(Field<Real>& fDest, Field<Real>& fSrc) {
         ops_par_loop(KerCopyf, "KerCopyf", block.Get(), SpaceDim(),
                      iterRng.data(),
                      ops_arg_dat(fDest[blockIndex], NUMXI, LOCALSTENCIL,
-                                 "double", OPS_WRITE),
+                                 fDest.Type(), OPS_WRITE),
                      ops_arg_dat(fSrc[blockIndex], NUMXI, LOCALSTENCIL,
-                                 "double", OPS_READ));
+                                 fSrc.Type(), OPS_READ));
         iterRng.assign(
             block.BoundarySurfaceRange().at(BoundarySurface::Top).begin(),
             block.BoundarySurfaceRange().at(BoundarySurface::Top).end());
@@ -187,9 +410,9 @@ void CopyBlockEnvelopDistribution(Field<Real>& fDest, Field<Real>& fSrc) {
         ops_par_loop(KerCopyf, "KerCopyf", block.Get(), SpaceDim(),
                      iterRng.data(),
                      ops_arg_dat(fDest[blockIndex], NUMXI, LOCALSTENCIL,
-                                 "double", OPS_WRITE),
+                                 fDest.Type(), OPS_WRITE),
                      ops_arg_dat(fSrc[blockIndex], NUMXI, LOCALSTENCIL,
-                                 "double", OPS_READ));
+                                 fSrc.Type(), OPS_READ));
 #ifdef OPS_3D
         iterRng.assign(
             block.BoundarySurfaceRange().at(BoundarySurface::Back).begin(),
@@ -206,9 +429,9 @@ void CopyBlockEnvelopDistribution(Field<Real>& fDest, Field<Real>& fSrc) {
         ops_par_loop(KerCopyf, "KerCopyf", block.Get(), SpaceDim(),
                      iterRng.data(),
                      ops_arg_dat(fDest[blockIndex], NUMXI, LOCALSTENCIL,
-                                 "double", OPS_WRITE),
+                                 fDest.Type(), OPS_WRITE),
                      ops_arg_dat(fSrc[blockIndex], NUMXI, LOCALSTENCIL,
-                                 "double", OPS_READ));
+                                 fSrc.Type(), OPS_READ));
         iterRng.assign(
             block.BoundarySurfaceRange().at(BoundarySurface::Front).begin(),
             block.BoundarySurfaceRange().at(BoundarySurface::Front).end());
@@ -224,9 +447,9 @@ void CopyBlockEnvelopDistribution(Field<Real>& fDest, Field<Real>& fSrc) {
         ops_par_loop(KerCopyf, "KerCopyf", block.Get(), SpaceDim(),
                      iterRng.data(),
                      ops_arg_dat(fDest[blockIndex], NUMXI, LOCALSTENCIL,
-                                 "double", OPS_WRITE),
+                                 fDest.Type(), OPS_WRITE),
                      ops_arg_dat(fSrc[blockIndex], NUMXI, LOCALSTENCIL,
-                                 "double", OPS_READ));
+                                 fSrc.Type(), OPS_READ));
 #endif  // OPS_3D
     }
 }
@@ -239,8 +462,8 @@ void NormaliseF(Real* ratio) {
         const int blockIdx{block.ID()};
         ops_par_loop(KerNormaliseF, "KerNormaliseF", block.Get(), SpaceDim(),
                      iterRng.data(), ops_arg_gbl(ratio, 1, "double", OPS_READ),
-                     ops_arg_dat(g_f()[blockIdx], NUMXI, LOCALSTENCIL, "double",
-                                 OPS_RW));
+                     ops_arg_dat(g_f()[blockIdx], NUMXI, LOCALSTENCIL,
+                                 g_f().Type(), OPS_RW));
     }
 }
 
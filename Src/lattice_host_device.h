@@ -0,0 +1,188 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*! @brief   Define lattice descriptors known at compile time
+ * @author  Jianping Meng
+ * @details The descriptors duplicate the runtime lattice setup in model.cpp
+ * (XI, WEIGHTS, CS) for the commonly used lattices, so that kernels can be
+ * instantiated per lattice and the compiler may unroll and vectorise the
+ * loops over the discrete velocities. The ordering must match
+ * SetupD2Q9Latt, SetupD3Q15Latt and SetupD3Q19Latt.
+ * The velocities and weights are returned by OPS_FUN_PREFIX functions
+ * holding local tables rather than static member arrays, which would be
+ * host storage that device code cannot read. Once a loop over the
+ * velocities is unrolled, the lookups fold into constants.
+ */
+#ifndef LATTICE_HOST_DEVICE_H
+#define LATTICE_HOST_DEVICE_H
+#ifndef OPS_FUN_PREFIX
+#define OPS_FUN_PREFIX
+#endif
+#include "type.h"
+/*!
+ * Lattices which have a compile-time descriptor. Lattice_Generic means the
+ * kernels read the lattice from the runtime constants XI, WEIGHTS etc.
+ */
+enum LatticeType {
+    Lattice_Generic = 0,
+    Lattice_D2Q9 = 1,
+    Lattice_D3Q15 = 2,
+    Lattice_D3Q19 = 3,
+};
+#ifdef OPS_2D
+struct LatticeD2Q9 {
+    static constexpr int Q{9};
+    static constexpr int D{2};
+    static constexpr Real CS{1.7320508075688772};
+    static OPS_FUN_PREFIX int CX(const int l) {
+        const int cx[Q]{0, 1, 0, -1, 0, 1, -1, -1, 1};
+        return cx[l];
+    }
+    static OPS_FUN_PREFIX int CY(const int l) {
+        const int cy[Q]{0, 0, 1, 0, -1, 1, 1, -1, -1};
+        return cy[l];
+    }
+    static OPS_FUN_PREFIX Real W(const int l) {
+        const Real w[Q]{4.0 / 9.0, 1.0 / 9.0, 1.0 / 9.0, 1.0 / 9.0, 1.0 / 9.0,
+                        1.0 / 36.0, 1.0 / 36.0, 1.0 / 36.0, 1.0 / 36.0};
+        return w[l];
+    }
+};
+/*!
+ * The second-order equilibrium function, i.e., CalcBGKFeq with T=1 and
+ * polyOrder=2 for a compile-time lattice, l is the local velocity index.
+ */
+template <typename Lattice>
+static inline OPS_FUN_PREFIX Real CalcBGKFeq2nd(const int l, const Real rho,
+                                                const Real u, const Real v) {
+    const Real cu{Lattice::CS * Lattice::CX(l) * u +
+                  Lattice::CS * Lattice::CY(l) * v};
+    const Real cu2{cu * cu};
+    const Real u2{u * u + v * v};
+    const Real res{1.0 + cu + 0.5 * (cu2 - u2)};
+    return Lattice::W(l) * rho * res;
+}
+/*!
+ * The first-order force term, i.e., CalcBodyForce for a compile-time lattice
+ */
+template <typename Lattice>
+static inline OPS_FUN_PREFIX Real CalcBodyForce(const int l, const Real rho,
+                                                const Real* acceleration) {
+    const Real cf{Lattice::CS * Lattice::CX(l) * acceleration[0] +
+                  Lattice::CS * Lattice::CY(l) * acceleration[1]};
+    return Lattice::W(l) * rho * cf;
+}
+#endif  // OPS_2D
+
+#ifdef OPS_3D
+struct LatticeD3Q15 {
+    static constexpr int Q{15};
+    static constexpr int D{3};
+    static constexpr Real CS{1.7320508075688772};
+    static OPS_FUN_PREFIX int CX(const int l) {
+        const int cx[Q]{0, 1, -1, 0, 0, 0, 0, 1, -1, 1, -1, 1, -1, -1, 1};
+        return cx[l];
+    }
+    static OPS_FUN_PREFIX int CY(const int l) {
+        const int cy[Q]{0, 0, 0, 1, -1, 0, 0, 1, -1, 1, -1, -1, 1, 1, -1};
+        return cy[l];
+    }
+    static OPS_FUN_PREFIX int CZ(const int l) {
+        const int cz[Q]{0, 0, 0, 0, 0, 1, -1, 1, -1, -1, 1, 1, -1, 1, -1};
+        return cz[l];
+    }
+    static OPS_FUN_PREFIX Real W(const int l) {
+        const Real w[Q]{2.0 / 9.0, 1.0 / 9.0, 1.0 / 9.0, 1.0 / 9.0, 1.0 / 9.0,
+                        1.0 / 9.0, 1.0 / 9.0, 1.0 / 72.0, 1.0 / 72.0,
+                        1.0 / 72.0, 1.0 / 72.0, 1.0 / 72.0, 1.0 / 72.0,
+                        1.0 / 72.0, 1.0 / 72.0};
+        return w[l];
+    }
+};
+
+struct LatticeD3Q19 {
+    static constexpr int Q{19};
+    static constexpr int D{3};
+    static constexpr Real CS{1.7320508075688772};
+    static OPS_FUN_PREFIX int CX(const int l) {
+        const int cx[Q]{0, 1, -1, 0, 0, 0, 0, 1, -1, 1, -1, 0, 0, 1, -1, 1, -1,
+                        0, 0};
+        return cx[l];
+    }
+    static OPS_FUN_PREFIX int CY(const int l) {
+        const int cy[Q]{0, 0, 0, 1, -1, 0, 0, 1, -1, 0, 0, 1, -1, -1, 1, 0, 0,
+                        1, -1};
+        return cy[l];
+    }
+    static OPS_FUN_PREFIX int CZ(const int l) {
+        const int cz[Q]{0, 0, 0, 0, 0, 1, -1, 0, 0, 1, -1, 1, -1, 0, 0, -1, 1,
+                        -1, 1};
+        return cz[l];
+    }
+    static OPS_FUN_PREFIX Real W(const int l) {
+        const Real w[Q]{1.0 / 3.0, 1.0 / 18.0, 1.0 / 18.0, 1.0 / 18.0,
+                        1.0 / 18.0, 1.0 / 18.0, 1.0 / 18.0, 1.0 / 36.0,
+                        1.0 / 36.0, 1.0 / 36.0, 1.0 / 36.0, 1.0 / 36.0,
+                        1.0 / 36.0, 1.0 / 36.0, 1.0 / 36.0, 1.0 / 36.0,
+                        1.0 / 36.0, 1.0 / 36.0, 1.0 / 36.0};
+        return w[l];
+    }
+};
+/*!
+ * The second-order equilibrium function, i.e., CalcBGKFeq with T=1 and
+ * polyOrder=2 for a compile-time lattice, l is the local velocity index.
+ */
+template <typename Lattice>
+static inline OPS_FUN_PREFIX Real CalcBGKFeq2nd(const int l, const Real rho,
+                                                const Real u, const Real v,
+                                                const Real w) {
+    const Real cu{Lattice::CS * Lattice::CX(l) * u +
+                  Lattice::CS * Lattice::CY(l) * v +
+                  Lattice::CS * Lattice::CZ(l) * w};
+    const Real cu2{cu * cu};
+    const Real u2{u * u + v * v + w * w};
+    const Real res{1.0 + cu + 0.5 * (cu2 - u2)};
+    return Lattice::W(l) * rho * res;
+}
+/*!
+ * The first-order force term, i.e., CalcBodyForce for a compile-time lattice
+ */
+template <typename Lattice>
+static inline OPS_FUN_PREFIX Real CalcBodyForce(const int l, const Real rho,
+                                                const Real* acceleration) {
+    const Real cf{Lattice::CS * Lattice::CX(l) * acceleration[0] +
+                  Lattice::CS * Lattice::CY(l) * acceleration[1] +
+                  Lattice::CS * Lattice::CZ(l) * acceleration[2]};
+    return Lattice::W(l) * rho * cf;
+}
+#endif  // OPS_3D
+#endif  // LATTICE_HOST_DEVICE_H
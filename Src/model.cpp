@@ -53,6 +53,8 @@ Real* XI{nullptr};
 Real* WEIGHTS{nullptr};
 int* OPP{nullptr};
 int NUMCOMPONENTS{1};
+// The distributions are rebuilt from the moments, see DefineComponents
+bool RESTOREFROMMOMENTS{false};
 
 Real XIMAXVALUE{1};
 std::map<int,Component> components;
@@ -107,7 +109,7 @@ void SetupD2Q9Latt(const int startPos) {
         XI[(startPos + l) * LATTDIM] = cxi[l];
         XI[(startPos + l) * LATTDIM + 1] = cyi[l];
         WEIGHTS[startPos + l] = t[l];
-        OPP[startPos + l] = op9[l];
+        OPP[startPos + l] = op9[l] + startPos;
     }
 }
 
@@ -208,6 +210,38 @@ void AllocateXi(const int length) {
     }
 }
 
+int OppositePairNum(const int first, const int last) {
+    int pairNum{0};
+    for (int xiIndex = first; xiIndex <= last; xiIndex++) {
+        if (xiIndex < OPP[xiIndex]) {
+            pairNum++;
+        }
+    }
+    return pairNum;
+}
+
+/**
+ * @brief Find the compile-time descriptor of a lattice
+ * @return Lattice_Generic if there is no descriptor for the lattice in the
+ * current dimension, i.e., the runtime-generic kernels will be used.
+ */
+LatticeType FindLatticeType(const std::string& lattName) {
+#ifdef OPS_2D
+    if ("d2q9" == lattName) {
+        return Lattice_D2Q9;
+    }
+#endif  // OPS_2D
+#ifdef OPS_3D
+    if ("d3q15" == lattName) {
+        return Lattice_D3Q15;
+    }
+    if ("d3q19" == lattName) {
+        return Lattice_D3Q19;
+    }
+#endif  // OPS_3D
+    return Lattice_Generic;
+}
+
 void DefineComponents(const std::vector<std::string>& compoNames,
                       const std::vector<int>& compoId,
                       const std::vector<std::string>& lattNames,
@@ -278,6 +312,14 @@ void DefineComponents(const std::vector<std::string>& compoNames,
             startPos += latticeSet[lattNames[idx]].length;
             ops_printf("The %s lattice is employed for Component %i.\n",
                        lattNames[idx].c_str(), idx);
+            Component& compo{components.at(compoId.at(idx))};
+            compo.latticeType = FindLatticeType(lattNames[idx]);
+            if (Lattice_Generic != compo.latticeType) {
+                ops_printf(
+                    "The kernels specialised for the %s lattice are used for "
+                    "Component %i.\n",
+                    lattNames[idx].c_str(), idx);
+            }
         }
         Real maxValue{0};
         for (int l = 0; l < totalSize * LATTDIM; l++) {
@@ -296,23 +338,47 @@ void DefineComponents(const std::vector<std::string>& compoNames,
     for (const auto& pair : components) {
         IntField nodeType{"NodeType_" + pair.second.name};
         g_NodeType().emplace(pair.second.id, nodeType);
+        // Only read at the local node, no halo is needed
+        ShortField descriptor{"NodeDescriptor_" + pair.second.name, 1, 0};
+        g_NodeDescriptor().emplace(pair.second.id, descriptor);
     }
 
+    // The descriptors are packed from the node types by PrepareFlowField
+    for (auto& pair : g_NodeDescriptor()) {
+        pair.second.CreateFieldFromScratch(g_Block());
+    }
     g_f().SetDataDim(NUMXI);
+#ifdef FLOAT_DISTRIBUTION
+    // f-w_i is stored, see StoreF, which is recorded in the files
+    g_f().SetOffsets(std::vector<Real>(WEIGHTS, WEIGHTS + NUMXI));
+#endif
     if (timeStep == 0) {
         g_f().CreateFieldFromScratch(g_Block());
         for (auto& pair : g_NodeType()) {
             pair.second.CreateFieldFromScratch(g_Block());
         }
     } else {
-        g_f().CreateFieldFromFile(CaseName(), g_Block(), timeStep);
+        if (g_f().IsInCheckpoint(CaseName(), g_Block(), timeStep)) {
+            g_f().CreateFieldFromFile(CaseName(), g_Block(), timeStep);
+        } else {
+            ops_printf(
+                "The distributions are rebuilt from the moments at the step "
+                "%i\n",
+                timeStep);
+            g_f().CreateFieldFromScratch(g_Block());
+            for (const auto& pair : components) {
+                g_RestartMoments().emplace(
+                    pair.first, RealField{"Moments_" + pair.second.name,
+                                          RestartMomentNum(), 0});
+                g_RestartMoments().at(pair.first).CreateFieldFromFile(
+                    CaseName(), g_Block(), timeStep);
+            }
+            RESTOREFROMMOMENTS = true;
+        }
         for (auto& pair : g_NodeType()) {
             pair.second.CreateFieldFromFile(CaseName(), g_Block(), timeStep);
         }
     }
-    g_fStage().SetDataDim(NUMXI);
-    g_fStage().CreateFieldFromScratch(g_Block());
-    g_fStage().CreateHalos();
 }
 
 void DefineMacroVars(std::vector<VariableTypes> types,
@@ -345,8 +411,14 @@ void DefineMacroVars(std::vector<VariableTypes> types,
         RealField macroVarField{macroVar.name};
         g_MacroVars().emplace(macroVar.id, macroVarField);
         if (!IsTransient()) {
-            RealField macroVarFieldCopy{macroVar.name + "Copy"};
-            g_MacroVarsCopy().emplace(macroVar.id, macroVarFieldCopy);
+            if (CompressedResidualCopy()) {
+                Field<float> macroVarFieldCopy{macroVar.name + "Copy", 1, 0};
+                g_MacroVarsCompressedCopy().emplace(macroVar.id,
+                                                    macroVarFieldCopy);
+            } else {
+                RealField macroVarFieldCopy{macroVar.name + "Copy", 1, 0};
+                g_MacroVarsCopy().emplace(macroVar.id, macroVarFieldCopy);
+            }
         }
     }
 
@@ -397,10 +469,14 @@ void DefineMacroVars(std::vector<VariableTypes> types,
         for (auto& pair : g_MacroVarsCopy()) {
             pair.second.CreateFieldFromScratch(g_Block());
         }
+        for (auto& pair : g_MacroVarsCompressedCopy()) {
+            pair.second.CreateFieldFromScratch(g_Block());
+        }
         for (const auto& compo : components) {
             for (const auto& var : compo.second.macroVars) {
+                // the square of difference and the square
                 ops_reduction handle{ops_decl_reduction_handle(
-                    sizeof(Real), "double", var.second.name.c_str())};
+                    2 * sizeof(Real), "double", var.second.name.c_str())};
                 g_ResidualErrorHandle().emplace(var.second.id, handle);
                 Real error;
                 g_ResidualError().emplace(var.second.id, error);
@@ -478,9 +554,23 @@ void DefineBodyForce(std::vector<BodyForceType> types,
         ops_printf(
             "The body force function type %i is chosen for Component %i\n",
             types.at(idx), compoId.at(idx));
-        components.at(compoId.at(idx)).bodyForceType = types.at(idx);
-        RealField force{"Force_" + components.at(compoId.at(idx)).name};
-        g_MacroBodyforce().emplace(compoId.at(idx), force);
+        Component& compo{components.at(compoId.at(idx))};
+        // The allocation depends on the force-corrected velocities
+        if (compo.macroVars.empty()) {
+            ops_printf(
+                "Error! Please call DefineMacroVars for Component %i before "
+                "DefineBodyForce!\n",
+                compoId.at(idx));
+            assert(!compo.macroVars.empty());
+        }
+        compo.bodyForceType = types.at(idx);
+        if (UsesBodyForceField(compo)) {
+            RealField force{"Force_" + compo.name};
+            g_MacroBodyforce().emplace(compoId.at(idx), force);
+        } else {
+            ops_printf("No body force field is allocated for Component %i\n",
+                       compoId.at(idx));
+        }
     }
     if (compoSize < NUMCOMPONENTS) {
         ops_printf(
@@ -530,6 +620,91 @@ void DefineInitialCondition(std::vector<InitialType> types,
     }
 }
 
+bool UsesBodyForceField(const Component& compo) {
+    const std::map<VariableTypes, MacroVariable>& macroVars{compo.macroVars};
+    return compo.bodyForceType == BodyForce_1st ||
+           macroVars.count(Variable_U_Force) > 0 ||
+           macroVars.count(Variable_V_Force) > 0 ||
+           macroVars.count(Variable_W_Force) > 0;
+}
+
+bool HasDensityVelocity(const Component& compo) {
+    const std::map<VariableTypes, MacroVariable>& macroVars{compo.macroVars};
+    bool hasVelocity{(macroVars.count(Variable_U) > 0 ||
+                      macroVars.count(Variable_U_Force) > 0) &&
+                     (macroVars.count(Variable_V) > 0 ||
+                      macroVars.count(Variable_V_Force) > 0)};
+#ifdef OPS_3D
+    hasVelocity = hasVelocity && (macroVars.count(Variable_W) > 0 ||
+                                  macroVars.count(Variable_W_Force) > 0);
+#endif
+    return (macroVars.count(Variable_Rho) > 0) && hasVelocity;
+}
+
+bool FusedCollisionSupported() {
+    for (const auto& idCompo : components) {
+        const Component& compo{idCompo.second};
+        if (!HasDensityVelocity(compo)) {
+            return false;
+        }
+        if (compo.collisionType != Collision_BGKIsothermal2nd) {
+            return false;
+        }
+        if (compo.bodyForceType != BodyForce_1st &&
+            compo.bodyForceType != BodyForce_None) {
+            return false;
+        }
+        for (const auto& macroVar : compo.macroVars) {
+            switch (macroVar.first) {
+                case Variable_Rho:
+                case Variable_U:
+                case Variable_V:
+                case Variable_U_Force:
+                case Variable_V_Force:
+#ifdef OPS_3D
+                case Variable_W:
+                case Variable_W_Force:
+#endif
+                    break;
+                default:
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool CompactRestartSupported() {
+    for (const auto& idCompo : components) {
+        if (idCompo.second.collisionType != Collision_BGKIsothermal2nd) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int RestartMomentNum() {
+    const int spaceDim{SpaceDim()};
+    return 1 + spaceDim + spaceDim * (spaceDim + 1) / 2;
+}
+
+/*!
+ * The moments are only read at the local node so that no halo is needed
+ */
+void DefineRestartMoments() {
+    for (const auto& pair : components) {
+        if (g_RestartMoments().find(pair.first) != g_RestartMoments().end()) {
+            continue;
+        }
+        g_RestartMoments().emplace(
+            pair.first,
+            RealField{"Moments_" + pair.second.name, RestartMomentNum(), 0});
+        g_RestartMoments().at(pair.first).CreateFieldFromScratch(g_Block());
+    }
+}
+
+bool RestoringFromMoments() { return RESTOREFROMMOMENTS; }
+
 void DestroyModel() {
     FreeArrayMemory(XI);
     FreeArrayMemory(WEIGHTS);
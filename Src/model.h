@@ -89,6 +89,7 @@ extern int NUMCOMPONENTS;
 extern int* OPP;
 
 #include "model_host_device.h"
+#include "lattice_host_device.h"
 
 enum CollisionType {
     Collision_BGKIsothermal2nd = 0,
@@ -114,6 +115,8 @@ struct Component {
     InitialType initialType;
     std::map<VariableTypes, MacroVariable> macroVars;
     int index[2];
+    // The compile-time lattice descriptor selected for the kernels
+    LatticeType latticeType{Lattice_Generic};
     int uId, vId;
 #ifdef OPS_3D
     int wId;
@@ -125,6 +128,12 @@ const std::map<int, Component>& g_Components();
 
 inline const int ComponentNum() { return NUMCOMPONENTS; }
 inline const int SizeF() { return NUMXI; }
+/*!
+ * The number of the pairs (xi, OPP[xi]) with xi < OPP[xi] among the
+ * velocities first to last, which gives the slots of the swap array of the
+ * in-place stream-collision scheme
+ */
+int OppositePairNum(const int first, const int last);
 inline const Real SoundSpeed() { return CS; }
 inline const Real MaximumSpeed() { return XIMAXVALUE; }
 /**
@@ -153,21 +162,86 @@ void DefineMacroVars(std::vector<VariableTypes> types,
 void DefineCollision(std::vector<CollisionType> types,
                        std::vector<int> compoId);
 
+/*!
+* Define body force terms for specified components
+* Must be called after DefineMacroVars() so that the force field is only
+* allocated for the components that read it
+*/
 void DefineBodyForce(std::vector<BodyForceType> types,
                      std::vector<SizeType> compoId);
 
 void DefineInitialCondition(std::vector<InitialType> types,
                             std::vector<int> compoId);
+/*!
+ * Check if the density and all the velocity components (force-corrected or
+ * not) are defined for a component, so that its macroscopic variables can be
+ * calculated by a single-pass kernel.
+ */
+bool HasDensityVelocity(const Component& compo);
+/*!
+ * Check if a component reads its body force field, i.e., it uses
+ * BodyForce_1st or a velocity with the force correction.
+ */
+bool UsesBodyForceField(const Component& compo);
+/*!
+ * Check if the fused moment-collision kernel can replace the sequence of
+ * UpdateMacroVars, PreDefinedBodyForce and PreDefinedCollision, i.e., every
+ * component uses the isothermal BGK model, the first-order or no body
+ * force, and only the density and velocity (force-corrected or not) as
+ * macroscopic variables. The kernel does not stream.
+ */
+bool FusedCollisionSupported();
+/*!
+ * The compact restart stores the moments of each component rather than the
+ * distributions, i.e., the density, the velocity and the non-equilibrium
+ * momentum flux, see KerCalcRestartMoments, and the distributions are
+ * rebuilt from them. It is exact up to the Chapman-Enskog order, so that
+ * every component must use the isothermal BGK model.
+ */
+bool CompactRestartSupported();
+// The number of the moments per node of a component
+int RestartMomentNum();
+/*!
+ * Allocate the moments of the compact restart if not yet, which shall be
+ * called before Partition
+ */
+void DefineRestartMoments();
+/*!
+ * If the restarting step has only the moments rather than the
+ * distributions, so that the latter are rebuilt after the partition, see
+ * DefineComponents
+ */
+bool RestoringFromMoments();
+/*!
+ * The two halves of the pull scheme, see StreamCollisionPull.
+ * PullStreamCollision streams every node from g_fStage() into g_f(), where
+ * the Fluid boxes of the bulk also calculate the moments and the collision
+ * of the next step into g_fNext() in the same loop (see
+ * PullStreamCollideLattice), and FusedCollisionNonFluid does the same
+ * collision for the other nodes after the boundary conditions.
+ */
 #ifdef OPS_3D
+void PullStreamCollision3D();
+void FusedCollisionNonFluid3D();
+void FusedCollision3D();
+void InPlaceCollision3D();
 void UpdateMacroVars3D();
 void PreDefinedBodyForce3D();
 void PreDefinedInitialCondition3D();
 void PreDefinedCollision3D();
+void CalcRestartMoments3D();
+void RestoreFromRestartMoments3D();
 #endif
 #ifdef OPS_2D
+void PullStreamCollision();
+void FusedCollisionNonFluid();
+void FusedCollision();
+void InPlaceCollision();
 void UpdateMacroVars();
 void PreDefinedBodyForce();
 void PreDefinedInitialCondition();
 void PreDefinedCollision();
+void CalcRestartMoments();
+void RestoreFromRestartMoments();
 #endif
 #endif
@@ -108,4 +108,29 @@ static inline OPS_FUN_PREFIX Real CalcSWEFeq(const int l, const Real h, const Re
     return WEIGHTS[l] * h * res;
 }
 
+/*
+ * Load a distribution function stored in DistReal, l is the velocity index.
+ * In single precision, the deviation from the lattice weight is stored so
+ * that the significant digits are spent on the non-equilibrium part.
+ */
+static inline OPS_FUN_PREFIX Real LoadF(const DistReal stored, const int l) {
+#ifdef FLOAT_DISTRIBUTION
+    return stored + WEIGHTS[l];
+#else
+    return stored;
+#endif
+}
+
+/*
+ * Convert a distribution function to its storage form in DistReal, i.e.,
+ * the inverse of LoadF.
+ */
+static inline OPS_FUN_PREFIX DistReal StoreF(const Real value, const int l) {
+#ifdef FLOAT_DISTRIBUTION
+    return (DistReal)(value - WEIGHTS[l]);
+#else
+    return value;
+#endif
+}
+
 #endif //MODEL_HOST_DEVICE_H
\ No newline at end of file
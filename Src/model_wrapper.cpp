@@ -1,302 +1,870 @@
 #include <vector>
 #include <map>
 #include "flowfield.h"
+#include "step_plan.h"
 #include "flowfield_host_device.h"
 #include "model.h"
 #include "scheme.h"
 #include "ops_seq_v2.h"
 #include "model_kernel.inc"
+
+/*!
+ * Fetch the counts of the branch-free collision kernels once all the blocks
+ * are collided, so that there is only one synchronisation per step, and
+ * stop if any node is invalid.
+ */
+static void CheckBulkCollision() {
+    int invalidNum{0};
+    for (BlockPlan& plan : StepPlan()) {
+        if (plan.bulkLoopNum == 0) {
+            continue;
+        }
+        plan.bulkLoopNum = 0;
+        int blockInvalidNum{0};
+        ops_reduction_result(plan.bulkInvalidHandle, &blockInvalidNum);
+        invalidNum += blockInvalidNum;
+    }
+    if (invalidNum > 0) {
+        ops_printf(
+            "Error! %i bulk nodes become invalid in the collision, where "
+            "rho or a distribution function is not positive or finite!\n",
+            invalidNum);
+        assert(invalidNum == 0);
+    }
+}
+
 #ifdef OPS_3D
-void PreDefinedCollision3D() {
+/*!
+ * Collide the bulk nodes within iterRng by the branch-free kernel of the
+ * lattice, return false if the lattice has no such kernel.
+ */
+bool CollideBGKIsothermalBulk3D(BlockPlan& plan,
+                                const ComponentPlan& compoPlan,
+                                std::vector<int>& iterRng) {
+    bool found{false};
 #ifdef OPS_3D
-    for (const auto& idBlock : g_Block()) {
-        const Block& block{idBlock.second};
-        std::vector<int> iterRng;
-        iterRng.assign(block.WholeRange().begin(), block.WholeRange().end());
-        const int blockIndex{block.ID()};
-        for (const auto& idCompo : g_Components()) {
-            const Component& compo{idCompo.second};
-            const CollisionType collisionType{compo.collisionType};
-            const Real tau{compo.tauRef};
-            const Real* pdt{pTimeStep()};
-            switch (collisionType) {
-                case Collision_BGKIsothermal2nd:
-                    ops_par_loop(
-                        KerCollideBGKIsothermal3D, "KerCollideBGKIsothermal3D",
-                        block.Get(), SpaceDim(), iterRng.data(),
-                        ops_arg_dat(g_fStage()[blockIndex], NUMXI, LOCALSTENCIL,
-                                    "double", OPS_WRITE),
-                        ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
-                                    "double", OPS_READ),
-                        ops_arg_dat(g_CoordinateXYZ()[blockIndex], SpaceDim(),
-                                    LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_dat(g_NodeType().at(compo.id).at(blockIndex), 1,
-                                    LOCALSTENCIL, "int", OPS_READ),
-                        ops_arg_dat(g_MacroVars()
-                                        .at(compo.macroVars.at(Variable_Rho).id)
-                                        .at(blockIndex),
-                                    1, LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_dat(g_MacroVars().at(compo.uId).at(blockIndex),
-                                    1, LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_dat(g_MacroVars().at(compo.vId).at(blockIndex),
-                                    1, LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_dat(g_MacroVars().at(compo.wId).at(blockIndex),
-                                    1, LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_gbl(&tau, 1, "double", OPS_READ),
-                        ops_arg_gbl(pdt, 1, "double", OPS_READ),
-                        ops_arg_gbl(compo.index, 2, "int", OPS_READ));
-                    break;
-                case Collision_BGKThermal4th:
-                    ops_par_loop(
-                        KerCollideBGKThermal3D, "KerCollideBGKThermal3D",
-                        block.Get(), SpaceDim(), iterRng.data(),
-                        ops_arg_dat(g_fStage()[blockIndex], NUMXI, LOCALSTENCIL,
-                                    "double", OPS_WRITE),
-                        ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
-                                    "double", OPS_READ),
-                        ops_arg_dat(g_NodeType().at(compo.id).at(blockIndex), 1,
-                                    LOCALSTENCIL, "int", OPS_READ),
-                        ops_arg_dat(g_MacroVars()
-                                        .at(compo.macroVars.at(Variable_Rho).id)
-                                        .at(blockIndex),
-                                    1, LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_dat(g_MacroVars().at(compo.uId).at(blockIndex),
-                                    1, LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_dat(g_MacroVars().at(compo.vId).at(blockIndex),
-                                    1, LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_dat(g_MacroVars().at(compo.wId).at(blockIndex),
-                                    1, LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_dat(g_MacroVars()
-                                        .at(compo.macroVars.at(Variable_T).id)
-                                        .at(blockIndex),
-                                    1, LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_gbl(&tau, 1, "double", OPS_READ),
-                        ops_arg_gbl(pdt, 1, "double", OPS_READ),
-                        ops_arg_gbl(compo.index, 2, "int", OPS_READ));
-                    break;
-                default:
-                    ops_printf(
-                        "The specified collision type is not implemented!\n");
-                    break;
-            }
-        }
+    const Component& compo{*compoPlan.compo};
+    const Real tau{compo.tauRef};
+    const Real* pdt{pTimeStep()};
+    switch (compo.latticeType) {
+        case Lattice_D3Q15:
+            ops_par_loop(KerCollideBGKIsothermalBulkD3Q15,
+                         "KerCollideBGKIsothermalBulkD3Q15", plan.block->Get(),
+                         SpaceDim(), iterRng.data(),
+                         ops_arg_dat(plan.fStage, NUMXI, LOCALSTENCIL,
+                                     g_fStage().Type(), OPS_RW),
+                         ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL, g_f().Type(),
+                                     OPS_READ),
+                         ops_arg_dat(compoPlan.descriptor, 1, LOCALSTENCIL,
+                                     "short", OPS_READ),
+                         ops_arg_dat(compoPlan.rho, 1, LOCALSTENCIL, "double",
+                                     OPS_READ),
+                         ops_arg_dat(compoPlan.u, 1, LOCALSTENCIL, "double",
+                                     OPS_READ),
+                         ops_arg_dat(compoPlan.v, 1, LOCALSTENCIL, "double",
+                                     OPS_READ),
+                         ops_arg_dat(compoPlan.w, 1, LOCALSTENCIL, "double",
+                                     OPS_READ),
+                         ops_arg_gbl(&tau, 1, "double", OPS_READ),
+                         ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                         ops_arg_gbl(compo.index, 2, "int", OPS_READ),
+                         ops_arg_reduce(plan.bulkInvalidHandle, 1, "int",
+                                        OPS_INC));
+            found = true;
+            break;
+        case Lattice_D3Q19:
+            ops_par_loop(KerCollideBGKIsothermalBulkD3Q19,
+                         "KerCollideBGKIsothermalBulkD3Q19", plan.block->Get(),
+                         SpaceDim(), iterRng.data(),
+                         ops_arg_dat(plan.fStage, NUMXI, LOCALSTENCIL,
+                                     g_fStage().Type(), OPS_RW),
+                         ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL, g_f().Type(),
+                                     OPS_READ),
+                         ops_arg_dat(compoPlan.descriptor, 1, LOCALSTENCIL,
+                                     "short", OPS_READ),
+                         ops_arg_dat(compoPlan.rho, 1, LOCALSTENCIL, "double",
+                                     OPS_READ),
+                         ops_arg_dat(compoPlan.u, 1, LOCALSTENCIL, "double",
+                                     OPS_READ),
+                         ops_arg_dat(compoPlan.v, 1, LOCALSTENCIL, "double",
+                                     OPS_READ),
+                         ops_arg_dat(compoPlan.w, 1, LOCALSTENCIL, "double",
+                                     OPS_READ),
+                         ops_arg_gbl(&tau, 1, "double", OPS_READ),
+                         ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                         ops_arg_gbl(compo.index, 2, "int", OPS_READ),
+                         ops_arg_reduce(plan.bulkInvalidHandle, 1, "int",
+                                        OPS_INC));
+            found = true;
+            break;
+        default:
+            break;
+    }
+    if (found) {
+        plan.bulkLoopNum++;
     }
 #endif // OPS_3D
+    return found;
 }
 
-void UpdateMacroVars3D() {
+/*!
+ * Collide the distributions within iterRng of a block. The branch-free
+ * kernels are used if bulk is true and they are available.
+ */
+void CollideBlock3D(BlockPlan& plan, std::vector<int>& iterRng,
+                    const bool bulk) {
 #ifdef OPS_3D
-    for (const auto& idBlock : g_Block()) {
-        const Block& block{idBlock.second};
-        std::vector<int> iterRng;
-        iterRng.assign(block.WholeRange().begin(), block.WholeRange().end());
-        const int blockIndex{block.ID()};
+    for (const ComponentPlan& compoPlan : plan.components) {
+        const Component& compo{*compoPlan.compo};
+        const CollisionType collisionType{compo.collisionType};
+        const Real tau{compo.tauRef};
         const Real* pdt{pTimeStep()};
-        for (const auto& idCompo : g_Components()) {
-            const Component& compo{idCompo.second};
-            for (auto& macroVar : compo.macroVars) {
-                const int varId{macroVar.second.id};
-                const VariableTypes varType{macroVar.first};
-                switch (varType) {
-                    case Variable_Rho:
-                        ops_par_loop(
-                            KerCalcDensity3D, "KerCalcDensity3D", block.Get(),
-                            SpaceDim(), iterRng.data(),
-                            ops_arg_dat(g_MacroVars().at(varId).at(blockIndex),
-                                        1, LOCALSTENCIL, "double", OPS_RW),
-                            ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
-                                        "double", OPS_READ),
-                            ops_arg_dat(
-                                g_NodeType().at(compo.id).at(blockIndex), 1,
-                                LOCALSTENCIL, "int", OPS_READ),
-                            ops_arg_gbl(compo.index, 2, "int", OPS_READ));
-                        break;
-                    case Variable_U:
-                        ops_par_loop(
-                            KerCalcU3D, "KerCalcU3D", block.Get(), SpaceDim(),
-                            iterRng.data(),
-                            ops_arg_dat(g_MacroVars().at(varId).at(blockIndex),
-                                        1, LOCALSTENCIL, "double", OPS_RW),
-                            ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
-                                        "double", OPS_READ),
-                            ops_arg_dat(
-                                g_NodeType().at(compo.id).at(blockIndex), 1,
-                                LOCALSTENCIL, "int", OPS_READ),
-                            ops_arg_dat(
-                                g_MacroVars()
-                                    .at(compo.macroVars.at(Variable_Rho).id)
-                                    .at(blockIndex),
-                                1, LOCALSTENCIL, "double", OPS_READ),
-                            ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+        switch (collisionType) {
+            case Collision_BGKIsothermal2nd:
+                if (bulk &&
+                    CollideBGKIsothermalBulk3D(plan, compoPlan, iterRng)) {
+                    break;
+                }
+                switch (compo.latticeType) {
+                    case Lattice_D3Q19:
+                        ops_par_loop(KerCollideBGKIsothermalD3Q19,
+                                     "KerCollideBGKIsothermalD3Q19",
+                                     plan.block->Get(), SpaceDim(),
+                                     iterRng.data(),
+                                     ops_arg_dat(plan.fStage, NUMXI,
+                                                 LOCALSTENCIL,
+                                                 g_fStage().Type(), OPS_WRITE),
+                                     ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                                 g_f().Type(), OPS_READ),
+                                     ops_arg_dat(plan.coordinates, SpaceDim(),
+                                                 LOCALSTENCIL, "double",
+                                                 OPS_READ),
+                                     ops_arg_dat(compoPlan.descriptor, 1,
+                                                 LOCALSTENCIL, "short",
+                                                 OPS_READ),
+                                     ops_arg_dat(compoPlan.rho, 1, LOCALSTENCIL,
+                                                 "double", OPS_READ),
+                                     ops_arg_dat(compoPlan.u, 1, LOCALSTENCIL,
+                                                 "double", OPS_READ),
+                                     ops_arg_dat(compoPlan.v, 1, LOCALSTENCIL,
+                                                 "double", OPS_READ),
+                                     ops_arg_dat(compoPlan.w, 1, LOCALSTENCIL,
+                                                 "double", OPS_READ),
+                                     ops_arg_gbl(&tau, 1, "double", OPS_READ),
+                                     ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                                     ops_arg_gbl(compo.index, 2, "int",
+                                                 OPS_READ));
                         break;
-                    case Variable_V:
-                        ops_par_loop(
-                            KerCalcV3D, "KerCalcV3D", block.Get(), SpaceDim(),
-                            iterRng.data(),
-                            ops_arg_dat(g_MacroVars().at(varId).at(blockIndex),
-                                        1, LOCALSTENCIL, "double", OPS_RW),
-                            ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
-                                        "double", OPS_READ),
-                            ops_arg_dat(
-                                g_NodeType().at(compo.id).at(blockIndex), 1,
-                                LOCALSTENCIL, "int", OPS_READ),
-                            ops_arg_dat(
-                                g_MacroVars()
-                                    .at(compo.macroVars.at(Variable_Rho).id)
-                                    .at(blockIndex),
-                                1, LOCALSTENCIL, "double", OPS_READ),
-                            ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                    case Lattice_D3Q15:
+                        ops_par_loop(KerCollideBGKIsothermalD3Q15,
+                                     "KerCollideBGKIsothermalD3Q15",
+                                     plan.block->Get(), SpaceDim(),
+                                     iterRng.data(),
+                                     ops_arg_dat(plan.fStage, NUMXI,
+                                                 LOCALSTENCIL,
+                                                 g_fStage().Type(), OPS_WRITE),
+                                     ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                                 g_f().Type(), OPS_READ),
+                                     ops_arg_dat(plan.coordinates, SpaceDim(),
+                                                 LOCALSTENCIL, "double",
+                                                 OPS_READ),
+                                     ops_arg_dat(compoPlan.descriptor, 1,
+                                                 LOCALSTENCIL, "short",
+                                                 OPS_READ),
+                                     ops_arg_dat(compoPlan.rho, 1, LOCALSTENCIL,
+                                                 "double", OPS_READ),
+                                     ops_arg_dat(compoPlan.u, 1, LOCALSTENCIL,
+                                                 "double", OPS_READ),
+                                     ops_arg_dat(compoPlan.v, 1, LOCALSTENCIL,
+                                                 "double", OPS_READ),
+                                     ops_arg_dat(compoPlan.w, 1, LOCALSTENCIL,
+                                                 "double", OPS_READ),
+                                     ops_arg_gbl(&tau, 1, "double", OPS_READ),
+                                     ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                                     ops_arg_gbl(compo.index, 2, "int",
+                                                 OPS_READ));
                         break;
-                    case Variable_W:
-                        ops_par_loop(
-                            KerCalcW3D, "KerCalcW3D", block.Get(), SpaceDim(),
-                            iterRng.data(),
-                            ops_arg_dat(g_MacroVars().at(varId).at(blockIndex),
-                                        1, LOCALSTENCIL, "double", OPS_RW),
-                            ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
-                                        "double", OPS_READ),
-                            ops_arg_dat(
-                                g_NodeType().at(compo.id).at(blockIndex), 1,
-                                LOCALSTENCIL, "int", OPS_READ),
-                            ops_arg_dat(
-                                g_MacroVars()
-                                    .at(compo.macroVars.at(Variable_Rho).id)
-                                    .at(blockIndex),
-                                1, LOCALSTENCIL, "double", OPS_READ),
-                            ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                    default:
+                        ops_par_loop(KerCollideBGKIsothermal3D,
+                                     "KerCollideBGKIsothermal3D",
+                                     plan.block->Get(), SpaceDim(),
+                                     iterRng.data(),
+                                     ops_arg_dat(plan.fStage, NUMXI,
+                                                 LOCALSTENCIL,
+                                                 g_fStage().Type(), OPS_WRITE),
+                                     ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                                 g_f().Type(), OPS_READ),
+                                     ops_arg_dat(plan.coordinates, SpaceDim(),
+                                                 LOCALSTENCIL, "double",
+                                                 OPS_READ),
+                                     ops_arg_dat(compoPlan.descriptor, 1,
+                                                 LOCALSTENCIL, "short",
+                                                 OPS_READ),
+                                     ops_arg_dat(compoPlan.rho, 1, LOCALSTENCIL,
+                                                 "double", OPS_READ),
+                                     ops_arg_dat(compoPlan.u, 1, LOCALSTENCIL,
+                                                 "double", OPS_READ),
+                                     ops_arg_dat(compoPlan.v, 1, LOCALSTENCIL,
+                                                 "double", OPS_READ),
+                                     ops_arg_dat(compoPlan.w, 1, LOCALSTENCIL,
+                                                 "double", OPS_READ),
+                                     ops_arg_gbl(&tau, 1, "double", OPS_READ),
+                                     ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                                     ops_arg_gbl(compo.index, 2, "int",
+                                                 OPS_READ));
                         break;
-                    case Variable_U_Force:
-                        ops_par_loop(
-                            KerCalcUForce3D, "KerCalcUForce3D", block.Get(),
-                            SpaceDim(), iterRng.data(),
-                            ops_arg_dat(g_MacroVars().at(varId).at(blockIndex),
-                                        1, LOCALSTENCIL, "double", OPS_RW),
-                            ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
-                                        "double", OPS_READ),
-                            ops_arg_dat(
-                                g_NodeType().at(compo.id).at(blockIndex), 1,
-                                LOCALSTENCIL, "int", OPS_READ),
-                            ops_arg_dat(g_CoordinateXYZ()[blockIndex],
-                                        SpaceDim(), LOCALSTENCIL, "double",
-                                        OPS_READ),
-                            ops_arg_dat(
-                                g_MacroBodyforce().at(compo.id).at(blockIndex),
+                }
+                break;
+            case Collision_BGKThermal4th:
+                ops_par_loop(KerCollideBGKThermal3D, "KerCollideBGKThermal3D",
+                             plan.block->Get(), SpaceDim(), iterRng.data(),
+                             ops_arg_dat(plan.fStage, NUMXI, LOCALSTENCIL,
+                                         g_fStage().Type(), OPS_WRITE),
+                             ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                         g_f().Type(), OPS_READ),
+                             ops_arg_dat(compoPlan.descriptor, 1, LOCALSTENCIL,
+                                         "short", OPS_READ),
+                             ops_arg_dat(compoPlan.rho, 1, LOCALSTENCIL,
+                                         "double", OPS_READ),
+                             ops_arg_dat(compoPlan.u, 1, LOCALSTENCIL, "double",
+                                         OPS_READ),
+                             ops_arg_dat(compoPlan.v, 1, LOCALSTENCIL, "double",
+                                         OPS_READ),
+                             ops_arg_dat(compoPlan.w, 1, LOCALSTENCIL, "double",
+                                         OPS_READ),
+                             ops_arg_dat(compoPlan.temperature, 1, LOCALSTENCIL,
+                                         "double", OPS_READ),
+                             ops_arg_gbl(&tau, 1, "double", OPS_READ),
+                             ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                             ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                break;
+            default:
+                ops_printf(
+                    "The specified collision type is not implemented!\n");
+                break;
+        }
+    }
+#endif // OPS_3D
+}
+
+/*!
+ * The bulk nodes are collided by the branch-free kernels and the shell
+ * by the checked ones, see CollideBGKIsothermalBulkLattice. The invalid
+ * bulk nodes are checked after all the blocks.
+ */
+void PreDefinedCollision3D() {
+    ForEachBlockPlan([](BlockPlan& plan) {
+        for (auto& range : plan.bulkRanges) {
+            CollideBlock3D(plan, range, true);
+        }
+        for (auto& range : plan.shellRanges) {
+            CollideBlock3D(plan, range, false);
+        }
+    });
+    CheckBulkCollision();
+}
+
+/*!
+ * Calculate the moments and the collision within iterRng of a block by
+ * the fused kernels, where the post-collision distribution is written
+ * into fDest
+ */
+static void FusedCollisionBlock3D(const BlockPlan& plan,
+                                  std::vector<int>& iterRng, ops_dat fDest) {
+#ifdef OPS_3D
+    const Real* pdt{pTimeStep()};
+    for (const ComponentPlan& compoPlan : plan.components) {
+        const Component& compo{*compoPlan.compo};
+        const Real tau{compo.tauRef};
+        switch (compo.latticeType) {
+            case Lattice_D3Q19:
+                ops_par_loop(KerCollideBGKIsothermalFusedD3Q19,
+                             "KerCollideBGKIsothermalFusedD3Q19",
+                             plan.block->Get(), SpaceDim(), iterRng.data(),
+                             ops_arg_dat(fDest, NUMXI, LOCALSTENCIL,
+                                         g_fStage().Type(), OPS_WRITE),
+                             ops_arg_dat(compoPlan.rho, 1, LOCALSTENCIL,
+                                         "double", OPS_RW),
+                             ops_arg_dat(compoPlan.u, 1, LOCALSTENCIL, "double",
+                                         OPS_RW),
+                             ops_arg_dat(compoPlan.v, 1, LOCALSTENCIL, "double",
+                                         OPS_RW),
+                             ops_arg_dat(compoPlan.w, 1, LOCALSTENCIL, "double",
+                                         OPS_RW),
+                             ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                         g_f().Type(), OPS_READ),
+                             ops_arg_dat(plan.coordinates, SpaceDim(),
+                                         LOCALSTENCIL, "double", OPS_READ),
+                             ops_arg_dat(compoPlan.acceleration, SpaceDim(),
+                                         LOCALSTENCIL, "double", OPS_READ),
+                             ops_arg_dat(compoPlan.descriptor, 1, LOCALSTENCIL,
+                                         "short", OPS_READ),
+                             ops_arg_gbl(&tau, 1, "double", OPS_READ),
+                             ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                             ops_arg_gbl(&compoPlan.bodyForceOn, 1, "int",
+                                         OPS_READ),
+                             ops_arg_gbl(compoPlan.forceCorrection, 1, "int",
+                                         OPS_READ),
+                             ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                break;
+            case Lattice_D3Q15:
+                ops_par_loop(KerCollideBGKIsothermalFusedD3Q15,
+                             "KerCollideBGKIsothermalFusedD3Q15",
+                             plan.block->Get(), SpaceDim(), iterRng.data(),
+                             ops_arg_dat(fDest, NUMXI, LOCALSTENCIL,
+                                         g_fStage().Type(), OPS_WRITE),
+                             ops_arg_dat(compoPlan.rho, 1, LOCALSTENCIL,
+                                         "double", OPS_RW),
+                             ops_arg_dat(compoPlan.u, 1, LOCALSTENCIL, "double",
+                                         OPS_RW),
+                             ops_arg_dat(compoPlan.v, 1, LOCALSTENCIL, "double",
+                                         OPS_RW),
+                             ops_arg_dat(compoPlan.w, 1, LOCALSTENCIL, "double",
+                                         OPS_RW),
+                             ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                         g_f().Type(), OPS_READ),
+                             ops_arg_dat(plan.coordinates, SpaceDim(),
+                                         LOCALSTENCIL, "double", OPS_READ),
+                             ops_arg_dat(compoPlan.acceleration, SpaceDim(),
+                                         LOCALSTENCIL, "double", OPS_READ),
+                             ops_arg_dat(compoPlan.descriptor, 1, LOCALSTENCIL,
+                                         "short", OPS_READ),
+                             ops_arg_gbl(&tau, 1, "double", OPS_READ),
+                             ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                             ops_arg_gbl(&compoPlan.bodyForceOn, 1, "int",
+                                         OPS_READ),
+                             ops_arg_gbl(compoPlan.forceCorrection, 1, "int",
+                                         OPS_READ),
+                             ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                break;
+            default:
+                ops_par_loop(KerCollideBGKIsothermalFused3D,
+                             "KerCollideBGKIsothermalFused3D",
+                             plan.block->Get(), SpaceDim(), iterRng.data(),
+                             ops_arg_dat(fDest, NUMXI, LOCALSTENCIL,
+                                         g_fStage().Type(), OPS_WRITE),
+                             ops_arg_dat(compoPlan.rho, 1, LOCALSTENCIL,
+                                         "double", OPS_RW),
+                             ops_arg_dat(compoPlan.u, 1, LOCALSTENCIL, "double",
+                                         OPS_RW),
+                             ops_arg_dat(compoPlan.v, 1, LOCALSTENCIL, "double",
+                                         OPS_RW),
+                             ops_arg_dat(compoPlan.w, 1, LOCALSTENCIL, "double",
+                                         OPS_RW),
+                             ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                         g_f().Type(), OPS_READ),
+                             ops_arg_dat(plan.coordinates, SpaceDim(),
+                                         LOCALSTENCIL, "double", OPS_READ),
+                             ops_arg_dat(compoPlan.acceleration, SpaceDim(),
+                                         LOCALSTENCIL, "double", OPS_READ),
+                             ops_arg_dat(compoPlan.descriptor, 1, LOCALSTENCIL,
+                                         "short", OPS_READ),
+                             ops_arg_gbl(&tau, 1, "double", OPS_READ),
+                             ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                             ops_arg_gbl(&compoPlan.bodyForceOn, 1, "int",
+                                         OPS_READ),
+                             ops_arg_gbl(compoPlan.forceCorrection, 1, "int",
+                                         OPS_READ),
+                             ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                break;
+        }
+    }
+#endif // OPS_3D
+}
+
+void FusedCollision3D() {
+    ForEachBlockPlan([](BlockPlan& plan) {
+        for (auto& iterRng : plan.activeRanges) {
+            FusedCollisionBlock3D(plan, iterRng, plan.fStage);
+        }
+    });
+}
+
+/*!
+ * Pull-stream-collide the Fluid boxes within iterRng of a block by the fused
+ * kernels, return false without any loop if a lattice has no such kernel.
+ */
+static bool PullStreamCollideBlock3D(const BlockPlan& plan,
+                                     std::vector<int>& iterRng) {
+    bool found{false};
+#ifdef OPS_3D
+    for (const ComponentPlan& compoPlan : plan.components) {
+        switch (compoPlan.compo->latticeType) {
+            case Lattice_D3Q19:
+            case Lattice_D3Q15:
+                break;
+            default:
+                return false;
+        }
+    }
+    const Real* pdt{pTimeStep()};
+    for (const ComponentPlan& compoPlan : plan.components) {
+        const Component& compo{*compoPlan.compo};
+        const Real tau{compo.tauRef};
+        switch (compo.latticeType) {
+            case Lattice_D3Q19:
+                ops_par_loop(KerPullStreamCollideD3Q19,
+                             "KerPullStreamCollideD3Q19", plan.block->Get(),
+                             SpaceDim(), iterRng.data(),
+                             ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                         g_f().Type(), OPS_RW),
+                             ops_arg_dat(plan.fNext, NUMXI, LOCALSTENCIL,
+                                         g_fNext().Type(), OPS_WRITE),
+                             ops_arg_dat(compoPlan.rho, 1, LOCALSTENCIL,
+                                         "double", OPS_RW),
+                             ops_arg_dat(compoPlan.u, 1, LOCALSTENCIL, "double",
+                                         OPS_RW),
+                             ops_arg_dat(compoPlan.v, 1, LOCALSTENCIL, "double",
+                                         OPS_RW),
+                             ops_arg_dat(compoPlan.w, 1, LOCALSTENCIL, "double",
+                                         OPS_RW),
+                             ops_arg_dat(plan.fStage, NUMXI,
+                                         ONEPTLATTICESTENCIL, g_fStage().Type(),
+                                         OPS_READ),
+                             ops_arg_dat(plan.coordinates, SpaceDim(),
+                                         LOCALSTENCIL, "double", OPS_READ),
+                             ops_arg_dat(compoPlan.acceleration, SpaceDim(),
+                                         LOCALSTENCIL, "double", OPS_READ),
+                             ops_arg_dat(compoPlan.descriptor, 1, LOCALSTENCIL,
+                                         "short", OPS_READ),
+                             ops_arg_gbl(&tau, 1, "double", OPS_READ),
+                             ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                             ops_arg_gbl(&compoPlan.bodyForceOn, 1, "int",
+                                         OPS_READ),
+                             ops_arg_gbl(compoPlan.forceCorrection, 1, "int",
+                                         OPS_READ),
+                             ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                break;
+            case Lattice_D3Q15:
+                ops_par_loop(KerPullStreamCollideD3Q15,
+                             "KerPullStreamCollideD3Q15", plan.block->Get(),
+                             SpaceDim(), iterRng.data(),
+                             ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                         g_f().Type(), OPS_RW),
+                             ops_arg_dat(plan.fNext, NUMXI, LOCALSTENCIL,
+                                         g_fNext().Type(), OPS_WRITE),
+                             ops_arg_dat(compoPlan.rho, 1, LOCALSTENCIL,
+                                         "double", OPS_RW),
+                             ops_arg_dat(compoPlan.u, 1, LOCALSTENCIL, "double",
+                                         OPS_RW),
+                             ops_arg_dat(compoPlan.v, 1, LOCALSTENCIL, "double",
+                                         OPS_RW),
+                             ops_arg_dat(compoPlan.w, 1, LOCALSTENCIL, "double",
+                                         OPS_RW),
+                             ops_arg_dat(plan.fStage, NUMXI,
+                                         ONEPTLATTICESTENCIL, g_fStage().Type(),
+                                         OPS_READ),
+                             ops_arg_dat(plan.coordinates, SpaceDim(),
+                                         LOCALSTENCIL, "double", OPS_READ),
+                             ops_arg_dat(compoPlan.acceleration, SpaceDim(),
+                                         LOCALSTENCIL, "double", OPS_READ),
+                             ops_arg_dat(compoPlan.descriptor, 1, LOCALSTENCIL,
+                                         "short", OPS_READ),
+                             ops_arg_gbl(&tau, 1, "double", OPS_READ),
+                             ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                             ops_arg_gbl(&compoPlan.bodyForceOn, 1, "int",
+                                         OPS_READ),
+                             ops_arg_gbl(compoPlan.forceCorrection, 1, "int",
+                                         OPS_READ),
+                             ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                break;
+            default:
+                break;
+        }
+    }
+    found = true;
+#endif // OPS_3D
+    return found;
+}
+
+void PullStreamCollision3D() {
+    ForEachBlockPlan([](BlockPlan& plan) {
+        for (auto& range : plan.fluidRanges) {
+            if (!PullStreamCollideBlock3D(plan, range)) {
+                StreamFluidBlock3D(plan, range);
+                FusedCollisionBlock3D(plan, range, plan.fNext);
+            }
+        }
+        for (auto& range : plan.bulkBoundaryRanges) {
+            StreamBlock3D(plan, range);
+        }
+        for (auto& range : plan.shellRanges) {
+            StreamBlock3D(plan, range);
+        }
+    });
+}
+
+void FusedCollisionNonFluid3D() {
+    ForEachBlockPlan([](BlockPlan& plan) {
+        for (auto& range : plan.bulkBoundaryRanges) {
+            FusedCollisionBlock3D(plan, range, plan.fNext);
+        }
+        for (auto& range : plan.shellRanges) {
+            FusedCollisionBlock3D(plan, range, plan.fNext);
+        }
+    });
+}
+
+void InPlaceCollision3D() {
+#ifdef OPS_3D
+    const Real* pdt{pTimeStep()};
+    ForEachBlockPlan([&](BlockPlan& plan) {
+        for (auto& iterRng : plan.activeRanges) {
+            for (const ComponentPlan& compoPlan : plan.components) {
+                const Component& compo{*compoPlan.compo};
+                const Real tau{compo.tauRef};
+                ops_par_loop(KerCollideBGKIsothermalInPlace3D,
+                             "KerCollideBGKIsothermalInPlace3D",
+                             plan.block->Get(), SpaceDim(), iterRng.data(),
+                             ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                         g_f().Type(), OPS_RW),
+                             ops_arg_dat(plan.fStage, g_fStage().DataDim(),
+                                         LOCALSTENCIL, g_fStage().Type(),
+                                         OPS_RW),
+                             ops_arg_dat(compoPlan.rho, 1, LOCALSTENCIL,
+                                         "double", OPS_RW),
+                             ops_arg_dat(compoPlan.u, 1, LOCALSTENCIL, "double",
+                                         OPS_RW),
+                             ops_arg_dat(compoPlan.v, 1, LOCALSTENCIL, "double",
+                                         OPS_RW),
+                             ops_arg_dat(compoPlan.w, 1, LOCALSTENCIL, "double",
+                                         OPS_RW),
+                             ops_arg_dat(plan.coordinates, SpaceDim(),
+                                         LOCALSTENCIL, "double", OPS_READ),
+                             ops_arg_dat(compoPlan.acceleration, SpaceDim(),
+                                         LOCALSTENCIL, "double", OPS_READ),
+                             ops_arg_dat(compoPlan.descriptor, 1, LOCALSTENCIL,
+                                         "short", OPS_READ),
+                             ops_arg_gbl(&tau, 1, "double", OPS_READ),
+                             ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                             ops_arg_gbl(&compoPlan.bodyForceOn, 1, "int",
+                                         OPS_READ),
+                             ops_arg_gbl(compoPlan.forceCorrection, 1, "int",
+                                         OPS_READ),
+                             ops_arg_gbl(&compoPlan.swapStart, 1, "int",
+                                         OPS_READ),
+                             ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+            }
+        }
+    });
+#endif // OPS_3D
+}
+
+/*!
+ * Calculate the macroscopic variables one by one within iterRng, which is
+ * only used if the density and velocity of a component are not all defined.
+ */
+void UpdateMacroVarsSeparately3D(const Block& block, const Component& compo,
+                                 std::vector<int> iterRng) {
+#ifdef OPS_3D
+    const int blockIndex{block.ID()};
+    const Real* pdt{pTimeStep()};
+    for (auto& macroVar : compo.macroVars) {
+        const int varId{macroVar.second.id};
+        const VariableTypes varType{macroVar.first};
+        switch (varType) {
+            case Variable_Rho:
+                ops_par_loop(
+                    KerCalcDensity3D, "KerCalcDensity3D", block.Get(),
+                    SpaceDim(), iterRng.data(),
+                    ops_arg_dat(g_MacroVars().at(varId).at(blockIndex),
+                                1, LOCALSTENCIL, "double", OPS_RW),
+                    ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
+                                g_f().Type(), OPS_READ),
+                    ops_arg_dat(
+                        g_NodeDescriptor().at(compo.id).at(blockIndex), 1,
+                        LOCALSTENCIL, "short", OPS_READ),
+                    ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                break;
+            case Variable_U:
+                ops_par_loop(
+                    KerCalcU3D, "KerCalcU3D", block.Get(), SpaceDim(),
+                    iterRng.data(),
+                    ops_arg_dat(g_MacroVars().at(varId).at(blockIndex),
+                                1, LOCALSTENCIL, "double", OPS_RW),
+                    ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
+                                g_f().Type(), OPS_READ),
+                    ops_arg_dat(
+                        g_NodeDescriptor().at(compo.id).at(blockIndex), 1,
+                        LOCALSTENCIL, "short", OPS_READ),
+                    ops_arg_dat(
+                        g_MacroVars()
+                            .at(compo.macroVars.at(Variable_Rho).id)
+                            .at(blockIndex),
+                        1, LOCALSTENCIL, "double", OPS_READ),
+                    ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                break;
+            case Variable_V:
+                ops_par_loop(
+                    KerCalcV3D, "KerCalcV3D", block.Get(), SpaceDim(),
+                    iterRng.data(),
+                    ops_arg_dat(g_MacroVars().at(varId).at(blockIndex),
+                                1, LOCALSTENCIL, "double", OPS_RW),
+                    ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
+                                g_f().Type(), OPS_READ),
+                    ops_arg_dat(
+                        g_NodeDescriptor().at(compo.id).at(blockIndex), 1,
+                        LOCALSTENCIL, "short", OPS_READ),
+                    ops_arg_dat(
+                        g_MacroVars()
+                            .at(compo.macroVars.at(Variable_Rho).id)
+                            .at(blockIndex),
+                        1, LOCALSTENCIL, "double", OPS_READ),
+                    ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                break;
+            case Variable_W:
+                ops_par_loop(
+                    KerCalcW3D, "KerCalcW3D", block.Get(), SpaceDim(),
+                    iterRng.data(),
+                    ops_arg_dat(g_MacroVars().at(varId).at(blockIndex),
+                                1, LOCALSTENCIL, "double", OPS_RW),
+                    ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
+                                g_f().Type(), OPS_READ),
+                    ops_arg_dat(
+                        g_NodeDescriptor().at(compo.id).at(blockIndex), 1,
+                        LOCALSTENCIL, "short", OPS_READ),
+                    ops_arg_dat(
+                        g_MacroVars()
+                            .at(compo.macroVars.at(Variable_Rho).id)
+                            .at(blockIndex),
+                        1, LOCALSTENCIL, "double", OPS_READ),
+                    ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                break;
+            case Variable_U_Force:
+                ops_par_loop(
+                    KerCalcUForce3D, "KerCalcUForce3D", block.Get(),
+                    SpaceDim(), iterRng.data(),
+                    ops_arg_dat(g_MacroVars().at(varId).at(blockIndex),
+                                1, LOCALSTENCIL, "double", OPS_RW),
+                    ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
+                                g_f().Type(), OPS_READ),
+                    ops_arg_dat(
+                        g_NodeDescriptor().at(compo.id).at(blockIndex), 1,
+                        LOCALSTENCIL, "short", OPS_READ),
+                    ops_arg_dat(g_CoordinateXYZ()[blockIndex],
+                                SpaceDim(), LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_dat(AccelerationField(compo.id).at(blockIndex),
                                 SpaceDim(), LOCALSTENCIL, "double", OPS_READ),
-                            ops_arg_dat(
-                                g_MacroVars()
-                                    .at(compo.macroVars.at(Variable_Rho).id)
-                                    .at(blockIndex),
-                                1, LOCALSTENCIL, "double", OPS_READ),
-                            ops_arg_gbl(pdt, 1, "double", OPS_READ),
-                            ops_arg_gbl(compo.index, 2, "int", OPS_READ));
-                        break;
-                    case Variable_V_Force:
-                        ops_par_loop(
-                            KerCalcVForce3D, "KerCalcVForce3D", block.Get(),
-                            SpaceDim(), iterRng.data(),
-                            ops_arg_dat(g_MacroVars().at(varId).at(blockIndex),
-                                        1, LOCALSTENCIL, "double", OPS_RW),
-                            ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
-                                        "double", OPS_READ),
-                            ops_arg_dat(
-                                g_NodeType().at(compo.id).at(blockIndex), 1,
-                                LOCALSTENCIL, "int", OPS_READ),
-                            ops_arg_dat(g_CoordinateXYZ()[blockIndex],
-                                        SpaceDim(), LOCALSTENCIL, "double",
-                                        OPS_READ),
-                            ops_arg_dat(
-                                g_MacroBodyforce().at(compo.id).at(blockIndex),
+                    ops_arg_dat(
+                        g_MacroVars()
+                            .at(compo.macroVars.at(Variable_Rho).id)
+                            .at(blockIndex),
+                        1, LOCALSTENCIL, "double", OPS_READ),
+                    ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                    ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                break;
+            case Variable_V_Force:
+                ops_par_loop(
+                    KerCalcVForce3D, "KerCalcVForce3D", block.Get(),
+                    SpaceDim(), iterRng.data(),
+                    ops_arg_dat(g_MacroVars().at(varId).at(blockIndex),
+                                1, LOCALSTENCIL, "double", OPS_RW),
+                    ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
+                                g_f().Type(), OPS_READ),
+                    ops_arg_dat(
+                        g_NodeDescriptor().at(compo.id).at(blockIndex), 1,
+                        LOCALSTENCIL, "short", OPS_READ),
+                    ops_arg_dat(g_CoordinateXYZ()[blockIndex],
+                                SpaceDim(), LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_dat(AccelerationField(compo.id).at(blockIndex),
                                 SpaceDim(), LOCALSTENCIL, "double", OPS_READ),
-                            ops_arg_dat(
-                                g_MacroVars()
-                                    .at(compo.macroVars.at(Variable_Rho).id)
-                                    .at(blockIndex),
-                                1, LOCALSTENCIL, "double", OPS_READ),
-                            ops_arg_gbl(pdt, 1, "double", OPS_READ),
-                            ops_arg_gbl(compo.index, 2, "int", OPS_READ));
-                        break;
-                    case Variable_W_Force:
-                        ops_par_loop(
-                            KerCalcWForce3D, "KerCalcWForce3D", block.Get(),
-                            SpaceDim(), iterRng.data(),
-                            ops_arg_dat(g_MacroVars().at(varId).at(blockIndex),
-                                        1, LOCALSTENCIL, "double", OPS_RW),
-                            ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
-                                        "double", OPS_READ),
-                            ops_arg_dat(
-                                g_NodeType().at(compo.id).at(blockIndex), 1,
-                                LOCALSTENCIL, "int", OPS_READ),
-                            ops_arg_dat(g_CoordinateXYZ()[blockIndex],
-                                        SpaceDim(), LOCALSTENCIL, "double",
-                                        OPS_READ),
-                            ops_arg_dat(
-                                g_MacroBodyforce().at(compo.id).at(blockIndex),
+                    ops_arg_dat(
+                        g_MacroVars()
+                            .at(compo.macroVars.at(Variable_Rho).id)
+                            .at(blockIndex),
+                        1, LOCALSTENCIL, "double", OPS_READ),
+                    ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                    ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                break;
+            case Variable_W_Force:
+                ops_par_loop(
+                    KerCalcWForce3D, "KerCalcWForce3D", block.Get(),
+                    SpaceDim(), iterRng.data(),
+                    ops_arg_dat(g_MacroVars().at(varId).at(blockIndex),
+                                1, LOCALSTENCIL, "double", OPS_RW),
+                    ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
+                                g_f().Type(), OPS_READ),
+                    ops_arg_dat(
+                        g_NodeDescriptor().at(compo.id).at(blockIndex), 1,
+                        LOCALSTENCIL, "short", OPS_READ),
+                    ops_arg_dat(g_CoordinateXYZ()[blockIndex],
+                                SpaceDim(), LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_dat(AccelerationField(compo.id).at(blockIndex),
                                 SpaceDim(), LOCALSTENCIL, "double", OPS_READ),
-                            ops_arg_dat(
-                                g_MacroVars()
-                                    .at(compo.macroVars.at(Variable_Rho).id)
-                                    .at(blockIndex),
-                                1, LOCALSTENCIL, "double", OPS_READ),
-                            ops_arg_gbl(pdt, 1, "double", OPS_READ),
-                            ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                    ops_arg_dat(
+                        g_MacroVars()
+                            .at(compo.macroVars.at(Variable_Rho).id)
+                            .at(blockIndex),
+                        1, LOCALSTENCIL, "double", OPS_READ),
+                    ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                    ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                break;
+            default:
+                break;
+        }
+    }
+#endif // OPS_3D
+}
+
+void UpdateMacroVars3D() {
+#ifdef OPS_3D
+    const Real* pdt{pTimeStep()};
+    ForEachBlockPlan([&](BlockPlan& plan) {
+        for (auto& iterRng : plan.activeRanges) {
+            for (const ComponentPlan& compoPlan : plan.components) {
+                const Component& compo{*compoPlan.compo};
+                if (!compoPlan.densityVelocity) {
+                    UpdateMacroVarsSeparately3D(*plan.block, compo, iterRng);
+                    continue;
+                }
+                switch (compo.latticeType) {
+                    case Lattice_D3Q19:
+                        ops_par_loop(KerCalcMacroVarsD3Q19,
+                                     "KerCalcMacroVarsD3Q19", plan.block->Get(),
+                                     SpaceDim(), iterRng.data(),
+                                     ops_arg_dat(compoPlan.rho, 1, LOCALSTENCIL,
+                                                 "double", OPS_RW),
+                                     ops_arg_dat(compoPlan.u, 1, LOCALSTENCIL,
+                                                 "double", OPS_RW),
+                                     ops_arg_dat(compoPlan.v, 1, LOCALSTENCIL,
+                                                 "double", OPS_RW),
+                                     ops_arg_dat(compoPlan.w, 1, LOCALSTENCIL,
+                                                 "double", OPS_RW),
+                                     ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                                 g_f().Type(), OPS_READ),
+                                     ops_arg_dat(compoPlan.descriptor, 1,
+                                                 LOCALSTENCIL, "short",
+                                                 OPS_READ),
+                                     ops_arg_dat(plan.coordinates, SpaceDim(),
+                                                 LOCALSTENCIL, "double",
+                                                 OPS_READ),
+                                     ops_arg_dat(compoPlan.acceleration,
+                                                 SpaceDim(), LOCALSTENCIL,
+                                                 "double", OPS_READ),
+                                     ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                                     ops_arg_gbl(compoPlan.forceCorrection,
+                                                 SpaceDim(), "int", OPS_READ),
+                                     ops_arg_gbl(compo.index, 2, "int",
+                                                 OPS_READ));
+                        break;
+                    case Lattice_D3Q15:
+                        ops_par_loop(KerCalcMacroVarsD3Q15,
+                                     "KerCalcMacroVarsD3Q15", plan.block->Get(),
+                                     SpaceDim(), iterRng.data(),
+                                     ops_arg_dat(compoPlan.rho, 1, LOCALSTENCIL,
+                                                 "double", OPS_RW),
+                                     ops_arg_dat(compoPlan.u, 1, LOCALSTENCIL,
+                                                 "double", OPS_RW),
+                                     ops_arg_dat(compoPlan.v, 1, LOCALSTENCIL,
+                                                 "double", OPS_RW),
+                                     ops_arg_dat(compoPlan.w, 1, LOCALSTENCIL,
+                                                 "double", OPS_RW),
+                                     ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                                 g_f().Type(), OPS_READ),
+                                     ops_arg_dat(compoPlan.descriptor, 1,
+                                                 LOCALSTENCIL, "short",
+                                                 OPS_READ),
+                                     ops_arg_dat(plan.coordinates, SpaceDim(),
+                                                 LOCALSTENCIL, "double",
+                                                 OPS_READ),
+                                     ops_arg_dat(compoPlan.acceleration,
+                                                 SpaceDim(), LOCALSTENCIL,
+                                                 "double", OPS_READ),
+                                     ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                                     ops_arg_gbl(compoPlan.forceCorrection,
+                                                 SpaceDim(), "int", OPS_READ),
+                                     ops_arg_gbl(compo.index, 2, "int",
+                                                 OPS_READ));
                         break;
                     default:
+                        ops_par_loop(KerCalcMacroVars3D, "KerCalcMacroVars3D",
+                                     plan.block->Get(), SpaceDim(),
+                                     iterRng.data(),
+                                     ops_arg_dat(compoPlan.rho, 1, LOCALSTENCIL,
+                                                 "double", OPS_RW),
+                                     ops_arg_dat(compoPlan.u, 1, LOCALSTENCIL,
+                                                 "double", OPS_RW),
+                                     ops_arg_dat(compoPlan.v, 1, LOCALSTENCIL,
+                                                 "double", OPS_RW),
+                                     ops_arg_dat(compoPlan.w, 1, LOCALSTENCIL,
+                                                 "double", OPS_RW),
+                                     ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                                 g_f().Type(), OPS_READ),
+                                     ops_arg_dat(compoPlan.descriptor, 1,
+                                                 LOCALSTENCIL, "short",
+                                                 OPS_READ),
+                                     ops_arg_dat(plan.coordinates, SpaceDim(),
+                                                 LOCALSTENCIL, "double",
+                                                 OPS_READ),
+                                     ops_arg_dat(compoPlan.acceleration,
+                                                 SpaceDim(), LOCALSTENCIL,
+                                                 "double", OPS_READ),
+                                     ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                                     ops_arg_gbl(compoPlan.forceCorrection,
+                                                 SpaceDim(), "int", OPS_READ),
+                                     ops_arg_gbl(compo.index, 2, "int",
+                                                 OPS_READ));
                         break;
                 }
             }
         }
-    }
+    });
 #endif // OPS_3D
 }
 
 void PreDefinedBodyForce3D() {
 #ifdef OPS_3D
-    for (const auto& idBlock : g_Block()) {
-        const Block& block{idBlock.second};
-        std::vector<int> iterRng;
-        iterRng.assign(block.WholeRange().begin(), block.WholeRange().end());
-        const int blockIndex{block.ID()};
-        for (const auto& idCompo : g_Components()) {
-            const Component& compo{idCompo.second};
-            const BodyForceType forceType{compo.bodyForceType};
-            switch (forceType) {
-                case BodyForce_1st:
-                    ops_par_loop(
-                        KerCalcBodyForce1ST3D, "KerCalcBodyForce1ST3D",
-                        block.Get(), SpaceDim(), iterRng.data(),
-                        ops_arg_dat(g_fStage()[blockIndex], NUMXI, LOCALSTENCIL,
-                                    "double", OPS_WRITE),
-                        ops_arg_dat(
-                            g_MacroBodyforce().at(compo.id).at(blockIndex),
-                            SpaceDim(), LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_dat(g_MacroVars()
-                                        .at(compo.macroVars.at(Variable_Rho).id)
-                                        .at(blockIndex),
-                                    1, LOCALSTENCIL, "double", OPS_RW),
-                        ops_arg_dat(g_NodeType().at(compo.id).at(blockIndex), 1,
-                                    LOCALSTENCIL, "int", OPS_READ),
-                        ops_arg_gbl(compo.index, 2, "int", OPS_READ));
-                    break;
-                case BodyForce_None:
-                    ops_par_loop(
-                        KerCalcBodyForceNone3D, "KerCalcBodyForceNone",
-                        block.Get(), SpaceDim(), iterRng.data(),
-                        ops_arg_dat(g_fStage()[blockIndex], NUMXI, LOCALSTENCIL,
-                                    "double", OPS_WRITE),
-                        ops_arg_dat(
-                            g_MacroBodyforce().at(compo.id).at(blockIndex),
-                            SpaceDim(), LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_dat(g_NodeType().at(compo.id).at(blockIndex), 1,
-                                    LOCALSTENCIL, "int", OPS_READ),
-                        ops_arg_gbl(compo.index, 2, "int", OPS_READ));
-                    break;
-                default:
-                    ops_printf(
-                        "The specified force type is not implemented!\n");
-                    break;
+    ForEachBlockPlan([](BlockPlan& plan) {
+        for (auto& iterRng : plan.activeRanges) {
+            for (const ComponentPlan& compoPlan : plan.components) {
+                const Component& compo{*compoPlan.compo};
+                const BodyForceType forceType{compo.bodyForceType};
+                switch (forceType) {
+                    case BodyForce_1st:
+                        ops_par_loop(KerCalcBodyForce1ST3D,
+                                     "KerCalcBodyForce1ST3D", plan.block->Get(),
+                                     SpaceDim(), iterRng.data(),
+                                     ops_arg_dat(plan.fStage, NUMXI,
+                                                 LOCALSTENCIL,
+                                                 g_fStage().Type(), OPS_WRITE),
+                                     ops_arg_dat(compoPlan.acceleration,
+                                                 SpaceDim(), LOCALSTENCIL,
+                                                 "double", OPS_READ),
+                                     ops_arg_dat(compoPlan.rho, 1, LOCALSTENCIL,
+                                                 "double", OPS_RW),
+                                     ops_arg_dat(compoPlan.descriptor, 1,
+                                                 LOCALSTENCIL, "short",
+                                                 OPS_READ),
+                                     ops_arg_gbl(compo.index, 2, "int",
+                                                 OPS_READ));
+                        break;
+                    case BodyForce_None:
+                        ops_par_loop(KerCalcBodyForceNone3D,
+                                     "KerCalcBodyForceNone", plan.block->Get(),
+                                     SpaceDim(), iterRng.data(),
+                                     ops_arg_dat(plan.fStage, NUMXI,
+                                                 LOCALSTENCIL,
+                                                 g_fStage().Type(), OPS_WRITE),
+                                     ops_arg_dat(compoPlan.acceleration,
+                                                 SpaceDim(), LOCALSTENCIL,
+                                                 "double", OPS_READ),
+                                     ops_arg_dat(compoPlan.descriptor, 1,
+                                                 LOCALSTENCIL, "short",
+                                                 OPS_READ),
+                                     ops_arg_gbl(compo.index, 2, "int",
+                                                 OPS_READ));
+                        break;
+                    default:
+                        ops_printf(
+                            "The specified force type is not implemented!\n");
+                        break;
+                }
             }
         }
-    }
+    });
 #endif // OPS_3D
 }
 
@@ -317,9 +885,11 @@ void PreDefinedInitialCondition3D() {
                         KerInitialiseBGK2nd3D, "KerInitialiseBGK2nd3D",
                         block.Get(), SpaceDim(), iterRng.data(),
                         ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
-                                    "double", OPS_WRITE),
-                        ops_arg_dat(g_NodeType().at(compoId).at(blockIndex), 1,
-                                    LOCALSTENCIL, "int", OPS_READ),
+                                    g_f().Type(), OPS_WRITE),
+                        ops_arg_dat(g_NodeDescriptor()
+                                        .at(compoId)
+                                        .at(blockIndex),
+                                    1, LOCALSTENCIL, "short", OPS_READ),
                         ops_arg_dat(g_MacroVars()
                                         .at(compo.macroVars.at(Variable_Rho).id)
                                         .at(blockIndex),
@@ -346,10 +916,8 @@ void PreDefinedInitialCondition3D() {
 #endif // OPS_3D
 }
 
-#endif // OPS_3D outter
-#ifdef OPS_2D
-void PreDefinedCollision() {
-#ifdef OPS_2D
+void CalcRestartMoments3D() {
+#ifdef OPS_3D
     for (const auto& idBlock : g_Block()) {
         const Block& block{idBlock.second};
         std::vector<int> iterRng;
@@ -357,243 +925,684 @@ void PreDefinedCollision() {
         const int blockIndex{block.ID()};
         for (const auto& idCompo : g_Components()) {
             const Component& compo{idCompo.second};
-            const CollisionType collisionType{compo.collisionType};
-            const Real tau{compo.tauRef};
-            const Real* pdt{pTimeStep()};
-            switch (collisionType) {
-                case Collision_BGKIsothermal2nd:
-                    ops_par_loop(
-                        KerCollideBGKIsothermal, "KerCollideBGKIsothermal",
-                        block.Get(), SpaceDim(), iterRng.data(),
-                        ops_arg_dat(g_fStage()[blockIndex], NUMXI, LOCALSTENCIL,
-                                    "double", OPS_WRITE),
-                        ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
-                                    "double", OPS_READ),
-                        ops_arg_dat(g_CoordinateXYZ()[blockIndex], SpaceDim(),
-                                    LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_dat(g_NodeType().at(compo.id).at(blockIndex), 1,
-                                    LOCALSTENCIL, "int", OPS_READ),
-                        ops_arg_dat(g_MacroVars()
-                                        .at(compo.macroVars.at(Variable_Rho).id)
-                                        .at(blockIndex),
-                                    1, LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_dat(g_MacroVars().at(compo.uId).at(blockIndex),
-                                    1, LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_dat(g_MacroVars().at(compo.vId).at(blockIndex),
-                                    1, LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_gbl(&tau, 1, "double", OPS_READ),
-                        ops_arg_gbl(pdt, 1, "double", OPS_READ),
-                        ops_arg_gbl(compo.index, 2, "int", OPS_READ));
-                    break;
-                case Collision_BGKThermal4th:
-                    ops_par_loop(
-                        KerCollideBGKThermal, "KerCollideBGKThermal",
-                        block.Get(), SpaceDim(), iterRng.data(),
-                        ops_arg_dat(g_fStage()[blockIndex], NUMXI, LOCALSTENCIL,
-                                    "double", OPS_WRITE),
-                        ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
-                                    "double", OPS_READ),
-                        ops_arg_dat(g_NodeType().at(compo.id).at(blockIndex), 1,
-                                    LOCALSTENCIL, "int", OPS_READ),
-                        ops_arg_dat(g_MacroVars()
-                                        .at(compo.macroVars.at(Variable_Rho).id)
-                                        .at(blockIndex),
-                                    1, LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_dat(g_MacroVars().at(compo.uId).at(blockIndex),
-                                    1, LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_dat(g_MacroVars().at(compo.vId).at(blockIndex),
-                                    1, LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_dat(g_MacroVars()
-                                        .at(compo.macroVars.at(Variable_T).id)
-                                        .at(blockIndex),
-                                    1, LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_gbl(&tau, 1, "double", OPS_READ),
-                        ops_arg_gbl(pdt, 1, "double", OPS_READ),
-                        ops_arg_gbl(compo.index, 2, "int", OPS_READ));
-                    break;
-                default:
-                    ops_printf(
-                        "The specified collision type is not implemented!\n");
-                    break;
-            }
+            const int compoId{compo.id};
+            ops_par_loop(KerCalcRestartMoments3D, "KerCalcRestartMoments3D",
+                         block.Get(), SpaceDim(), iterRng.data(),
+                         ops_arg_dat(g_RestartMoments().at(compoId)[blockIndex],
+                                     RestartMomentNum(), LOCALSTENCIL, "double",
+                                     OPS_WRITE),
+                         ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
+                                     g_f().Type(), OPS_READ),
+                         ops_arg_dat(g_NodeDescriptor()
+                                         .at(compoId)
+                                         .at(blockIndex),
+                                     1, LOCALSTENCIL, "short", OPS_READ),
+                         ops_arg_gbl(compo.index, 2, "int", OPS_READ));
         }
     }
-#endif // OPS_2D
+#endif // OPS_3D
 }
 
-
-
-void UpdateMacroVars() {
-#ifdef OPS_2D
+void RestoreFromRestartMoments3D() {
+#ifdef OPS_3D
+    if (!CompactRestartSupported()) {
+        ops_printf(
+            "Error: the compact restart requires the isothermal BGK model!\n");
+        assert(CompactRestartSupported());
+    }
     for (const auto& idBlock : g_Block()) {
         const Block& block{idBlock.second};
         std::vector<int> iterRng;
         iterRng.assign(block.WholeRange().begin(), block.WholeRange().end());
         const int blockIndex{block.ID()};
-        const Real* pdt{pTimeStep()};
         for (const auto& idCompo : g_Components()) {
             const Component& compo{idCompo.second};
-            for (auto& macroVar : compo.macroVars) {
-                const int varId{macroVar.second.id};
-                const VariableTypes varType{macroVar.first};
-                switch (varType) {
-                    case Variable_Rho:
-                        ops_par_loop(
-                            KerCalcDensity, "KerCalcDensity", block.Get(),
-                            SpaceDim(), iterRng.data(),
-                            ops_arg_dat(g_MacroVars().at(varId).at(blockIndex),
-                                        1, LOCALSTENCIL, "double", OPS_RW),
-                            ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
-                                        "double", OPS_READ),
-                            ops_arg_dat(
-                                g_NodeType().at(compo.id).at(blockIndex), 1,
-                                LOCALSTENCIL, "int", OPS_READ),
-                            ops_arg_gbl(compo.index, 2, "int", OPS_READ));
-                        break;
-                    case Variable_U:
-                        ops_par_loop(
-                            KerCalcU, "KerCalcU", block.Get(), SpaceDim(),
-                            iterRng.data(),
-                            ops_arg_dat(g_MacroVars().at(varId).at(blockIndex),
-                                        1, LOCALSTENCIL, "double", OPS_RW),
-                            ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
-                                        "double", OPS_READ),
-                            ops_arg_dat(
-                                g_NodeType().at(compo.id).at(blockIndex), 1,
-                                LOCALSTENCIL, "int", OPS_READ),
-                            ops_arg_dat(
-                                g_MacroVars()
-                                    .at(compo.macroVars.at(Variable_Rho).id)
-                                    .at(blockIndex),
-                                1, LOCALSTENCIL, "double", OPS_READ),
-                            ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+            const int compoId{compo.id};
+            ops_par_loop(KerRestoreFromRestartMoments3D,
+                         "KerRestoreFromRestartMoments3D", block.Get(),
+                         SpaceDim(), iterRng.data(),
+                         ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
+                                     g_f().Type(), OPS_RW),
+                         ops_arg_dat(g_NodeDescriptor()
+                                         .at(compoId)
+                                         .at(blockIndex),
+                                     1, LOCALSTENCIL, "short", OPS_READ),
+                         ops_arg_dat(g_RestartMoments().at(compoId)[blockIndex],
+                                     RestartMomentNum(), LOCALSTENCIL, "double",
+                                     OPS_READ),
+                         ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+        }
+    }
+#endif // OPS_3D
+}
+
+#endif // OPS_3D outter
+#ifdef OPS_2D
+/*!
+ * Collide the bulk nodes within iterRng by the branch-free kernel of the
+ * lattice, return false if the lattice has no such kernel.
+ */
+bool CollideBGKIsothermalBulk(BlockPlan& plan,
+                              const ComponentPlan& compoPlan,
+                              std::vector<int>& iterRng) {
+    bool found{false};
+#ifdef OPS_2D
+    const Component& compo{*compoPlan.compo};
+    const Real tau{compo.tauRef};
+    const Real* pdt{pTimeStep()};
+    switch (compo.latticeType) {
+        case Lattice_D2Q9:
+            ops_par_loop(KerCollideBGKIsothermalBulkD2Q9,
+                         "KerCollideBGKIsothermalBulkD2Q9", plan.block->Get(),
+                         SpaceDim(), iterRng.data(),
+                         ops_arg_dat(plan.fStage, NUMXI, LOCALSTENCIL,
+                                     g_fStage().Type(), OPS_RW),
+                         ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL, g_f().Type(),
+                                     OPS_READ),
+                         ops_arg_dat(compoPlan.descriptor, 1, LOCALSTENCIL,
+                                     "short", OPS_READ),
+                         ops_arg_dat(compoPlan.rho, 1, LOCALSTENCIL, "double",
+                                     OPS_READ),
+                         ops_arg_dat(compoPlan.u, 1, LOCALSTENCIL, "double",
+                                     OPS_READ),
+                         ops_arg_dat(compoPlan.v, 1, LOCALSTENCIL, "double",
+                                     OPS_READ),
+                         ops_arg_gbl(&tau, 1, "double", OPS_READ),
+                         ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                         ops_arg_gbl(compo.index, 2, "int", OPS_READ),
+                         ops_arg_reduce(plan.bulkInvalidHandle, 1, "int",
+                                        OPS_INC));
+            found = true;
+            break;
+        default:
+            break;
+    }
+    if (found) {
+        plan.bulkLoopNum++;
+    }
+#endif // OPS_2D
+    return found;
+}
+
+/*!
+ * Collide the distributions within iterRng of a block. The branch-free
+ * kernels are used if bulk is true and they are available.
+ */
+void CollideBlock(BlockPlan& plan, std::vector<int>& iterRng,
+                  const bool bulk) {
+#ifdef OPS_2D
+    for (const ComponentPlan& compoPlan : plan.components) {
+        const Component& compo{*compoPlan.compo};
+        const CollisionType collisionType{compo.collisionType};
+        const Real tau{compo.tauRef};
+        const Real* pdt{pTimeStep()};
+        switch (collisionType) {
+            case Collision_BGKIsothermal2nd:
+                if (bulk &&
+                    CollideBGKIsothermalBulk(plan, compoPlan, iterRng)) {
+                    break;
+                }
+                switch (compo.latticeType) {
+                    case Lattice_D2Q9:
+                        ops_par_loop(KerCollideBGKIsothermalD2Q9,
+                                     "KerCollideBGKIsothermalD2Q9",
+                                     plan.block->Get(), SpaceDim(),
+                                     iterRng.data(),
+                                     ops_arg_dat(plan.fStage, NUMXI,
+                                                 LOCALSTENCIL,
+                                                 g_fStage().Type(), OPS_WRITE),
+                                     ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                                 g_f().Type(), OPS_READ),
+                                     ops_arg_dat(plan.coordinates, SpaceDim(),
+                                                 LOCALSTENCIL, "double",
+                                                 OPS_READ),
+                                     ops_arg_dat(compoPlan.descriptor, 1,
+                                                 LOCALSTENCIL, "short",
+                                                 OPS_READ),
+                                     ops_arg_dat(compoPlan.rho, 1, LOCALSTENCIL,
+                                                 "double", OPS_READ),
+                                     ops_arg_dat(compoPlan.u, 1, LOCALSTENCIL,
+                                                 "double", OPS_READ),
+                                     ops_arg_dat(compoPlan.v, 1, LOCALSTENCIL,
+                                                 "double", OPS_READ),
+                                     ops_arg_gbl(&tau, 1, "double", OPS_READ),
+                                     ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                                     ops_arg_gbl(compo.index, 2, "int",
+                                                 OPS_READ));
                         break;
-                    case Variable_V:
-                        ops_par_loop(
-                            KerCalcV, "KerCalcV", block.Get(), SpaceDim(),
-                            iterRng.data(),
-                            ops_arg_dat(g_MacroVars().at(varId).at(blockIndex),
-                                        1, LOCALSTENCIL, "double", OPS_RW),
-                            ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
-                                        "double", OPS_READ),
-                            ops_arg_dat(
-                                g_NodeType().at(compo.id).at(blockIndex), 1,
-                                LOCALSTENCIL, "int", OPS_READ),
-                            ops_arg_dat(
-                                g_MacroVars()
-                                    .at(compo.macroVars.at(Variable_Rho).id)
-                                    .at(blockIndex),
-                                1, LOCALSTENCIL, "double", OPS_READ),
-                            ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                    default:
+                        ops_par_loop(KerCollideBGKIsothermal,
+                                     "KerCollideBGKIsothermal",
+                                     plan.block->Get(), SpaceDim(),
+                                     iterRng.data(),
+                                     ops_arg_dat(plan.fStage, NUMXI,
+                                                 LOCALSTENCIL,
+                                                 g_fStage().Type(), OPS_WRITE),
+                                     ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                                 g_f().Type(), OPS_READ),
+                                     ops_arg_dat(plan.coordinates, SpaceDim(),
+                                                 LOCALSTENCIL, "double",
+                                                 OPS_READ),
+                                     ops_arg_dat(compoPlan.descriptor, 1,
+                                                 LOCALSTENCIL, "short",
+                                                 OPS_READ),
+                                     ops_arg_dat(compoPlan.rho, 1, LOCALSTENCIL,
+                                                 "double", OPS_READ),
+                                     ops_arg_dat(compoPlan.u, 1, LOCALSTENCIL,
+                                                 "double", OPS_READ),
+                                     ops_arg_dat(compoPlan.v, 1, LOCALSTENCIL,
+                                                 "double", OPS_READ),
+                                     ops_arg_gbl(&tau, 1, "double", OPS_READ),
+                                     ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                                     ops_arg_gbl(compo.index, 2, "int",
+                                                 OPS_READ));
                         break;
-                    case Variable_U_Force:
-                        ops_par_loop(
-                            KerCalcUForce, "KerCalcUForce", block.Get(),
-                            SpaceDim(), iterRng.data(),
-                            ops_arg_dat(g_MacroVars().at(varId).at(blockIndex),
-                                        1, LOCALSTENCIL, "double", OPS_RW),
-                            ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
-                                        "double", OPS_READ),
-                            ops_arg_dat(
-                                g_NodeType().at(compo.id).at(blockIndex), 1,
-                                LOCALSTENCIL, "int", OPS_READ),
-                            ops_arg_dat(g_CoordinateXYZ()[blockIndex],
-                                        SpaceDim(), LOCALSTENCIL, "double",
-                                        OPS_READ),
-                            ops_arg_dat(
-                                g_MacroBodyforce().at(compo.id).at(blockIndex),
+                }
+                break;
+            case Collision_BGKThermal4th:
+                ops_par_loop(KerCollideBGKThermal, "KerCollideBGKThermal",
+                             plan.block->Get(), SpaceDim(), iterRng.data(),
+                             ops_arg_dat(plan.fStage, NUMXI, LOCALSTENCIL,
+                                         g_fStage().Type(), OPS_WRITE),
+                             ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                         g_f().Type(), OPS_READ),
+                             ops_arg_dat(compoPlan.descriptor, 1, LOCALSTENCIL,
+                                         "short", OPS_READ),
+                             ops_arg_dat(compoPlan.rho, 1, LOCALSTENCIL,
+                                         "double", OPS_READ),
+                             ops_arg_dat(compoPlan.u, 1, LOCALSTENCIL, "double",
+                                         OPS_READ),
+                             ops_arg_dat(compoPlan.v, 1, LOCALSTENCIL, "double",
+                                         OPS_READ),
+                             ops_arg_dat(compoPlan.temperature, 1, LOCALSTENCIL,
+                                         "double", OPS_READ),
+                             ops_arg_gbl(&tau, 1, "double", OPS_READ),
+                             ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                             ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                break;
+            default:
+                ops_printf(
+                    "The specified collision type is not implemented!\n");
+                break;
+        }
+    }
+#endif // OPS_2D
+}
+
+/*!
+ * The bulk nodes are collided by the branch-free kernels and the shell
+ * by the checked ones, see CollideBGKIsothermalBulkLattice. The invalid
+ * bulk nodes are checked after all the blocks.
+ */
+void PreDefinedCollision() {
+    ForEachBlockPlan([](BlockPlan& plan) {
+        for (auto& range : plan.bulkRanges) {
+            CollideBlock(plan, range, true);
+        }
+        for (auto& range : plan.shellRanges) {
+            CollideBlock(plan, range, false);
+        }
+    });
+    CheckBulkCollision();
+}
+
+
+
+/*!
+ * Calculate the moments and the collision within iterRng of a block by
+ * the fused kernels, where the post-collision distribution is written
+ * into fDest
+ */
+static void FusedCollisionBlock(const BlockPlan& plan,
+                                std::vector<int>& iterRng, ops_dat fDest) {
+#ifdef OPS_2D
+    const Real* pdt{pTimeStep()};
+    for (const ComponentPlan& compoPlan : plan.components) {
+        const Component& compo{*compoPlan.compo};
+        const Real tau{compo.tauRef};
+        switch (compo.latticeType) {
+            case Lattice_D2Q9:
+                ops_par_loop(KerCollideBGKIsothermalFusedD2Q9,
+                             "KerCollideBGKIsothermalFusedD2Q9",
+                             plan.block->Get(), SpaceDim(), iterRng.data(),
+                             ops_arg_dat(fDest, NUMXI, LOCALSTENCIL,
+                                         g_fStage().Type(), OPS_WRITE),
+                             ops_arg_dat(compoPlan.rho, 1, LOCALSTENCIL,
+                                         "double", OPS_RW),
+                             ops_arg_dat(compoPlan.u, 1, LOCALSTENCIL, "double",
+                                         OPS_RW),
+                             ops_arg_dat(compoPlan.v, 1, LOCALSTENCIL, "double",
+                                         OPS_RW),
+                             ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                         g_f().Type(), OPS_READ),
+                             ops_arg_dat(plan.coordinates, SpaceDim(),
+                                         LOCALSTENCIL, "double", OPS_READ),
+                             ops_arg_dat(compoPlan.acceleration, SpaceDim(),
+                                         LOCALSTENCIL, "double", OPS_READ),
+                             ops_arg_dat(compoPlan.descriptor, 1, LOCALSTENCIL,
+                                         "short", OPS_READ),
+                             ops_arg_gbl(&tau, 1, "double", OPS_READ),
+                             ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                             ops_arg_gbl(&compoPlan.bodyForceOn, 1, "int",
+                                         OPS_READ),
+                             ops_arg_gbl(compoPlan.forceCorrection, 1, "int",
+                                         OPS_READ),
+                             ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                break;
+            default:
+                ops_par_loop(KerCollideBGKIsothermalFused,
+                             "KerCollideBGKIsothermalFused", plan.block->Get(),
+                             SpaceDim(), iterRng.data(),
+                             ops_arg_dat(fDest, NUMXI, LOCALSTENCIL,
+                                         g_fStage().Type(), OPS_WRITE),
+                             ops_arg_dat(compoPlan.rho, 1, LOCALSTENCIL,
+                                         "double", OPS_RW),
+                             ops_arg_dat(compoPlan.u, 1, LOCALSTENCIL, "double",
+                                         OPS_RW),
+                             ops_arg_dat(compoPlan.v, 1, LOCALSTENCIL, "double",
+                                         OPS_RW),
+                             ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                         g_f().Type(), OPS_READ),
+                             ops_arg_dat(plan.coordinates, SpaceDim(),
+                                         LOCALSTENCIL, "double", OPS_READ),
+                             ops_arg_dat(compoPlan.acceleration, SpaceDim(),
+                                         LOCALSTENCIL, "double", OPS_READ),
+                             ops_arg_dat(compoPlan.descriptor, 1, LOCALSTENCIL,
+                                         "short", OPS_READ),
+                             ops_arg_gbl(&tau, 1, "double", OPS_READ),
+                             ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                             ops_arg_gbl(&compoPlan.bodyForceOn, 1, "int",
+                                         OPS_READ),
+                             ops_arg_gbl(compoPlan.forceCorrection, 1, "int",
+                                         OPS_READ),
+                             ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                break;
+        }
+    }
+#endif // OPS_2D
+}
+
+void FusedCollision() {
+    ForEachBlockPlan([](BlockPlan& plan) {
+        for (auto& iterRng : plan.activeRanges) {
+            FusedCollisionBlock(plan, iterRng, plan.fStage);
+        }
+    });
+}
+
+/*!
+ * Pull-stream-collide the Fluid boxes within iterRng of a block by the fused
+ * kernels, return false without any loop if a lattice has no such kernel.
+ */
+static bool PullStreamCollideBlock(const BlockPlan& plan,
+                                   std::vector<int>& iterRng) {
+    bool found{false};
+#ifdef OPS_2D
+    for (const ComponentPlan& compoPlan : plan.components) {
+        switch (compoPlan.compo->latticeType) {
+            case Lattice_D2Q9:
+                break;
+            default:
+                return false;
+        }
+    }
+    const Real* pdt{pTimeStep()};
+    for (const ComponentPlan& compoPlan : plan.components) {
+        const Component& compo{*compoPlan.compo};
+        const Real tau{compo.tauRef};
+        switch (compo.latticeType) {
+            case Lattice_D2Q9:
+                ops_par_loop(KerPullStreamCollideD2Q9,
+                             "KerPullStreamCollideD2Q9", plan.block->Get(),
+                             SpaceDim(), iterRng.data(),
+                             ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                         g_f().Type(), OPS_RW),
+                             ops_arg_dat(plan.fNext, NUMXI, LOCALSTENCIL,
+                                         g_fNext().Type(), OPS_WRITE),
+                             ops_arg_dat(compoPlan.rho, 1, LOCALSTENCIL,
+                                         "double", OPS_RW),
+                             ops_arg_dat(compoPlan.u, 1, LOCALSTENCIL, "double",
+                                         OPS_RW),
+                             ops_arg_dat(compoPlan.v, 1, LOCALSTENCIL, "double",
+                                         OPS_RW),
+                             ops_arg_dat(plan.fStage, NUMXI,
+                                         ONEPTLATTICESTENCIL, g_fStage().Type(),
+                                         OPS_READ),
+                             ops_arg_dat(plan.coordinates, SpaceDim(),
+                                         LOCALSTENCIL, "double", OPS_READ),
+                             ops_arg_dat(compoPlan.acceleration, SpaceDim(),
+                                         LOCALSTENCIL, "double", OPS_READ),
+                             ops_arg_dat(compoPlan.descriptor, 1, LOCALSTENCIL,
+                                         "short", OPS_READ),
+                             ops_arg_gbl(&tau, 1, "double", OPS_READ),
+                             ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                             ops_arg_gbl(&compoPlan.bodyForceOn, 1, "int",
+                                         OPS_READ),
+                             ops_arg_gbl(compoPlan.forceCorrection, 1, "int",
+                                         OPS_READ),
+                             ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                break;
+            default:
+                break;
+        }
+    }
+    found = true;
+#endif // OPS_2D
+    return found;
+}
+
+void PullStreamCollision() {
+    ForEachBlockPlan([](BlockPlan& plan) {
+        for (auto& range : plan.fluidRanges) {
+            if (!PullStreamCollideBlock(plan, range)) {
+                StreamFluidBlock(plan, range);
+                FusedCollisionBlock(plan, range, plan.fNext);
+            }
+        }
+        for (auto& range : plan.bulkBoundaryRanges) {
+            StreamBlock(plan, range);
+        }
+        for (auto& range : plan.shellRanges) {
+            StreamBlock(plan, range);
+        }
+    });
+}
+
+void FusedCollisionNonFluid() {
+    ForEachBlockPlan([](BlockPlan& plan) {
+        for (auto& range : plan.bulkBoundaryRanges) {
+            FusedCollisionBlock(plan, range, plan.fNext);
+        }
+        for (auto& range : plan.shellRanges) {
+            FusedCollisionBlock(plan, range, plan.fNext);
+        }
+    });
+}
+
+void InPlaceCollision() {
+#ifdef OPS_2D
+    const Real* pdt{pTimeStep()};
+    ForEachBlockPlan([&](BlockPlan& plan) {
+        for (auto& iterRng : plan.activeRanges) {
+            for (const ComponentPlan& compoPlan : plan.components) {
+                const Component& compo{*compoPlan.compo};
+                const Real tau{compo.tauRef};
+                ops_par_loop(KerCollideBGKIsothermalInPlace,
+                             "KerCollideBGKIsothermalInPlace",
+                             plan.block->Get(), SpaceDim(), iterRng.data(),
+                             ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                         g_f().Type(), OPS_RW),
+                             ops_arg_dat(plan.fStage, g_fStage().DataDim(),
+                                         LOCALSTENCIL, g_fStage().Type(),
+                                         OPS_RW),
+                             ops_arg_dat(compoPlan.rho, 1, LOCALSTENCIL,
+                                         "double", OPS_RW),
+                             ops_arg_dat(compoPlan.u, 1, LOCALSTENCIL, "double",
+                                         OPS_RW),
+                             ops_arg_dat(compoPlan.v, 1, LOCALSTENCIL, "double",
+                                         OPS_RW),
+                             ops_arg_dat(plan.coordinates, SpaceDim(),
+                                         LOCALSTENCIL, "double", OPS_READ),
+                             ops_arg_dat(compoPlan.acceleration, SpaceDim(),
+                                         LOCALSTENCIL, "double", OPS_READ),
+                             ops_arg_dat(compoPlan.descriptor, 1, LOCALSTENCIL,
+                                         "short", OPS_READ),
+                             ops_arg_gbl(&tau, 1, "double", OPS_READ),
+                             ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                             ops_arg_gbl(&compoPlan.bodyForceOn, 1, "int",
+                                         OPS_READ),
+                             ops_arg_gbl(compoPlan.forceCorrection, 1, "int",
+                                         OPS_READ),
+                             ops_arg_gbl(&compoPlan.swapStart, 1, "int",
+                                         OPS_READ),
+                             ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+            }
+        }
+    });
+#endif // OPS_2D
+}
+
+/*!
+ * Calculate the macroscopic variables one by one within iterRng, which is
+ * only used if the density and velocity of a component are not all defined.
+ */
+void UpdateMacroVarsSeparately(const Block& block, const Component& compo,
+                               std::vector<int> iterRng) {
+#ifdef OPS_2D
+    const int blockIndex{block.ID()};
+    const Real* pdt{pTimeStep()};
+    for (auto& macroVar : compo.macroVars) {
+        const int varId{macroVar.second.id};
+        const VariableTypes varType{macroVar.first};
+        switch (varType) {
+            case Variable_Rho:
+                ops_par_loop(
+                    KerCalcDensity, "KerCalcDensity", block.Get(),
+                    SpaceDim(), iterRng.data(),
+                    ops_arg_dat(g_MacroVars().at(varId).at(blockIndex),
+                                1, LOCALSTENCIL, "double", OPS_RW),
+                    ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
+                                g_f().Type(), OPS_READ),
+                    ops_arg_dat(
+                        g_NodeDescriptor().at(compo.id).at(blockIndex), 1,
+                        LOCALSTENCIL, "short", OPS_READ),
+                    ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                break;
+            case Variable_U:
+                ops_par_loop(
+                    KerCalcU, "KerCalcU", block.Get(), SpaceDim(),
+                    iterRng.data(),
+                    ops_arg_dat(g_MacroVars().at(varId).at(blockIndex),
+                                1, LOCALSTENCIL, "double", OPS_RW),
+                    ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
+                                g_f().Type(), OPS_READ),
+                    ops_arg_dat(
+                        g_NodeDescriptor().at(compo.id).at(blockIndex), 1,
+                        LOCALSTENCIL, "short", OPS_READ),
+                    ops_arg_dat(
+                        g_MacroVars()
+                            .at(compo.macroVars.at(Variable_Rho).id)
+                            .at(blockIndex),
+                        1, LOCALSTENCIL, "double", OPS_READ),
+                    ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                break;
+            case Variable_V:
+                ops_par_loop(
+                    KerCalcV, "KerCalcV", block.Get(), SpaceDim(),
+                    iterRng.data(),
+                    ops_arg_dat(g_MacroVars().at(varId).at(blockIndex),
+                                1, LOCALSTENCIL, "double", OPS_RW),
+                    ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
+                                g_f().Type(), OPS_READ),
+                    ops_arg_dat(
+                        g_NodeDescriptor().at(compo.id).at(blockIndex), 1,
+                        LOCALSTENCIL, "short", OPS_READ),
+                    ops_arg_dat(
+                        g_MacroVars()
+                            .at(compo.macroVars.at(Variable_Rho).id)
+                            .at(blockIndex),
+                        1, LOCALSTENCIL, "double", OPS_READ),
+                    ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                break;
+            case Variable_U_Force:
+                ops_par_loop(
+                    KerCalcUForce, "KerCalcUForce", block.Get(),
+                    SpaceDim(), iterRng.data(),
+                    ops_arg_dat(g_MacroVars().at(varId).at(blockIndex),
+                                1, LOCALSTENCIL, "double", OPS_RW),
+                    ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
+                                g_f().Type(), OPS_READ),
+                    ops_arg_dat(
+                        g_NodeDescriptor().at(compo.id).at(blockIndex), 1,
+                        LOCALSTENCIL, "short", OPS_READ),
+                    ops_arg_dat(g_CoordinateXYZ()[blockIndex],
+                                SpaceDim(), LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_dat(AccelerationField(compo.id).at(blockIndex),
                                 SpaceDim(), LOCALSTENCIL, "double", OPS_READ),
-                            ops_arg_dat(
-                                g_MacroVars()
-                                    .at(compo.macroVars.at(Variable_Rho).id)
-                                    .at(blockIndex),
-                                1, LOCALSTENCIL, "double", OPS_READ),
-                            ops_arg_gbl(pdt, 1, "double", OPS_READ),
-                            ops_arg_gbl(compo.index, 2, "int", OPS_READ));
-                        break;
-                    case Variable_V_Force:
-                        ops_par_loop(
-                            KerCalcVForce, "KerCalcVForce", block.Get(),
-                            SpaceDim(), iterRng.data(),
-                            ops_arg_dat(g_MacroVars().at(varId).at(blockIndex),
-                                        1, LOCALSTENCIL, "double", OPS_RW),
-                            ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
-                                        "double", OPS_READ),
-                            ops_arg_dat(
-                                g_NodeType().at(compo.id).at(blockIndex), 1,
-                                LOCALSTENCIL, "int", OPS_READ),
-                            ops_arg_dat(g_CoordinateXYZ()[blockIndex],
-                                        SpaceDim(), LOCALSTENCIL, "double",
-                                        OPS_READ),
-                            ops_arg_dat(
-                                g_MacroBodyforce().at(compo.id).at(blockIndex),
+                    ops_arg_dat(
+                        g_MacroVars()
+                            .at(compo.macroVars.at(Variable_Rho).id)
+                            .at(blockIndex),
+                        1, LOCALSTENCIL, "double", OPS_READ),
+                    ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                    ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                break;
+            case Variable_V_Force:
+                ops_par_loop(
+                    KerCalcVForce, "KerCalcVForce", block.Get(),
+                    SpaceDim(), iterRng.data(),
+                    ops_arg_dat(g_MacroVars().at(varId).at(blockIndex),
+                                1, LOCALSTENCIL, "double", OPS_RW),
+                    ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
+                                g_f().Type(), OPS_READ),
+                    ops_arg_dat(
+                        g_NodeDescriptor().at(compo.id).at(blockIndex), 1,
+                        LOCALSTENCIL, "short", OPS_READ),
+                    ops_arg_dat(g_CoordinateXYZ()[blockIndex],
+                                SpaceDim(), LOCALSTENCIL, "double",
+                                OPS_READ),
+                    ops_arg_dat(AccelerationField(compo.id).at(blockIndex),
                                 SpaceDim(), LOCALSTENCIL, "double", OPS_READ),
-                            ops_arg_dat(
-                                g_MacroVars()
-                                    .at(compo.macroVars.at(Variable_Rho).id)
-                                    .at(blockIndex),
-                                1, LOCALSTENCIL, "double", OPS_READ),
-                            ops_arg_gbl(pdt, 1, "double", OPS_READ),
-                            ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                    ops_arg_dat(
+                        g_MacroVars()
+                            .at(compo.macroVars.at(Variable_Rho).id)
+                            .at(blockIndex),
+                        1, LOCALSTENCIL, "double", OPS_READ),
+                    ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                    ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                break;
+            default:
+                break;
+        }
+    }
+#endif // OPS_2D
+}
+
+void UpdateMacroVars() {
+#ifdef OPS_2D
+    const Real* pdt{pTimeStep()};
+    ForEachBlockPlan([&](BlockPlan& plan) {
+        for (auto& iterRng : plan.activeRanges) {
+            for (const ComponentPlan& compoPlan : plan.components) {
+                const Component& compo{*compoPlan.compo};
+                if (!compoPlan.densityVelocity) {
+                    UpdateMacroVarsSeparately(*plan.block, compo, iterRng);
+                    continue;
+                }
+                switch (compo.latticeType) {
+                    case Lattice_D2Q9:
+                        ops_par_loop(KerCalcMacroVarsD2Q9,
+                                     "KerCalcMacroVarsD2Q9", plan.block->Get(),
+                                     SpaceDim(), iterRng.data(),
+                                     ops_arg_dat(compoPlan.rho, 1, LOCALSTENCIL,
+                                                 "double", OPS_RW),
+                                     ops_arg_dat(compoPlan.u, 1, LOCALSTENCIL,
+                                                 "double", OPS_RW),
+                                     ops_arg_dat(compoPlan.v, 1, LOCALSTENCIL,
+                                                 "double", OPS_RW),
+                                     ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                                 g_f().Type(), OPS_READ),
+                                     ops_arg_dat(compoPlan.descriptor, 1,
+                                                 LOCALSTENCIL, "short",
+                                                 OPS_READ),
+                                     ops_arg_dat(plan.coordinates, SpaceDim(),
+                                                 LOCALSTENCIL, "double",
+                                                 OPS_READ),
+                                     ops_arg_dat(compoPlan.acceleration,
+                                                 SpaceDim(), LOCALSTENCIL,
+                                                 "double", OPS_READ),
+                                     ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                                     ops_arg_gbl(compoPlan.forceCorrection,
+                                                 SpaceDim(), "int", OPS_READ),
+                                     ops_arg_gbl(compo.index, 2, "int",
+                                                 OPS_READ));
                         break;
                     default:
+                        ops_par_loop(KerCalcMacroVars, "KerCalcMacroVars",
+                                     plan.block->Get(), SpaceDim(),
+                                     iterRng.data(),
+                                     ops_arg_dat(compoPlan.rho, 1, LOCALSTENCIL,
+                                                 "double", OPS_RW),
+                                     ops_arg_dat(compoPlan.u, 1, LOCALSTENCIL,
+                                                 "double", OPS_RW),
+                                     ops_arg_dat(compoPlan.v, 1, LOCALSTENCIL,
+                                                 "double", OPS_RW),
+                                     ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                                 g_f().Type(), OPS_READ),
+                                     ops_arg_dat(compoPlan.descriptor, 1,
+                                                 LOCALSTENCIL, "short",
+                                                 OPS_READ),
+                                     ops_arg_dat(plan.coordinates, SpaceDim(),
+                                                 LOCALSTENCIL, "double",
+                                                 OPS_READ),
+                                     ops_arg_dat(compoPlan.acceleration,
+                                                 SpaceDim(), LOCALSTENCIL,
+                                                 "double", OPS_READ),
+                                     ops_arg_gbl(pdt, 1, "double", OPS_READ),
+                                     ops_arg_gbl(compoPlan.forceCorrection,
+                                                 SpaceDim(), "int", OPS_READ),
+                                     ops_arg_gbl(compo.index, 2, "int",
+                                                 OPS_READ));
                         break;
                 }
             }
         }
-    }
+    });
 #endif // OPS_2D
 }
 
 
 void PreDefinedBodyForce() {
 #ifdef OPS_2D
-    for (const auto& idBlock : g_Block()) {
-        const Block& block{idBlock.second};
-        std::vector<int> iterRng;
-        iterRng.assign(block.WholeRange().begin(), block.WholeRange().end());
-        const int blockIndex{block.ID()};
-        for (const auto& idCompo : g_Components()) {
-            const Component& compo{idCompo.second};
-            const BodyForceType forceType{compo.bodyForceType};
-            switch (forceType) {
-                case BodyForce_1st:
-                    ops_par_loop(
-                        KerCalcBodyForce1ST, "KerCalcBodyForce1ST",
-                        block.Get(), SpaceDim(), iterRng.data(),
-                        ops_arg_dat(g_fStage()[blockIndex], NUMXI, LOCALSTENCIL,
-                                    "double", OPS_WRITE),
-                        ops_arg_dat(
-                            g_MacroBodyforce().at(compo.id).at(blockIndex),
-                            SpaceDim(), LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_dat(g_MacroVars()
-                                        .at(compo.macroVars.at(Variable_Rho).id)
-                                        .at(blockIndex),
-                                    1, LOCALSTENCIL, "double", OPS_RW),
-                        ops_arg_dat(g_NodeType().at(compo.id).at(blockIndex), 1,
-                                    LOCALSTENCIL, "int", OPS_READ),
-                        ops_arg_gbl(compo.index, 2, "int", OPS_READ));
-                    break;
-                case BodyForce_None:
-                    ops_par_loop(
-                        KerCalcBodyForceNone, "KerCalcBodyForceNone",
-                        block.Get(), SpaceDim(), iterRng.data(),
-                        ops_arg_dat(g_fStage()[blockIndex], NUMXI, LOCALSTENCIL,
-                                    "double", OPS_WRITE),
-                        ops_arg_dat(
-                            g_MacroBodyforce().at(compo.id).at(blockIndex),
-                            SpaceDim(), LOCALSTENCIL, "double", OPS_READ),
-                        ops_arg_dat(g_NodeType().at(compo.id).at(blockIndex), 1,
-                                    LOCALSTENCIL, "int", OPS_READ),
-                        ops_arg_gbl(compo.index, 2, "int", OPS_READ));
-                    break;
-                default:
-                    ops_printf(
-                        "The specified force type is not implemented!\n");
-                    break;
+    ForEachBlockPlan([](BlockPlan& plan) {
+        for (auto& iterRng : plan.activeRanges) {
+            for (const ComponentPlan& compoPlan : plan.components) {
+                const Component& compo{*compoPlan.compo};
+                const BodyForceType forceType{compo.bodyForceType};
+                switch (forceType) {
+                    case BodyForce_1st:
+                        ops_par_loop(KerCalcBodyForce1ST, "KerCalcBodyForce1ST",
+                                     plan.block->Get(), SpaceDim(),
+                                     iterRng.data(),
+                                     ops_arg_dat(plan.fStage, NUMXI,
+                                                 LOCALSTENCIL,
+                                                 g_fStage().Type(), OPS_WRITE),
+                                     ops_arg_dat(compoPlan.acceleration,
+                                                 SpaceDim(), LOCALSTENCIL,
+                                                 "double", OPS_READ),
+                                     ops_arg_dat(compoPlan.rho, 1, LOCALSTENCIL,
+                                                 "double", OPS_RW),
+                                     ops_arg_dat(compoPlan.descriptor, 1,
+                                                 LOCALSTENCIL, "short",
+                                                 OPS_READ),
+                                     ops_arg_gbl(compo.index, 2, "int",
+                                                 OPS_READ));
+                        break;
+                    case BodyForce_None:
+                        ops_par_loop(KerCalcBodyForceNone,
+                                     "KerCalcBodyForceNone", plan.block->Get(),
+                                     SpaceDim(), iterRng.data(),
+                                     ops_arg_dat(plan.fStage, NUMXI,
+                                                 LOCALSTENCIL,
+                                                 g_fStage().Type(), OPS_WRITE),
+                                     ops_arg_dat(compoPlan.acceleration,
+                                                 SpaceDim(), LOCALSTENCIL,
+                                                 "double", OPS_READ),
+                                     ops_arg_dat(compoPlan.descriptor, 1,
+                                                 LOCALSTENCIL, "short",
+                                                 OPS_READ),
+                                     ops_arg_gbl(compo.index, 2, "int",
+                                                 OPS_READ));
+                        break;
+                    default:
+                        ops_printf(
+                            "The specified force type is not implemented!\n");
+                        break;
+                }
             }
         }
-    }
+    });
 #endif // OPS_2D
 }
 
@@ -616,9 +1625,11 @@ void PreDefinedInitialCondition() {
                         KerInitialiseBGK2nd, "KerInitialiseBGK2nd",
                         block.Get(), SpaceDim(), iterRng.data(),
                         ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
-                                    "double", OPS_WRITE),
-                        ops_arg_dat(g_NodeType().at(compoId).at(blockIndex), 1,
-                                    LOCALSTENCIL, "int", OPS_READ),
+                                    g_f().Type(), OPS_WRITE),
+                        ops_arg_dat(g_NodeDescriptor()
+                                        .at(compoId)
+                                        .at(blockIndex),
+                                    1, LOCALSTENCIL, "short", OPS_READ),
                         ops_arg_dat(g_MacroVars()
                                         .at(compo.macroVars.at(Variable_Rho).id)
                                         .at(blockIndex),
@@ -642,4 +1653,64 @@ void PreDefinedInitialCondition() {
     }
 #endif // OPS_2D
 }
+
+void CalcRestartMoments() {
+#ifdef OPS_2D
+    for (const auto& idBlock : g_Block()) {
+        const Block& block{idBlock.second};
+        std::vector<int> iterRng;
+        iterRng.assign(block.WholeRange().begin(), block.WholeRange().end());
+        const int blockIndex{block.ID()};
+        for (const auto& idCompo : g_Components()) {
+            const Component& compo{idCompo.second};
+            const int compoId{compo.id};
+            ops_par_loop(KerCalcRestartMoments, "KerCalcRestartMoments",
+                         block.Get(), SpaceDim(), iterRng.data(),
+                         ops_arg_dat(g_RestartMoments().at(compoId)[blockIndex],
+                                     RestartMomentNum(), LOCALSTENCIL, "double",
+                                     OPS_WRITE),
+                         ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
+                                     g_f().Type(), OPS_READ),
+                         ops_arg_dat(g_NodeDescriptor()
+                                         .at(compoId)
+                                         .at(blockIndex),
+                                     1, LOCALSTENCIL, "short", OPS_READ),
+                         ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+        }
+    }
+#endif // OPS_2D
+}
+
+void RestoreFromRestartMoments() {
+#ifdef OPS_2D
+    if (!CompactRestartSupported()) {
+        ops_printf(
+            "Error: the compact restart requires the isothermal BGK model!\n");
+        assert(CompactRestartSupported());
+    }
+    for (const auto& idBlock : g_Block()) {
+        const Block& block{idBlock.second};
+        std::vector<int> iterRng;
+        iterRng.assign(block.WholeRange().begin(), block.WholeRange().end());
+        const int blockIndex{block.ID()};
+        for (const auto& idCompo : g_Components()) {
+            const Component& compo{idCompo.second};
+            const int compoId{compo.id};
+            ops_par_loop(KerRestoreFromRestartMoments,
+                         "KerRestoreFromRestartMoments", block.Get(),
+                         SpaceDim(), iterRng.data(),
+                         ops_arg_dat(g_f()[blockIndex], NUMXI, LOCALSTENCIL,
+                                     g_f().Type(), OPS_RW),
+                         ops_arg_dat(g_NodeDescriptor()
+                                         .at(compoId)
+                                         .at(blockIndex),
+                                     1, LOCALSTENCIL, "short", OPS_READ),
+                         ops_arg_dat(g_RestartMoments().at(compoId)[blockIndex],
+                                     RestartMomentNum(), LOCALSTENCIL, "double",
+                                     OPS_READ),
+                         ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+        }
+    }
+#endif // OPS_2D
+}
 #endif //OPS_2D outter
\ No newline at end of file
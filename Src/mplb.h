@@ -38,6 +38,7 @@
 #include "scheme.h"
 #include "type.h"
 #include "flowfield.h"
+#include "step_plan.h"
 #ifdef OPS_3D
 #include "evolution.h"
 #endif
@@ -37,6 +37,8 @@
  *  kernels for implementing numerical schemes
  */
 #include "scheme.h"
+#include <cassert>
+#include "boundary.h"
 ops_stencil LOCALSTENCIL;
 ops_stencil ONEPTREGULARSTENCIL;
 ops_stencil ONEPTLATTICESTENCIL;
@@ -102,6 +104,47 @@ void DefineScheme(const SchemeType scheme) {
             SetSchemeHaloNum(1);
             ops_printf("The stream-collision scheme is chosen!\n");
         } break;
+        case Scheme_StreamCollisionFusedMoments: {
+            SetSchemeHaloNum(1);
+            ops_printf(
+                "The stream-collision scheme with the fused moment-collision "
+                "kernel and a separate streaming is chosen!\n");
+        } break;
+        case Scheme_StreamCollisionInPlace: {
+            if (!FusedCollisionSupported()) {
+                ops_printf(
+                    "Error! The in-place stream-collision scheme only "
+                    "supports the isothermal BGK model with the density and "
+                    "velocity as macroscopic variables!\n");
+                assert(FusedCollisionSupported());
+            }
+            for (const auto& boundary : BlockBoundaries()) {
+                if (!InPlaceStreamingSupported(boundary.boundaryScheme)) {
+                    ops_printf(
+                        "Error! The boundary scheme %i is not supported by "
+                        "the in-place stream-collision scheme!\n",
+                        boundary.boundaryScheme);
+                    assert(InPlaceStreamingSupported(boundary.boundaryScheme));
+                }
+            }
+            SetSchemeHaloNum(1);
+            ops_printf(
+                "The in-place stream-collision scheme with a half-size "
+                "swap array is chosen!\n");
+        } break;
+        case Scheme_StreamCollisionPull: {
+            if (!FusedCollisionSupported()) {
+                ops_printf(
+                    "Error! The pull stream-collision scheme only supports "
+                    "the isothermal BGK model with the density and velocity "
+                    "as macroscopic variables!\n");
+                assert(FusedCollisionSupported());
+            }
+            SetSchemeHaloNum(1);
+            ops_printf(
+                "The pull stream-collision scheme with a fused kernel for "
+                "the Fluid boxes of the bulk is chosen!\n");
+        } break;
         default:
             break;
     }
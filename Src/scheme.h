@@ -40,6 +40,8 @@
 #include "flowfield.h"
 #include "model.h"
 #include "type.h"
+// See step_plan.h
+struct BlockPlan;
 
 // Define common stencils for implementing numerical schemes
 /*!
@@ -72,11 +74,31 @@ void DefineScheme(const SchemeType scheme);
 const int SchemeHaloNum();
 void SetSchemeHaloNum(const int schemeHaloNum);
 const SchemeType Scheme();
+/*!
+ * Stream the Fluid boxes of the bulk with the kernels which do not read the
+ * node types, see Block::FluidRanges, and the rest of the whole range with
+ * the general kernels. The block halos shall have been transferred.
+ */
 #ifdef OPS_3D
 void Stream3D();
+void StreamInPlace3D();
 #endif //OPS_3D
 
 #ifdef OPS_2D
 void Stream();
+void StreamInPlace();
+#endif //OPS_2D
+/*!
+ * Stream the distributions within iterRng of a block, where StreamFluidBlock
+ * is only for the Fluid boxes of the bulk
+ */
+#ifdef OPS_3D
+void StreamBlock3D(const BlockPlan& plan, std::vector<int>& iterRng);
+void StreamFluidBlock3D(const BlockPlan& plan, std::vector<int>& iterRng);
+#endif //OPS_3D
+
+#ifdef OPS_2D
+void StreamBlock(const BlockPlan& plan, std::vector<int>& iterRng);
+void StreamFluidBlock(const BlockPlan& plan, std::vector<int>& iterRng);
 #endif //OPS_2D
 #endif
@@ -1,59 +1,324 @@
 #include <map>
 #include <vector>
 #include "flowfield.h"
+#include "step_plan.h"
 #include "scheme.h"
 #include "ops_seq_v2.h"
 #include "scheme_kernel.inc"
 #ifdef OPS_3D
-void Stream3D() {
+/*!
+ * Stream the distributions within iterRng of a block
+ */
+void StreamBlock3D(const BlockPlan& plan, std::vector<int>& iterRng) {
+#ifdef OPS_3D
+    for (const ComponentPlan& compoPlan : plan.components) {
+        const Component& compo{*compoPlan.compo};
+        switch (compo.latticeType) {
+            case Lattice_D3Q19:
+                ops_par_loop(KerStreamD3Q19, "KerStreamD3Q19",
+                             plan.block->Get(), SpaceDim(), iterRng.data(),
+                             ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                         g_f().Type(), OPS_RW),
+                             ops_arg_dat(plan.fStage, NUMXI,
+                                         ONEPTLATTICESTENCIL, g_fStage().Type(),
+                                         OPS_READ),
+                             ops_arg_dat(compoPlan.descriptor, 1, LOCALSTENCIL,
+                                         "short", OPS_READ),
+                             ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                break;
+            case Lattice_D3Q15:
+                ops_par_loop(KerStreamD3Q15, "KerStreamD3Q15",
+                             plan.block->Get(), SpaceDim(), iterRng.data(),
+                             ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                         g_f().Type(), OPS_RW),
+                             ops_arg_dat(plan.fStage, NUMXI,
+                                         ONEPTLATTICESTENCIL, g_fStage().Type(),
+                                         OPS_READ),
+                             ops_arg_dat(compoPlan.descriptor, 1, LOCALSTENCIL,
+                                         "short", OPS_READ),
+                             ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                break;
+            default:
+                ops_par_loop(KerStream3D, "KerStream3D", plan.block->Get(),
+                             SpaceDim(), iterRng.data(),
+                             ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                         g_f().Type(), OPS_RW),
+                             ops_arg_dat(plan.fStage, NUMXI,
+                                         ONEPTLATTICESTENCIL, g_fStage().Type(),
+                                         OPS_READ),
+                             ops_arg_dat(compoPlan.descriptor, 1, LOCALSTENCIL,
+                                         "short", OPS_READ),
+                             ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                break;
+        }
+    }
+#endif  // OPS_3D
+}
+
+/*!
+ * Stream the distributions within a Fluid box of a block, see
+ * Block::FluidRanges
+ */
+void StreamFluidBlock3D(const BlockPlan& plan, std::vector<int>& iterRng) {
 #ifdef OPS_3D
-    for (const auto& idBlock : g_Block()) {
-        const Block& block{idBlock.second};
-        std::vector<int> iterRng;
-        iterRng.assign(block.WholeRange().begin(), block.WholeRange().end());
-        const int blockIndex{block.ID()};
-        for (const auto& compo : g_Components()) {
-            ops_par_loop(
-                KerStream3D, "KerStream3D", block.Get(), SpaceDim(),
-                iterRng.data(),
-                ops_arg_dat(g_f().at(blockIndex), NUMXI, LOCALSTENCIL, "double",
-                            OPS_RW),
-                ops_arg_dat(g_fStage().at(blockIndex), NUMXI,
-                            ONEPTLATTICESTENCIL, "double", OPS_READ),
-                ops_arg_dat(g_NodeType().at(compo.first).at(blockIndex), 1,
-                            LOCALSTENCIL, "int", OPS_READ),
-                ops_arg_dat(g_GeometryProperty().at(blockIndex), 1,
-                            LOCALSTENCIL, "int", OPS_READ),
-                ops_arg_gbl(compo.second.index, 2, "int", OPS_READ));
+    for (const ComponentPlan& compoPlan : plan.components) {
+        const Component& compo{*compoPlan.compo};
+        switch (compo.latticeType) {
+            case Lattice_D3Q19:
+                ops_par_loop(KerStreamFluidD3Q19, "KerStreamFluidD3Q19",
+                             plan.block->Get(), SpaceDim(), iterRng.data(),
+                             ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                         g_f().Type(), OPS_RW),
+                             ops_arg_dat(plan.fStage, NUMXI,
+                                         ONEPTLATTICESTENCIL, g_fStage().Type(),
+                                         OPS_READ),
+                             ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                break;
+            case Lattice_D3Q15:
+                ops_par_loop(KerStreamFluidD3Q15, "KerStreamFluidD3Q15",
+                             plan.block->Get(), SpaceDim(), iterRng.data(),
+                             ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                         g_f().Type(), OPS_RW),
+                             ops_arg_dat(plan.fStage, NUMXI,
+                                         ONEPTLATTICESTENCIL, g_fStage().Type(),
+                                         OPS_READ),
+                             ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                break;
+            default:
+                ops_par_loop(KerStreamFluid3D, "KerStreamFluid3D",
+                             plan.block->Get(), SpaceDim(), iterRng.data(),
+                             ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                         g_f().Type(), OPS_RW),
+                             ops_arg_dat(plan.fStage, NUMXI,
+                                         ONEPTLATTICESTENCIL, g_fStage().Type(),
+                                         OPS_READ),
+                             ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                break;
         }
     }
-#endif // OPS_3Ds
+#endif  // OPS_3D
+}
+
+void Stream3D() {
+    ForEachBlockPlan([](BlockPlan& plan) {
+        for (auto& range : plan.fluidRanges) {
+            StreamFluidBlock3D(plan, range);
+        }
+        for (auto& range : plan.bulkBoundaryRanges) {
+            StreamBlock3D(plan, range);
+        }
+        for (auto& range : plan.shellRanges) {
+            StreamBlock3D(plan, range);
+        }
+    });
+}
+
+void StreamInPlace3D() {
+#ifdef OPS_3D
+    ForEachBlockPlan([](BlockPlan& plan) {
+        // The sweeps only read at the neighbours the dat which they do not
+        // write, and each one must have finished on the whole block before
+        // the next one reads what it has written
+        for (auto& range : plan.activeRanges) {
+            for (const ComponentPlan& compoPlan : plan.components) {
+                const Component& compo{*compoPlan.compo};
+                ops_par_loop(KerStreamFromSwap3D, "KerStreamFromSwap3D",
+                             plan.block->Get(), SpaceDim(), range.data(),
+                             ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                         g_f().Type(), OPS_RW),
+                             ops_arg_dat(plan.fStage, g_fStage().DataDim(),
+                                         ONEPTLATTICESTENCIL, g_fStage().Type(),
+                                         OPS_READ),
+                             ops_arg_dat(compoPlan.descriptor, 1, LOCALSTENCIL,
+                                         "short", OPS_READ),
+                             ops_arg_gbl(&compoPlan.swapStart, 1, "int",
+                                         OPS_READ),
+                             ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+            }
+        }
+        for (auto& range : plan.activeRanges) {
+            for (const ComponentPlan& compoPlan : plan.components) {
+                const Component& compo{*compoPlan.compo};
+                ops_par_loop(KerStreamToSwap3D, "KerStreamToSwap3D",
+                             plan.block->Get(), SpaceDim(), range.data(),
+                             ops_arg_dat(plan.f, NUMXI, ONEPTLATTICESTENCIL,
+                                         g_f().Type(), OPS_READ),
+                             ops_arg_dat(plan.fStage, g_fStage().DataDim(),
+                                         LOCALSTENCIL, g_fStage().Type(),
+                                         OPS_RW),
+                             ops_arg_dat(compoPlan.descriptor, 1, LOCALSTENCIL,
+                                         "short", OPS_READ),
+                             ops_arg_gbl(&compoPlan.swapStart, 1, "int",
+                                         OPS_READ),
+                             ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+            }
+        }
+        for (auto& range : plan.activeRanges) {
+            for (const ComponentPlan& compoPlan : plan.components) {
+                const Component& compo{*compoPlan.compo};
+                ops_par_loop(KerCopyFromSwap3D, "KerCopyFromSwap3D",
+                             plan.block->Get(), SpaceDim(), range.data(),
+                             ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                         g_f().Type(), OPS_RW),
+                             ops_arg_dat(plan.fStage, g_fStage().DataDim(),
+                                         LOCALSTENCIL, g_fStage().Type(),
+                                         OPS_READ),
+                             ops_arg_dat(compoPlan.descriptor, 1, LOCALSTENCIL,
+                                         "short", OPS_READ),
+                             ops_arg_gbl(&compoPlan.swapStart, 1, "int",
+                                         OPS_READ),
+                             ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+            }
+        }
+    });
+#endif // OPS_3D
 }
 #endif  // OPS_3D
 
 #ifdef OPS_2D
-void Stream() {
+/*!
+ * Stream the distributions within iterRng of a block
+ */
+void StreamBlock(const BlockPlan& plan, std::vector<int>& iterRng) {
+#ifdef OPS_2D
+    for (const ComponentPlan& compoPlan : plan.components) {
+        const Component& compo{*compoPlan.compo};
+        switch (compo.latticeType) {
+            case Lattice_D2Q9:
+                ops_par_loop(KerStreamD2Q9, "KerStreamD2Q9", plan.block->Get(),
+                             SpaceDim(), iterRng.data(),
+                             ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                         g_f().Type(), OPS_RW),
+                             ops_arg_dat(plan.fStage, NUMXI,
+                                         ONEPTLATTICESTENCIL, g_fStage().Type(),
+                                         OPS_READ),
+                             ops_arg_dat(compoPlan.descriptor, 1, LOCALSTENCIL,
+                                         "short", OPS_READ),
+                             ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                break;
+            default:
+                ops_par_loop(KerStream, "KerStream", plan.block->Get(),
+                             SpaceDim(), iterRng.data(),
+                             ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                         g_f().Type(), OPS_RW),
+                             ops_arg_dat(plan.fStage, NUMXI,
+                                         ONEPTLATTICESTENCIL, g_fStage().Type(),
+                                         OPS_READ),
+                             ops_arg_dat(compoPlan.descriptor, 1, LOCALSTENCIL,
+                                         "short", OPS_READ),
+                             ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                break;
+        }
+    }
+#endif  // OPS_2D
+}
+
+/*!
+ * Stream the distributions within a Fluid box of a block, see
+ * Block::FluidRanges
+ */
+void StreamFluidBlock(const BlockPlan& plan, std::vector<int>& iterRng) {
 #ifdef OPS_2D
-    for (const auto& idBlock : g_Block()) {
-        const Block& block{idBlock.second};
-        std::vector<int> iterRng;
-        iterRng.assign(block.WholeRange().begin(), block.WholeRange().end());
-        const int blockIndex{block.ID()};
-        for (const auto& compo : g_Components()) {
-            ops_par_loop(
-                KerStream, "KerStream", block.Get(), SpaceDim(),
-                iterRng.data(),
-                ops_arg_dat(g_f().at(blockIndex), NUMXI, LOCALSTENCIL, "double",
-                            OPS_RW),
-                ops_arg_dat(g_fStage().at(blockIndex), NUMXI,
-                            ONEPTLATTICESTENCIL, "double", OPS_READ),
-                ops_arg_dat(g_NodeType().at(compo.first).at(blockIndex), 1,
-                            LOCALSTENCIL, "int", OPS_READ),
-                ops_arg_dat(g_GeometryProperty().at(blockIndex), 1,
-                            LOCALSTENCIL, "int", OPS_READ),
-                ops_arg_gbl(compo.second.index, 2, "int", OPS_READ));
+    for (const ComponentPlan& compoPlan : plan.components) {
+        const Component& compo{*compoPlan.compo};
+        switch (compo.latticeType) {
+            case Lattice_D2Q9:
+                ops_par_loop(KerStreamFluidD2Q9, "KerStreamFluidD2Q9",
+                             plan.block->Get(), SpaceDim(), iterRng.data(),
+                             ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                         g_f().Type(), OPS_RW),
+                             ops_arg_dat(plan.fStage, NUMXI,
+                                         ONEPTLATTICESTENCIL, g_fStage().Type(),
+                                         OPS_READ),
+                             ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                break;
+            default:
+                ops_par_loop(KerStreamFluid, "KerStreamFluid",
+                             plan.block->Get(), SpaceDim(), iterRng.data(),
+                             ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                         g_f().Type(), OPS_RW),
+                             ops_arg_dat(plan.fStage, NUMXI,
+                                         ONEPTLATTICESTENCIL, g_fStage().Type(),
+                                         OPS_READ),
+                             ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+                break;
         }
     }
+#endif  // OPS_2D
+}
+
+void Stream() {
+    ForEachBlockPlan([](BlockPlan& plan) {
+        for (auto& range : plan.fluidRanges) {
+            StreamFluidBlock(plan, range);
+        }
+        for (auto& range : plan.bulkBoundaryRanges) {
+            StreamBlock(plan, range);
+        }
+        for (auto& range : plan.shellRanges) {
+            StreamBlock(plan, range);
+        }
+    });
+}
+
+void StreamInPlace() {
+#ifdef OPS_2D
+    ForEachBlockPlan([](BlockPlan& plan) {
+        // The sweeps only read at the neighbours the dat which they do not
+        // write, and each one must have finished on the whole block before
+        // the next one reads what it has written
+        for (auto& range : plan.activeRanges) {
+            for (const ComponentPlan& compoPlan : plan.components) {
+                const Component& compo{*compoPlan.compo};
+                ops_par_loop(KerStreamFromSwap, "KerStreamFromSwap",
+                             plan.block->Get(), SpaceDim(), range.data(),
+                             ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                         g_f().Type(), OPS_RW),
+                             ops_arg_dat(plan.fStage, g_fStage().DataDim(),
+                                         ONEPTLATTICESTENCIL, g_fStage().Type(),
+                                         OPS_READ),
+                             ops_arg_dat(compoPlan.descriptor, 1, LOCALSTENCIL,
+                                         "short", OPS_READ),
+                             ops_arg_gbl(&compoPlan.swapStart, 1, "int",
+                                         OPS_READ),
+                             ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+            }
+        }
+        for (auto& range : plan.activeRanges) {
+            for (const ComponentPlan& compoPlan : plan.components) {
+                const Component& compo{*compoPlan.compo};
+                ops_par_loop(KerStreamToSwap, "KerStreamToSwap",
+                             plan.block->Get(), SpaceDim(), range.data(),
+                             ops_arg_dat(plan.f, NUMXI, ONEPTLATTICESTENCIL,
+                                         g_f().Type(), OPS_READ),
+                             ops_arg_dat(plan.fStage, g_fStage().DataDim(),
+                                         LOCALSTENCIL, g_fStage().Type(),
+                                         OPS_RW),
+                             ops_arg_dat(compoPlan.descriptor, 1, LOCALSTENCIL,
+                                         "short", OPS_READ),
+                             ops_arg_gbl(&compoPlan.swapStart, 1, "int",
+                                         OPS_READ),
+                             ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+            }
+        }
+        for (auto& range : plan.activeRanges) {
+            for (const ComponentPlan& compoPlan : plan.components) {
+                const Component& compo{*compoPlan.compo};
+                ops_par_loop(KerCopyFromSwap, "KerCopyFromSwap",
+                             plan.block->Get(), SpaceDim(), range.data(),
+                             ops_arg_dat(plan.f, NUMXI, LOCALSTENCIL,
+                                         g_f().Type(), OPS_RW),
+                             ops_arg_dat(plan.fStage, g_fStage().DataDim(),
+                                         LOCALSTENCIL, g_fStage().Type(),
+                                         OPS_READ),
+                             ops_arg_dat(compoPlan.descriptor, 1, LOCALSTENCIL,
+                                         "short", OPS_READ),
+                             ops_arg_gbl(&compoPlan.swapStart, 1, "int",
+                                         OPS_READ),
+                             ops_arg_gbl(compo.index, 2, "int", OPS_READ));
+            }
+        }
+    });
 #endif // OPS_2D
 }
 #endif  // OPS_2D
\ No newline at end of file
@@ -0,0 +1,257 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*! @brief   Implement the raw snapshots of the flow field
+ * @author  Jianping Meng
+ * @details The snapshots are written by the POSIX calls so that each
+ * payload is a single aligned write and read back through mmap.
+ */
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "ops_lib_core.h"
+#ifdef OPS_MPI
+#include "ops_mpi_core.h"
+#endif
+#include "snapshot.h"
+
+// The Python reader in PostProcess.py relies on these sizes
+static_assert(sizeof(SnapshotHeader) == 48, "Unexpected snapshot header");
+static_assert(sizeof(SnapshotEntry) == 176, "Unexpected snapshot entry");
+
+const char SnapshotMagic[8]{'M', 'P', 'L', 'B', 'S', 'N', 'A', 'P'};
+
+SizeType PaddedSize(const SizeType bytes) {
+    return (bytes + SnapshotAlignment - 1) / SnapshotAlignment *
+           SnapshotAlignment;
+}
+
+void CopySnapshotName(char* dest, const SizeType destSize,
+                      const std::string& name) {
+    if (name.size() >= destSize) {
+        ops_printf("Error! The name %s is too long for a snapshot entry\n",
+                   name.c_str());
+        assert(name.size() < destSize);
+    }
+    std::strncpy(dest, name.c_str(), destSize - 1);
+}
+
+SnapshotEntry MakeSnapshotEntry(const std::string& field,
+                                const std::string& block,
+                                const std::string& type) {
+    SnapshotEntry entry;
+    std::memset(&entry, 0, sizeof(entry));
+    CopySnapshotName(entry.field, sizeof(entry.field), field);
+    CopySnapshotName(entry.block, sizeof(entry.block), block);
+    CopySnapshotName(entry.type, sizeof(entry.type), type);
+    return entry;
+}
+
+bool IsSameSnapshotShape(const SnapshotEntry& entry,
+                         const SnapshotEntry& other) {
+    bool same{std::strcmp(entry.type, other.type) == 0 &&
+              entry.spaceDim == other.spaceDim && entry.dim == other.dim &&
+              entry.typeSize == other.typeSize &&
+              entry.layout == other.layout && entry.bytes == other.bytes};
+    for (int axis = 0; axis < 3; axis++) {
+        same = same && entry.blockSize[axis] == other.blockSize[axis] &&
+               entry.disp[axis] == other.disp[axis] &&
+               entry.size[axis] == other.size[axis];
+    }
+    return same;
+}
+
+/*!
+ * A snapshot is written and read by each rank on its own, so that an I/O
+ * failure may happen on a single rank. The message is printed by that rank
+ * and the whole run is aborted rather than asserted, which NDEBUG would
+ * compile out.
+ */
+[[noreturn]] static void AbortSnapshot(const std::string& message) {
+    std::fprintf(stderr, "Error! %s\n", message.c_str());
+#ifdef OPS_MPI
+    MPI_Abort(OPS_MPI_GLOBAL, EXIT_FAILURE);
+#endif
+    std::exit(EXIT_FAILURE);
+}
+
+std::string SnapshotFileName(const std::string& caseName,
+                             const SizeType timeStep) {
+    std::string fileName{caseName + "_T" + std::to_string(timeStep)};
+#ifdef OPS_MPI
+    fileName += "_R" + std::to_string(ops_my_global_rank);
+#endif
+    return fileName + ".snap";
+}
+
+SnapshotWriter::SnapshotWriter(const std::string& name, const SizeType step)
+    : fileName{name}, tempName{name + ".tmp"}, timeStep{step} {
+    file = open(tempName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (file < 0) {
+        AbortSnapshot("Cannot create the snapshot " + tempName);
+    }
+    // The header occupies the first unit so that the payloads are aligned
+    position = SnapshotAlignment;
+}
+
+SnapshotWriter::~SnapshotWriter() {
+    if (file >= 0) {
+        close(file);
+        std::remove(tempName.c_str());
+    }
+    std::free(buffer);
+}
+
+void SnapshotWriter::WriteAt(const char* data, const SizeType bytes,
+                             const SizeType offset) {
+    SizeType written{0};
+    while (written < bytes) {
+        const ssize_t count{
+            pwrite(file, data + written, bytes - written, offset + written)};
+        if (count <= 0) {
+            AbortSnapshot("Cannot write the snapshot " + tempName);
+        }
+        written += count;
+    }
+}
+
+char* SnapshotWriter::Buffer(const SizeType bytes) {
+    const SizeType size{PaddedSize(bytes)};
+    if (size > bufferSize) {
+        std::free(buffer);
+        buffer = nullptr;
+        void* aligned{nullptr};
+        const bool allocated{
+            posix_memalign(&aligned, SnapshotAlignment, size) == 0};
+        if (!allocated) {
+            AbortSnapshot("Cannot allocate " + std::to_string(size) +
+                          " bytes for the snapshot");
+        }
+        buffer = static_cast<char*>(aligned);
+        bufferSize = size;
+    }
+    return buffer;
+}
+
+void SnapshotWriter::Append(const SnapshotEntry& entry) {
+    SnapshotEntry written{entry};
+    written.offset = position;
+    const SizeType size{PaddedSize(entry.bytes)};
+    if (size > 0) {
+        std::memset(buffer + entry.bytes, 0, size - entry.bytes);
+        WriteAt(buffer, size, position);
+    }
+    position += size;
+    entries.push_back(written);
+}
+
+void SnapshotWriter::Close() {
+    WriteAt(reinterpret_cast<const char*>(entries.data()),
+            entries.size() * sizeof(SnapshotEntry), position);
+    SnapshotHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, SnapshotMagic, sizeof(header.magic));
+    header.version = SnapshotVersion;
+    header.timeStep = timeStep;
+    header.entryNum = entries.size();
+    header.tableOffset = position;
+    header.alignment = SnapshotAlignment;
+    WriteAt(reinterpret_cast<const char*>(&header), sizeof(header), 0);
+    const bool flushed{fsync(file) == 0};
+    close(file);
+    file = -1;
+    if (!flushed || std::rename(tempName.c_str(), fileName.c_str()) != 0) {
+        AbortSnapshot("Cannot finish the snapshot " + fileName);
+    }
+}
+
+SnapshotReader::SnapshotReader(const std::string& name) : fileName{name} {
+    file = open(fileName.c_str(), O_RDONLY);
+    struct stat status;
+    const bool opened{file >= 0 && fstat(file, &status) == 0 &&
+                      (SizeType)status.st_size >= sizeof(SnapshotHeader)};
+    if (!opened) {
+        AbortSnapshot("Cannot open the snapshot " + fileName);
+    }
+    mappedSize = status.st_size;
+    void* address{mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, file, 0)};
+    if (address == MAP_FAILED) {
+        AbortSnapshot("Cannot map the snapshot " + fileName);
+    }
+    mapped = static_cast<char*>(address);
+    madvise(mapped, mappedSize, MADV_SEQUENTIAL);
+    SnapshotHeader header;
+    std::memcpy(&header, mapped, sizeof(header));
+    const bool valid{
+        std::memcmp(header.magic, SnapshotMagic, sizeof(header.magic)) == 0 &&
+        header.version == SnapshotVersion &&
+        header.tableOffset + header.entryNum * sizeof(SnapshotEntry) <=
+            mappedSize};
+    if (!valid) {
+        AbortSnapshot(fileName + " is not a valid snapshot");
+    }
+    timeStep = header.timeStep;
+    for (SizeType idx = 0; idx < header.entryNum; idx++) {
+        SnapshotEntry entry;
+        std::memcpy(&entry,
+                    mapped + header.tableOffset + idx * sizeof(SnapshotEntry),
+                    sizeof(entry));
+        entry.field[sizeof(entry.field) - 1] = '\0';
+        entry.block[sizeof(entry.block) - 1] = '\0';
+        entry.type[sizeof(entry.type) - 1] = '\0';
+        if (entry.offset + entry.bytes > mappedSize) {
+            AbortSnapshot("The entry " + std::string{entry.field} + " of " +
+                          fileName + " is truncated");
+        }
+        entries.emplace(std::string{entry.field} + "/" + entry.block, entry);
+    }
+}
+
+SnapshotReader::~SnapshotReader() {
+    if (mapped != nullptr) {
+        munmap(mapped, mappedSize);
+    }
+    if (file >= 0) {
+        close(file);
+    }
+}
+
+const SnapshotEntry* SnapshotReader::Find(const std::string& field,
+                                          const std::string& block) const {
+    const auto entry = entries.find(field + "/" + block);
+    return entry == entries.end() ? nullptr : &entry->second;
+}
@@ -0,0 +1,167 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*! @brief   Declare the raw snapshots of the flow field
+ * @author  Jianping Meng
+ * @details A snapshot is a light checkpoint for short intervals, e.g., on
+ * a node-local disk, which avoids the metadata of HDF5. Each process writes
+ * its partitions into its own file with a header, the payloads aligned to
+ * SnapshotAlignment and a table of the entries at the end. A file is
+ * written under a temporary name and renamed when it is complete, so that
+ * an interrupted snapshot never replaces a complete one. The file is mapped
+ * when restarting and the payloads are set into the fields directly from
+ * the mapping. ConvertSnapshotsToHDF5 in PostProcess.py merges the
+ * snapshots of the processes into the single checkpoint file.
+ */
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "type.h"
+// The payloads are aligned to, and written in multiples of, this size
+constexpr SizeType SnapshotAlignment{4096};
+constexpr uint32_t SnapshotVersion{1};
+/*!
+ * The header at the beginning of a snapshot, where the entries are found
+ * at tableOffset
+ */
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t timeStep;
+    uint64_t entryNum;
+    uint64_t tableOffset;
+    uint64_t alignment;
+};
+/*!
+ * The local partition of a field on a block, i.e., the dataset
+ * /block/field_block of the single checkpoint file, see
+ * SingleCheckpointFileName, at the displacement disp with the size size.
+ * The payload is stored as [nz][ny][nx][dim] in the same way.
+ */
+struct SnapshotEntry {
+    char field[64];
+    char block[32];
+    // The type string passed to OPS, e.g., "double"
+    char type[8];
+    int32_t blockId;
+    int32_t spaceDim;
+    int32_t dim;
+    int32_t typeSize;
+    // See DataLayout
+    int32_t layout;
+    int32_t blockSize[3];
+    int32_t disp[3];
+    int32_t size[3];
+    uint64_t offset;
+    uint64_t bytes;
+};
+/*!
+ * An entry with the names and the type set and the others zeroed, where a
+ * name too long for the entry is an error
+ */
+SnapshotEntry MakeSnapshotEntry(const std::string& field,
+                                const std::string& block,
+                                const std::string& type);
+// If two entries describe the same partition with the same type and layout
+bool IsSameSnapshotShape(const SnapshotEntry& entry,
+                         const SnapshotEntry& other);
+/*!
+ * caseName_TtimeStep.snap, or caseName_TtimeStep_Rrank.snap in the MPI
+ * version where each rank writes its own partitions
+ */
+std::string SnapshotFileName(const std::string& caseName,
+                             const SizeType timeStep);
+
+class SnapshotWriter {
+   private:
+    std::string fileName;
+    std::string tempName;
+    int file{-1};
+    SizeType timeStep{0};
+    SizeType position{0};
+    std::vector<SnapshotEntry> entries;
+    char* buffer{nullptr};
+    SizeType bufferSize{0};
+    void WriteAt(const char* data, const SizeType bytes,
+                 const SizeType offset);
+
+   public:
+    SnapshotWriter(const std::string& fileName, const SizeType timeStep);
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+    ~SnapshotWriter();
+    /*!
+     * The aligned staging buffer of a payload, which holds at least bytes
+     * and is valid until the next call
+     */
+    char* Buffer(const SizeType bytes);
+    /*!
+     * Write the payload in the staging buffer with the padding as a single
+     * aligned write and record the entry
+     */
+    void Append(const SnapshotEntry& entry);
+    /*!
+     * Write the table and the header, flush the file to the disk and
+     * rename it to fileName
+     */
+    void Close();
+};
+
+class SnapshotReader {
+   private:
+    std::string fileName;
+    int file{-1};
+    char* mapped{nullptr};
+    SizeType mappedSize{0};
+    SizeType timeStep{0};
+    std::map<std::string, SnapshotEntry> entries;
+
+   public:
+    explicit SnapshotReader(const std::string& fileName);
+    SnapshotReader(const SnapshotReader&) = delete;
+    SnapshotReader& operator=(const SnapshotReader&) = delete;
+    ~SnapshotReader();
+    // nullptr if there is no such entry
+    const SnapshotEntry* Find(const std::string& field,
+                              const std::string& block) const;
+    // The payload of an entry within the mapping
+    const char* Payload(const SnapshotEntry& entry) const {
+        return mapped + entry.offset;
+    };
+    SizeType TimeStep() const { return timeStep; };
+    const std::string& FileName() const { return fileName; };
+};
+#endif  // SNAPSHOT_H
@@ -0,0 +1,251 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*! @brief   Implementing functions for the plan of the kernel launches
+ * @author  Jianping Meng
+ * @details The plan is resolved from the field groups, the blocks and the
+ * boundary conditions after the partition, and replayed by the wrappers of
+ * the collision, streaming and boundary kernels in every time step.
+ */
+#include <map>
+#include <memory>
+#include <vector>
+#include "ops_lib_core.h"
+#ifdef OPS_MPI
+#include "ops_mpi_core.h"
+#endif
+#include "step_plan.h"
+#include "executor.h"
+#include "flowfield.h"
+
+std::vector<BlockPlan> BLOCKPLANS;
+std::vector<BoundaryPlan> BOUNDARYPLANS;
+
+std::vector<BlockPlan>& StepPlan() { return BLOCKPLANS; }
+
+std::vector<BoundaryPlan>& BoundaryStepPlan() { return BOUNDARYPLANS; }
+
+// Created by SetBlockThreadNum if the blocks are executed concurrently
+std::unique_ptr<TaskExecutor> BLOCKEXECUTOR;
+
+void SetBlockThreadNum(const int threadNum) {
+    if (threadNum < 1) {
+        ops_printf("Error! The block thread number %i is less than one!\n",
+                   threadNum);
+        assert(threadNum >= 1);
+    }
+#ifdef OPS_MPI
+    if (threadNum > 1) {
+        ops_printf(
+            "Warning! The blocks are executed one after another in the MPI "
+            "version!\n");
+    }
+    BLOCKEXECUTOR.reset();
+#elif !defined(CPU)
+    // The code generated by the translator queues every loop in a list
+    // shared by the blocks (the lazy execution) or launches it on one
+    // device stream, where neither is thread-safe
+    if (threadNum > 1) {
+        ops_printf(
+            "Error! The blocks can only be executed by %i threads in the "
+            "sequential development version, they are executed one after "
+            "another!\n",
+            threadNum);
+    }
+    BLOCKEXECUTOR.reset();
+#else
+    // The loops of the sequential development version are executed at once
+    // and only touch the dats of their own block and the reductions of the
+    // step plan, but OPS keeps its kernel timers and diagnostics in one
+    // global instance and queues the loops when tiling
+    const OPS_instance* instance{OPS_instance::getOPSInstance()};
+    const bool opsThreadSafe{instance->OPS_diags <= 1 &&
+                             instance->OPS_enable_tiling == 0};
+    if (threadNum > 1 && !opsThreadSafe) {
+        ops_printf(
+            "Error! The blocks cannot be executed by %i threads when the OPS "
+            "diagnostics level is above one or the lazy execution (tiling) is "
+            "on, they are executed one after another!\n",
+            threadNum);
+        BLOCKEXECUTOR.reset();
+    } else if (threadNum > 1) {
+        BLOCKEXECUTOR.reset(new TaskExecutor(threadNum));
+        ops_printf("The blocks are executed by %i threads\n", threadNum);
+    } else {
+        BLOCKEXECUTOR.reset();
+    }
+#endif
+}
+
+int BlockThreadNum() {
+    return BLOCKEXECUTOR == nullptr ? 1 : BLOCKEXECUTOR->ThreadNum();
+}
+
+void ForEachBlockPlan(const std::function<void(BlockPlan&)>& task) {
+    if (BLOCKEXECUTOR == nullptr || BLOCKPLANS.size() < 2) {
+        for (BlockPlan& plan : BLOCKPLANS) {
+            task(plan);
+        }
+        return;
+    }
+    BLOCKEXECUTOR->Run((int)BLOCKPLANS.size(),
+                       [&task](const int idx) { task(BLOCKPLANS.at(idx)); });
+}
+
+template <typename T>
+static ops_dat ResolveDat(const Field<T>& field, const int blockIndex) {
+    if (field.IsAllocated(blockIndex)) {
+        return field.at(blockIndex);
+    }
+    return nullptr;
+}
+
+static ops_dat ResolveMacroVar(const Component& compo,
+                               const VariableTypes type,
+                               const int blockIndex) {
+    if (compo.macroVars.count(type) == 0) {
+        return nullptr;
+    }
+    return g_MacroVars().at(compo.macroVars.at(type).id).at(blockIndex);
+}
+
+/*!
+ * The active ranges of a list of boxes put into one list
+ */
+static std::vector<std::vector<int>> ActiveRanges(
+    const Block& block, const std::vector<std::vector<int>>& ranges) {
+    std::vector<std::vector<int>> activeRanges;
+    for (const auto& range : ranges) {
+        for (const auto& activeRange : block.ActiveRanges(range)) {
+            activeRanges.push_back(activeRange);
+        }
+    }
+    return activeRanges;
+}
+
+static ComponentPlan ResolveComponent(const Component& compo,
+                                      const int blockIndex) {
+    ComponentPlan plan;
+    plan.compo = &compo;
+    plan.descriptor = ResolveDat(g_NodeDescriptor().at(compo.id), blockIndex);
+    plan.densityVelocity = HasDensityVelocity(compo);
+    plan.rho = ResolveMacroVar(compo, Variable_Rho, blockIndex);
+    plan.u = nullptr;
+    plan.v = nullptr;
+    plan.w = nullptr;
+    // The velocity ids are only set if the density and velocity are defined
+    if (plan.densityVelocity) {
+        plan.u = g_MacroVars().at(compo.uId).at(blockIndex);
+        plan.v = g_MacroVars().at(compo.vId).at(blockIndex);
+#ifdef OPS_3D
+        plan.w = g_MacroVars().at(compo.wId).at(blockIndex);
+#endif
+    }
+    plan.temperature = ResolveMacroVar(compo, Variable_T, blockIndex);
+    plan.acceleration = AccelerationField(compo.id).at(blockIndex);
+    plan.bodyForceOn = compo.bodyForceType == BodyForce_1st ? 1 : 0;
+    plan.forceCorrection[0] =
+        compo.macroVars.count(Variable_U_Force) > 0 ? 1 : 0;
+    plan.forceCorrection[1] =
+        compo.macroVars.count(Variable_V_Force) > 0 ? 1 : 0;
+    plan.forceCorrection[2] =
+        compo.macroVars.count(Variable_W_Force) > 0 ? 1 : 0;
+    plan.swapStart = OppositePairNum(0, compo.index[0] - 1);
+    return plan;
+}
+
+BoundaryPlan ResolveBoundary(const Block& block, const int componentID,
+                             const Real* givenVars,
+                             const BoundaryScheme boundaryScheme,
+                             const BoundarySurface boundarySurface) {
+    const int blockIndex{block.ID()};
+    BoundaryPlan plan;
+    plan.block = &block;
+    plan.compo = &g_Components().at(componentID);
+    plan.f = g_f().at(blockIndex);
+    plan.descriptor = g_NodeDescriptor().at(componentID).at(blockIndex);
+    plan.range = block.BoundarySurfaceRange().at(boundarySurface);
+    plan.givenVars = givenVars;
+    plan.boundaryScheme = boundaryScheme;
+    plan.surface = (int)boundarySurface;
+    return plan;
+}
+
+/*!
+ * The reduction of the collision checks of a block, which is kept over the
+ * rebuilds of the step plan
+ */
+static ops_reduction BulkInvalidHandle(const int blockIndex) {
+    static std::map<int, ops_reduction> handles;
+    if (handles.count(blockIndex) == 0) {
+        handles.emplace(blockIndex,
+                        ops_decl_reduction_handle(sizeof(int), "int",
+                                                  "BulkCollisionInvalidNum"));
+    }
+    return handles.at(blockIndex);
+}
+
+void BuildStepPlan() {
+    BLOCKPLANS.clear();
+    for (const auto& idBlock : g_Block()) {
+        const Block& block{idBlock.second};
+        const int blockIndex{block.ID()};
+        BlockPlan plan;
+        plan.block = &block;
+        plan.f = ResolveDat(g_f(), blockIndex);
+        plan.fStage = ResolveDat(g_fStage(), blockIndex);
+        plan.fNext = ResolveDat(g_fNext(), blockIndex);
+        plan.coordinates = ResolveDat(g_CoordinateXYZ(), blockIndex);
+        plan.activeRanges = block.ActiveRanges(block.WholeRange());
+        plan.bulkRanges = block.ActiveRanges(block.BulkRange());
+        plan.shellRanges = ActiveRanges(block, block.ShellRanges());
+        plan.fluidRanges = ActiveRanges(block, block.FluidRanges());
+        plan.bulkBoundaryRanges =
+            ActiveRanges(block, block.BulkBoundaryRanges());
+        plan.bulkInvalidHandle = BulkInvalidHandle(blockIndex);
+        plan.bulkLoopNum = 0;
+        for (const auto& idCompo : g_Components()) {
+            plan.components.push_back(
+                ResolveComponent(idCompo.second, blockIndex));
+        }
+        BLOCKPLANS.push_back(plan);
+    }
+    BOUNDARYPLANS.clear();
+    for (const auto& boundary : BlockBoundaries()) {
+        BOUNDARYPLANS.push_back(ResolveBoundary(
+            g_Block().at(boundary.blockIndex), boundary.componentID,
+            boundary.givenVars.data(), boundary.boundaryScheme,
+            boundary.boundarySurface));
+    }
+    ops_printf("The step plan is resolved for %i blocks and %i boundaries\n",
+               (int)BLOCKPLANS.size(), (int)BOUNDARYPLANS.size());
+}
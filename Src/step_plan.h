@@ -0,0 +1,148 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*! @brief   Declare the plan of the kernel launches in a time step
+ * @author  Jianping Meng
+ * @details The fields are kept in groups keyed by the component, the
+ * macroscopic variable and the block, and the ranges of a block are
+ * assembled from its boxes and active tiles. The step plan resolves all of
+ * them once after the partition into flat arrays, so that the wrappers of
+ * a time step replay the resolved dats and ranges rather than looking them
+ * up for every kernel launch.
+ */
+#ifndef STEP_PLAN_H
+#define STEP_PLAN_H
+#include <functional>
+#include <vector>
+#include "type.h"
+#include "block.h"
+#include "field.h"
+#include "model.h"
+#include "boundary.h"
+/*!
+ * The dats read by the kernels of a component on a block. A dat is nullptr
+ * if the component does not define the field.
+ */
+struct ComponentPlan {
+    const Component* compo;
+    // The node type and geometry property of the time loop, where the int
+    // fields are only kept for setting them up and the I/O
+    ops_dat descriptor;
+    ops_dat rho;
+    ops_dat u;
+    ops_dat v;
+    ops_dat w;
+    ops_dat temperature;
+    ops_dat acceleration;
+    // Both the density and the velocity are defined, see HasDensityVelocity
+    bool densityVelocity;
+    int bodyForceOn;
+    int forceCorrection[3];
+    // The first slot of the component in the swap array of the in-place
+    // scheme, see OppositePairNum
+    int swapStart;
+};
+
+/*!
+ * The dats and ranges of the kernels on a block, where the range lists are
+ * restricted to the active tiles, see Block::ActiveRanges
+ */
+struct BlockPlan {
+    const Block* block;
+    ops_dat f;
+    // The swap array for the in-place scheme, see DefineStageDistribution
+    ops_dat fStage;
+    // The post-collision distribution of the next step for the pull scheme,
+    // see g_fNext
+    ops_dat fNext;
+    ops_dat coordinates;
+    std::vector<std::vector<int>> activeRanges;
+    std::vector<std::vector<int>> bulkRanges;
+    std::vector<std::vector<int>> shellRanges;
+    // The Fluid and boundary boxes of the bulk, see Block::FluidRanges
+    std::vector<std::vector<int>> fluidRanges;
+    std::vector<std::vector<int>> bulkBoundaryRanges;
+    std::vector<ComponentPlan> components;
+    // The count of the invalid nodes found by the branch-free collision
+    // kernels, which is per block so that the blocks executed concurrently
+    // share no reduction, and the loops queued with it since it was fetched
+    ops_reduction bulkInvalidHandle;
+    int bulkLoopNum;
+};
+
+/*!
+ * A boundary condition with its dats and range resolved, see BlockBoundary
+ */
+struct BoundaryPlan {
+    const Block* block;
+    const Component* compo;
+    ops_dat f;
+    ops_dat descriptor;
+    std::vector<int> range;
+    const Real* givenVars;
+    BoundaryScheme boundaryScheme;
+    int surface;
+};
+
+/*!
+ * Resolve the plan, which is called by PrepareFlowField and shall be called
+ * again if any field, range or boundary condition is redefined afterwards,
+ * e.g., by DecomposeBulkRanges.
+ */
+void BuildStepPlan();
+BoundaryPlan ResolveBoundary(const Block& block, const int componentID,
+                             const Real* givenVars,
+                             const BoundaryScheme boundaryScheme,
+                             const BoundarySurface boundarySurface);
+std::vector<BlockPlan>& StepPlan();
+std::vector<BoundaryPlan>& BoundaryStepPlan();
+/*!
+ * Execute the plans of independent blocks concurrently on a pool of
+ * threadNum threads in the collision, streaming and macroscopic variable
+ * phases, where one, the default, switches it off. The blocks are executed
+ * one after another in the MPI version since the halo exchanges inside the
+ * parallel loops are collective. The OPS core is not thread-safe, so that
+ * the blocks are only executed concurrently in the sequential development
+ * version (-DCPU without OPS_MPI), where a loop is executed at once and only
+ * touches the dats of its block and the reductions of its plan, and only if
+ * the OPS diagnostics level is not above one, i.e., the third argument of
+ * ops_init or -OPS_DIAGS, and the lazy execution (tiling) is off. Otherwise
+ * the blocks are executed one after another with an error message.
+ */
+void SetBlockThreadNum(const int threadNum);
+int BlockThreadNum();
+/*!
+ * Execute task for every block plan and return after all of them are
+ * finished, which keeps the order between the phases of a time step.
+ */
+void ForEachBlockPlan(const std::function<void(BlockPlan&)>& task);
+#endif  // STEP_PLAN_H
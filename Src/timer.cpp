@@ -0,0 +1,144 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*! @brief   Implementing functions for timing the phases of the time loop
+ * @author  Jianping Meng
+ * @details The performance reports are kept in a JSON array, which is
+ * rewritten to the file at every report so that the file is valid even if
+ * the simulation is stopped.
+ */
+#include <array>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include "json.hpp"
+#include "ops_lib_core.h"
+#ifdef OPS_MPI
+#include "ops_mpi_core.h"
+#endif
+#include "timer.h"
+#include "flowfield.h"
+
+const std::map<TimerPhase, std::string> TIMERPHASENAMES{
+    {Timer_MacroVars, "MacroVars"},
+    {Timer_EnvelopeCopy, "EnvelopeCopy"},
+    {Timer_BodyForce, "BodyForce"},
+    {Timer_Collision, "Collision"},
+    {Timer_HaloTransfer, "HaloTransfer"},
+    {Timer_Stream, "Stream"},
+    {Timer_Boundary, "Boundary"},
+    {Timer_Output, "Output"}};
+// Fixed arrays guarded by a lock, so that no timer is inserted or updated
+// by two threads at once, e.g., those of the block executor
+std::array<double, Timer_PhaseNum> phaseTime{};
+std::array<double, Timer_PhaseNum> phaseStartTime{};
+std::mutex timerMutex;
+SizeType fluidNodeNum{0};
+SizeType lastReportStep{0};
+double lastReportTime{0};
+double monitorStartTime{0};
+nlohmann::json performanceReports;
+
+double WallTime() {
+    double cpuTime, wallTime;
+    ops_timers(&cpuTime, &wallTime);
+    return wallTime;
+}
+
+void StartTimer(const TimerPhase phase) {
+    const double now{WallTime()};
+    std::lock_guard<std::mutex> lock(timerMutex);
+    phaseStartTime.at(phase) = now;
+}
+
+void StopTimer(const TimerPhase phase) {
+    const double now{WallTime()};
+    std::lock_guard<std::mutex> lock(timerMutex);
+    phaseTime.at(phase) += now - phaseStartTime.at(phase);
+}
+
+void StartPerformanceMonitor(const SizeType start) {
+    fluidNodeNum = CountFluidNodes();
+    {
+        std::lock_guard<std::mutex> lock(timerMutex);
+        phaseTime.fill(0);
+    }
+    performanceReports = nlohmann::json::array();
+    lastReportStep = start;
+    lastReportTime = WallTime();
+    monitorStartTime = lastReportTime;
+}
+
+void WritePerformanceReports() {
+#ifdef OPS_MPI
+    if (ops_my_global_rank != 0) {
+        return;
+    }
+#endif
+    nlohmann::json output;
+    output["CaseName"] = CaseName();
+    output["FluidNodes"] = fluidNodeNum;
+    output["Reports"] = performanceReports;
+    std::ofstream file{CaseName() + "_performance.json"};
+    file << output.dump(4) << std::endl;
+}
+
+double ReportPerformance(const SizeType timeStep) {
+    const double now{WallTime()};
+    const SizeType steps{timeStep - lastReportStep};
+    const double elapsed{now - lastReportTime};
+    const double total{now - monitorStartTime};
+    const double mlups{elapsed > 0 ? fluidNodeNum * steps / elapsed / 1e6 : 0};
+    ops_printf("Performance: %.6g MLUPS over the last %zu steps (%.6g s)\n",
+               mlups, steps, elapsed);
+    nlohmann::json phases;
+    std::lock_guard<std::mutex> lock(timerMutex);
+    for (const auto& pair : TIMERPHASENAMES) {
+        const double time{phaseTime.at(pair.first)};
+        ops_printf("  %-14s %12.6g s %6.2f%%\n", pair.second.c_str(), time,
+                   total > 0 ? 100 * time / total : 0);
+        phases[pair.second] = time;
+    }
+    nlohmann::json report;
+    report["TimeStep"] = timeStep;
+    report["Steps"] = steps;
+    report["WallTime"] = elapsed;
+    report["MLUPS"] = mlups;
+    report["TotalWallTime"] = total;
+    report["Phases"] = phases;
+    performanceReports.push_back(report);
+    WritePerformanceReports();
+    lastReportStep = timeStep;
+    lastReportTime = now;
+    return mlups;
+}
@@ -0,0 +1,71 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*! @brief   Declare functions for timing the phases of the time loop
+ * @author  Jianping Meng
+ * @details The wall time of each phase of a time step is accumulated, and
+ * the performance in million lattice updates per second (MLUPS) and the
+ * breakdown into phases are reported at every check period, both on the
+ * screen and in the file CaseName()_performance.json.
+ * Note: the phases are timed on the host. For backends executing the
+ * kernels asynchronously, e.g., CUDA or the lazy execution, the time of a
+ * kernel may be attributed to the phase where the host waits for it.
+ */
+#ifndef TIMER_H
+#define TIMER_H
+#include "type.h"
+enum TimerPhase {
+    Timer_MacroVars = 0,
+    Timer_EnvelopeCopy = 1,
+    Timer_BodyForce = 2,
+    Timer_Collision = 3,
+    Timer_HaloTransfer = 4,
+    Timer_Stream = 5,
+    Timer_Boundary = 6,
+    // The residual error and the checkpoints
+    Timer_Output = 7,
+    // The number of the phases
+    Timer_PhaseNum = 8,
+};
+void StartTimer(const TimerPhase phase);
+void StopTimer(const TimerPhase phase);
+/*!
+ * Reset the timers and count the fluid nodes before the time loop, where
+ * start is the starting step.
+ */
+void StartPerformanceMonitor(const SizeType start);
+/*!
+ * Report the MLUPS since the last report and the accumulated time of the
+ * phases, the MLUPS is returned.
+ */
+double ReportPerformance(const SizeType timeStep);
+#endif  // TIMER_H
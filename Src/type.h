@@ -49,6 +49,20 @@ typedef double Real;
 typedef float Real;
 //const char* RealC = "float";
 #endif
+/*
+ * The storage type of the distribution functions, i.e., g_f() and
+ * g_fStage(), which is chosen at the build time by FLOAT_DISTRIBUTION.
+ * In single precision, f-w_i is stored (see LoadF and StoreF) while the
+ * moments and the collision are still evaluated in Real. The files of g_f()
+ * record the shift, see Field::SetOffsets. The body force term which the
+ * two-array schemes keep in g_fStage() before the collision is not a
+ * distribution and is stored as it is.
+ */
+#ifdef FLOAT_DISTRIBUTION
+typedef float DistReal;
+#else
+typedef Real DistReal;
+#endif
 const Real PI{3.1415926535897932384626433832795};
 const Real EPS{std::numeric_limits<Real>::epsilon()};
 const Real BOLTZ{1.3806488e-23};
@@ -132,6 +146,9 @@ enum SchemeType {
     Scheme_E1st2nd = 1,
     Scheme_I1st2nd = -1,
     Scheme_StreamCollision = 10,
+    Scheme_StreamCollisionFusedMoments = 11,
+    Scheme_StreamCollisionInPlace = 12,
+    Scheme_StreamCollisionPull = 13,
 } ;
 
 inline bool EssentiallyEqual(const Real* a, const Real* b, const Real epsilon) {
@@ -0,0 +1,412 @@
+/**
+ * Copyright 2019 United Kingdom Research and Innovation
+ *
+ * Authors: See AUTHORS
+ *
+ * Contact: [jianping.meng@stfc.ac.uk and/or jpmeng@gmail.com]
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * ANDANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @brief Regression tests of the schemes and the restarts
+ *  @author Jianping Meng
+ *  @details Each run evolves a decaying shear wave in a fully periodic box of
+ *  two blocks and optionally compares the distributions and the macroscopic
+ *  variables at the last step with the checkpoint of a reference run, e.g.,
+ *  Regression2DSeqDev Case=InPlace Scheme=Scheme_StreamCollisionInPlace
+ *  End=20 Reference=Reference Tolerance=1e-12
+ *  A run restarts from the checkpoint of its own case if Start is not zero,
+ *  and writes checkpoints every Period steps and snapshots every Snapshot
+ *  steps. CMakeLists.txt chains the runs as the tests, e.g., the other
+ *  schemes against the two-array scheme, and the restarts from the full
+ *  distributions, the moments, the snapshots, the other layout and the
+ *  single-precision distributions against the uninterrupted run.
+ **/
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include "mplb.h"
+#include "ops_seq_v2.h"
+#include "regression_kernel.inc"
+
+/*!
+ * The settings of a regression run
+ */
+struct RegressionSetting {
+    std::string caseName{"Reference"};
+    std::string schemeName{"Scheme_StreamCollision"};
+    SchemeType scheme{Scheme_StreamCollision};
+    SizeType start{0};
+    SizeType end{20};
+    // Larger than end means no checkpoint
+    SizeType period{1000};
+    SizeType snapshotPeriod{0};
+    bool compactRestart{false};
+    bool singleFile{false};
+    // The case compared with at the last step, none if empty
+    std::string reference;
+    Real tolerance{0};
+};
+
+/*!
+ * Get the value of Key=value from the command line
+ */
+std::string GetArgFromCmd(const std::string& key,
+                          const std::string& defaultValue, const int argc,
+                          const char** argv) {
+    const std::string prefix{key + "="};
+    for (int i = 1; i < argc; i++) {
+        const std::string arg{argv[i]};
+        if (arg.find(prefix) == 0) {
+            return arg.substr(prefix.size());
+        }
+    }
+    return defaultValue;
+}
+
+RegressionSetting ReadRegressionSetting(const int argc, const char** argv) {
+    const std::map<std::string, SchemeType> schemes{
+        {"Scheme_StreamCollision", Scheme_StreamCollision},
+        {"Scheme_StreamCollisionFusedMoments",
+         Scheme_StreamCollisionFusedMoments},
+        {"Scheme_StreamCollisionInPlace", Scheme_StreamCollisionInPlace},
+        {"Scheme_StreamCollisionPull", Scheme_StreamCollisionPull}};
+    RegressionSetting setting;
+    setting.caseName = GetArgFromCmd("Case", setting.caseName, argc, argv);
+    setting.schemeName =
+        GetArgFromCmd("Scheme", setting.schemeName, argc, argv);
+    if (schemes.find(setting.schemeName) == schemes.end()) {
+        ops_printf("Error! The scheme %s is not supported!\n",
+                   setting.schemeName.c_str());
+        assert(schemes.find(setting.schemeName) != schemes.end());
+    }
+    setting.scheme = schemes.at(setting.schemeName);
+    setting.start = std::stoul(GetArgFromCmd("Start", "0", argc, argv));
+    setting.end = std::stoul(GetArgFromCmd("End", "20", argc, argv));
+    setting.period = std::stoul(GetArgFromCmd("Period", "1000", argc, argv));
+    setting.snapshotPeriod =
+        std::stoul(GetArgFromCmd("Snapshot", "0", argc, argv));
+    setting.compactRestart = GetArgFromCmd("Compact", "0", argc, argv) == "1";
+    setting.singleFile = GetArgFromCmd("SingleFile", "0", argc, argv) == "1";
+    setting.reference = GetArgFromCmd("Reference", "", argc, argv);
+    setting.tolerance = std::stod(GetArgFromCmd("Tolerance", "0", argc, argv));
+    if (setting.end < setting.start || setting.period == 0) {
+        ops_printf("Error! The steps from %zu to %zu every %zu are invalid!\n",
+                   setting.start, setting.end, setting.period);
+        assert(setting.end >= setting.start && setting.period > 0);
+    }
+    return setting;
+}
+
+// Provide macroscopic initial conditions
+void SetInitialMacrosVars() {
+    for (auto idBlock : g_Block()) {
+        Block& block{idBlock.second};
+        std::vector<int> iterRng;
+        iterRng.assign(block.WholeRange().begin(), block.WholeRange().end());
+        const int blockIdx{block.ID()};
+        for (auto& idCompo : g_Components()) {
+            const Component& compo{idCompo.second};
+            const int rhoId{compo.macroVars.at(Variable_Rho).id};
+#ifdef OPS_2D
+            ops_par_loop(KerSetInitialMacroVars, "KerSetInitialMacroVars",
+                         block.Get(), SpaceDim(), iterRng.data(),
+                         ops_arg_dat(g_MacroVars().at(rhoId).at(blockIdx), 1,
+                                     LOCALSTENCIL, "Real", OPS_RW),
+                         ops_arg_dat(g_MacroVars().at(compo.uId).at(blockIdx),
+                                     1, LOCALSTENCIL, "Real", OPS_RW),
+                         ops_arg_dat(g_MacroVars().at(compo.vId).at(blockIdx),
+                                     1, LOCALSTENCIL, "Real", OPS_RW),
+                         ops_arg_dat(g_CoordinateXYZ()[blockIdx], SpaceDim(),
+                                     LOCALSTENCIL, "Real", OPS_READ),
+                         ops_arg_idx());
+#endif
+#ifdef OPS_3D
+            ops_par_loop(KerSetInitialMacroVars, "KerSetInitialMacroVars",
+                         block.Get(), SpaceDim(), iterRng.data(),
+                         ops_arg_dat(g_MacroVars().at(rhoId).at(blockIdx), 1,
+                                     LOCALSTENCIL, "Real", OPS_RW),
+                         ops_arg_dat(g_MacroVars().at(compo.uId).at(blockIdx),
+                                     1, LOCALSTENCIL, "Real", OPS_RW),
+                         ops_arg_dat(g_MacroVars().at(compo.vId).at(blockIdx),
+                                     1, LOCALSTENCIL, "Real", OPS_RW),
+                         ops_arg_dat(g_MacroVars().at(compo.wId).at(blockIdx),
+                                     1, LOCALSTENCIL, "Real", OPS_RW),
+                         ops_arg_dat(g_CoordinateXYZ()[blockIdx], SpaceDim(),
+                                     LOCALSTENCIL, "Real", OPS_READ),
+                         ops_arg_idx());
+#endif
+        }
+    }
+}
+// Provide macroscopic body-force term
+void UpdateMacroscopicBodyForce(const Real time) {}
+
+/*!
+ * Two blocks side by side along x, which are connected to each other by the
+ * MD-style periodic halos, where each block is periodic by itself along the
+ * other axes. The mesh size is returned.
+ */
+Real DefineRegressionBlocks() {
+#ifdef OPS_2D
+    const std::vector<int> blockSize{8, 16, 8, 16};
+    const std::map<int, std::vector<Real>> startPos{{0, {0, 0}},
+                                                    {1, {0.5, 0}}};
+    const std::vector<BoundarySurface> selfSurfaces{BoundarySurface::Top,
+                                                    BoundarySurface::Bottom};
+#endif
+#ifdef OPS_3D
+    const std::vector<int> blockSize{6, 12, 12, 6, 12, 12};
+    const std::map<int, std::vector<Real>> startPos{{0, {0, 0, 0}},
+                                                    {1, {0.5, 0, 0}}};
+    const std::vector<BoundarySurface> selfSurfaces{
+        BoundarySurface::Top, BoundarySurface::Bottom, BoundarySurface::Front,
+        BoundarySurface::Back};
+#endif
+    const Real meshSize{1.0 / (2 * blockSize.at(0))};
+    DefineBlocks({0, 1}, {"Block0", "Block1"}, blockSize, meshSize, startPos);
+    std::vector<int> fromBlockIds{0, 1, 1, 0};
+    std::vector<BoundarySurface> fromSurfaces{
+        BoundarySurface::Right, BoundarySurface::Left, BoundarySurface::Right,
+        BoundarySurface::Left};
+    std::vector<int> toBlockIds{1, 0, 0, 1};
+    std::vector<BoundarySurface> toSurfaces{
+        BoundarySurface::Left, BoundarySurface::Right, BoundarySurface::Left,
+        BoundarySurface::Right};
+    for (int blockId = 0; blockId < 2; blockId++) {
+        for (SizeType idx = 0; idx < selfSurfaces.size(); idx += 2) {
+            fromBlockIds.push_back(blockId);
+            fromSurfaces.push_back(selfSurfaces.at(idx));
+            toBlockIds.push_back(blockId);
+            toSurfaces.push_back(selfSurfaces.at(idx + 1));
+            fromBlockIds.push_back(blockId);
+            fromSurfaces.push_back(selfSurfaces.at(idx + 1));
+            toBlockIds.push_back(blockId);
+            toSurfaces.push_back(selfSurfaces.at(idx));
+        }
+    }
+    std::vector<VertexType> connectionTypes(fromBlockIds.size(),
+                                            VertexType::MDPeriodic);
+    DefineBlockConnection(fromBlockIds, fromSurfaces, toBlockIds, toSurfaces,
+                          connectionTypes);
+    return meshSize;
+}
+
+/*!
+ * The largest difference of the distributions and of each macroscopic
+ * variable from those read from the reference case, which are declared
+ * before the partition
+ */
+struct ReferenceFields {
+    DistributionField f{"f"};
+    std::map<int, RealField> macroVars;
+};
+
+void DefineReferenceFields(ReferenceFields& reference,
+                           const RegressionSetting& setting) {
+    reference.f.SetDataDim(NUMXI);
+    reference.f.SetOffsets(g_f().Offsets());
+    reference.f.CreateFieldFromFile(setting.reference, g_Block(), setting.end);
+    for (const auto& idMacroVar : g_MacroVars()) {
+        reference.macroVars.emplace(idMacroVar.first,
+                                    RealField{idMacroVar.second.Name()});
+        reference.macroVars.at(idMacroVar.first)
+            .CreateFieldFromFile(setting.reference, g_Block(), setting.end);
+    }
+}
+
+Real MaxDifference(ops_reduction handle) {
+    Real maxDifference{0};
+    ops_reduction_result(handle, &maxDifference);
+    return maxDifference;
+}
+
+bool CompareWithReference(const ReferenceFields& reference,
+                          const RegressionSetting& setting) {
+    ops_reduction handle{ops_decl_reduction_handle(sizeof(Real), "double",
+                                                   "MaxDifference")};
+    for (const auto& idBlock : g_Block()) {
+        const Block& block{idBlock.second};
+        std::vector<int> iterRng;
+        iterRng.assign(block.WholeRange().begin(), block.WholeRange().end());
+        ops_par_loop(KerDistributionDifference, "KerDistributionDifference",
+                     block.Get(), SpaceDim(), iterRng.data(),
+                     ops_arg_dat(g_f()[block.ID()], NUMXI, LOCALSTENCIL,
+                                 g_f().Type(), OPS_READ),
+                     ops_arg_dat(reference.f[block.ID()], NUMXI, LOCALSTENCIL,
+                                 g_f().Type(), OPS_READ),
+                     ops_arg_reduce(handle, 1, "double", OPS_MAX));
+    }
+    const Real fDifference{MaxDifference(handle)};
+    bool passed{fDifference <= setting.tolerance};
+    ops_printf("The largest difference of f from %s is %.6e\n",
+               setting.reference.c_str(), fDifference);
+    for (const auto& idMacroVar : g_MacroVars()) {
+        const RealField& macroVar{idMacroVar.second};
+        for (const auto& idBlock : g_Block()) {
+            const Block& block{idBlock.second};
+            std::vector<int> iterRng;
+            iterRng.assign(block.WholeRange().begin(),
+                           block.WholeRange().end());
+            ops_par_loop(
+                KerMacroVarDifference, "KerMacroVarDifference", block.Get(),
+                SpaceDim(), iterRng.data(),
+                ops_arg_dat(macroVar[block.ID()], 1, LOCALSTENCIL, "double",
+                            OPS_READ),
+                ops_arg_dat(
+                    reference.macroVars.at(idMacroVar.first)[block.ID()], 1,
+                    LOCALSTENCIL, "double", OPS_READ),
+                ops_arg_reduce(handle, 1, "double", OPS_MAX));
+        }
+        const Real difference{MaxDifference(handle)};
+        ops_printf("The largest difference of %s from %s is %.6e\n",
+                   macroVar.Name().c_str(), setting.reference.c_str(),
+                   difference);
+        passed = passed && difference <= setting.tolerance;
+    }
+    return passed;
+}
+
+void simulate(const RegressionSetting& setting) {
+    DefineCase(setting.caseName, SpaceDim(), true);
+    const Real meshSize{DefineRegressionBlocks()};
+    std::vector<std::string> compoNames{"Fluid"};
+    std::vector<int> compoId{0};
+#ifdef OPS_2D
+    std::vector<std::string> lattNames{"d2q9"};
+#endif
+#ifdef OPS_3D
+    std::vector<std::string> lattNames{"d3q19"};
+#endif
+    std::vector<Real> tauRef{0.01};
+    DefineComponents(compoNames, compoId, lattNames, tauRef, setting.start);
+#ifdef OPS_2D
+    std::vector<VariableTypes> marcoVarTypes{Variable_Rho, Variable_U,
+                                             Variable_V};
+    std::vector<std::string> macroVarNames{"rho", "u", "v"};
+    std::vector<int> macroVarId{0, 1, 2};
+    std::vector<int> macroCompoId{0, 0, 0};
+#endif
+#ifdef OPS_3D
+    std::vector<VariableTypes> marcoVarTypes{Variable_Rho, Variable_U,
+                                             Variable_V, Variable_W};
+    std::vector<std::string> macroVarNames{"rho", "u", "v", "w"};
+    std::vector<int> macroVarId{0, 1, 2, 3};
+    std::vector<int> macroCompoId{0, 0, 0, 0};
+#endif
+    DefineMacroVars(marcoVarTypes, macroVarNames, macroVarId, macroCompoId,
+                    setting.start);
+    std::vector<CollisionType> collisionTypes{Collision_BGKIsothermal2nd};
+    std::vector<int> collisionCompoId{0};
+    DefineCollision(collisionTypes, collisionCompoId);
+    std::vector<BodyForceType> bodyForceTypes{BodyForce_None};
+    std::vector<SizeType> bodyForceCompoId{0};
+    DefineBodyForce(bodyForceTypes, bodyForceCompoId);
+    DefineScheme(setting.scheme);
+    DefineCheckpoint(false, 2, setting.singleFile);
+    DefineCompactRestart(setting.compactRestart);
+    if (setting.snapshotPeriod > 0) {
+        DefineSnapshots(setting.snapshotPeriod);
+    }
+    std::vector<BoundarySurface> surfaces{
+        BoundarySurface::Left, BoundarySurface::Right, BoundarySurface::Top,
+        BoundarySurface::Bottom};
+#ifdef OPS_3D
+    surfaces.push_back(BoundarySurface::Front);
+    surfaces.push_back(BoundarySurface::Back);
+#endif
+    for (const auto& idBlock : g_Block()) {
+        for (const auto surface : surfaces) {
+            DefineBlockBoundary(idBlock.first, 0, surface,
+                                BoundaryScheme::MDPeriodic, {}, {},
+                                VertexType::MDPeriodic);
+        }
+    }
+    std::vector<InitialType> initType{Initial_BGKFeq2nd};
+    std::vector<int> initalCompoId{0};
+    DefineInitialCondition(initType, initalCompoId);
+    ReferenceFields reference;
+    if (!setting.reference.empty()) {
+        DefineReferenceFields(reference, setting);
+    }
+    Partition();
+    if (setting.start == 0) {
+        SetInitialMacrosVars();
+#ifdef OPS_2D
+        PreDefinedInitialCondition();
+#endif
+#ifdef OPS_3D
+        PreDefinedInitialCondition3D();
+#endif
+    }
+    SetTimeStep(meshSize / SoundSpeed());
+
+    void (*cycle)(const Real){SchemeCycle()};
+    StartCheckpoints(setting.start, setting.period);
+    for (SizeType iter = setting.start; iter < setting.end; iter++) {
+        cycle(iter * TimeStep());
+        if (IsOutputStep(iter + 1)) {
+#ifdef OPS_2D
+            UpdateMacroVars();
+#endif
+#ifdef OPS_3D
+            UpdateMacroVars3D();
+#endif
+            WriteCheckpoint(iter + 1);
+        }
+    }
+    FinishCheckpoints();
+    if (!setting.reference.empty()) {
+#ifdef OPS_2D
+        UpdateMacroVars();
+#endif
+#ifdef OPS_3D
+        UpdateMacroVars3D();
+#endif
+        const bool passed{CompareWithReference(reference, setting)};
+        if (!passed) {
+            ops_printf(
+                "Error! %s differs from %s at the step %zu by more than "
+                "%.6e!\n",
+                setting.caseName.c_str(), setting.reference.c_str(),
+                setting.end, setting.tolerance);
+            assert(passed);
+        }
+        ops_printf("%s matches %s at the step %zu!\n",
+                   setting.caseName.c_str(), setting.reference.c_str(),
+                   setting.end);
+    }
+    DestroyModel();
+}
+
+int main(int argc, const char** argv) {
+    // OPS initialisation where a few arguments can be passed to set
+    // the simulation
+    ops_init(argc, argv, 1);
+    simulate(ReadRegressionSetting(argc, argv));
+    ops_exit();
+}